@@ -1,9 +1,33 @@
-#define GROUP_DIMENSIONS_X 32
-#define GROUP_DIMENSIONS_Y 32
+/* overridden per variant by the host; 16x16 stays well inside every device's maxComputeWorkGroupInvocations */
+#ifndef GROUP_DIMENSIONS_X
+#define GROUP_DIMENSIONS_X 16
+#endif
+#ifndef GROUP_DIMENSIONS_Y
+#define GROUP_DIMENSIONS_Y 16
+#endif
 #define GROUP_DIMENSIONS_Z 1
 #define GROUP_DIMENSIONS_NUMTHREAD GROUP_DIMENSIONS_X, GROUP_DIMENSIONS_Y, GROUP_DIMENSIONS_Z
 #define _group_dimensions uint3(GROUP_DIMENSIONS_NUMTHREAD)
 
+/* cells are packed 32 to a uint, row-major; bit i of a word is the cell at x = word * 32 + i. each thread steps one word */
+#define CELLS_PER_WORD 32
+
+/* each generation stepped in shared memory costs a row of halo above and below, so the tile is sized for the most a pipeline may ask for */
+#ifndef GENERATIONS_PER_DISPATCH_MAX
+#define GENERATIONS_PER_DISPATCH_MAX 8
+#endif
+
+/* chosen at pipeline creation; clamped to [1, GENERATIONS_PER_DISPATCH_MAX]. the one-word horizontal halo would cover up to 31 */
+[[vk::constant_id(0)]]
+const uint generations_per_dispatch = 1;
+
+/* the workgroup's words plus a one-word halo left and right and a halo row above and below per generation; the grid wraps around.
+   double-buffered, since every generation reads its neighbours' previous values */
+#define TILE_WIDTH (GROUP_DIMENSIONS_X + 2)
+#define TILE_HEIGHT (GROUP_DIMENSIONS_Y + 2 * GENERATIONS_PER_DISPATCH_MAX)
+groupshared uint tile[2][TILE_HEIGHT][TILE_WIDTH];
+groupshared uint tile_changed;
+
 [[vk::binding(0, 0)]]
 RWStructuredBuffer<uint> input_grid;
 
@@ -12,20 +36,226 @@ RWStructuredBuffer<uint> output_grid;
 
 [[vk::binding(2, 0)]]
 cbuffer Uniforms {
-    uint u_x;
-    uint u_y;
-    uint u_v;
+    uint u_x; /* grid width in words */
+    uint u_y; /* grid height in rows */
+    uint u_v; /* seed for generation 0 */
 };
 
+/* a tile is one workgroup's words; only tiles that changed last dispatch, or that border one that did, are stepped */
+[[vk::binding(4, 0)]]
+RWStructuredBuffer<uint> tile_flags; /* per tile, nonzero if its last step changed it */
+
+[[vk::binding(5, 0)]]
+RWStructuredBuffer<uint> active_tiles; /* tile indices for the next dispatch */
+
+[[vk::binding(6, 0)]]
+RWStructuredBuffer<uint> dispatch_args; /* VkDispatchIndirectCommand for the next dispatch */
+
+struct Step {
+    uint generation; /* of input_grid; 0 seeds the grid instead of reading it */
+    uint tiles_x;
+    uint tiles_y;
+    uint all_tiles; /* step every tile and ignore active_tiles, e.g. when the tile shape has changed */
+};
+
+[[vk::push_constant]]
+Step current_step;
+
+/* either a swapchain backbuffer (storage usage supported) or an intermediate image at grid resolution that gets blitted */
 [[vk::binding(3, 0)]]
-[[vk::image_format("bgra8")]]
-RWTexture2D<float> output_image;
+[[vk::image_format("unknown")]]
+RWTexture2D<float4> output_image;
+
+uint hash(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint load_word(int2 word) {
+    uint2 grid_words = uint2(u_x, u_y);
+    uint2 wrapped = uint2((word + int2(grid_words)) % int2(grid_words));
+    uint index = wrapped.y * u_x + wrapped.x;
+    return current_step.generation == 0 ? hash(index ^ u_v) : input_grid[index];
+}
+
+/* 32 one-bit full adders side by side */
+void full_add(uint a, uint b, uint c, out uint sum, out uint carry) {
+    uint partial = a ^ b;
+    sum = partial ^ c;
+    carry = (a & b) | (partial & c);
+}
+
+/* the row's cells shifted so that each bit lines up with its west or east neighbour, pulling the edge bit from the adjacent word */
+uint west(uint left, uint middle) {
+    return (middle << 1) | (left >> 31);
+}
+
+uint east(uint middle, uint right) {
+    return (middle >> 1) | (right << 31);
+}
+
+/* the next value of word x in row y of tile[source]; the tile's left and right edges see dead cells past them */
+uint step_word(uint source, uint y, uint x) {
+    uint left_x = max(x, 1) - 1;
+    uint right_x = min(x + 1, TILE_WIDTH - 1);
+    uint has_left = x > 0 ? 0xffffffffu : 0;
+    uint has_right = x + 1 < TILE_WIDTH ? 0xffffffffu : 0;
+
+    uint above = tile[source][y - 1][x];
+    uint middle = tile[source][y][x];
+    uint below = tile[source][y + 1][x];
+
+    /* count the 8 neighbours of all 32 cells at once into a 3-bit count (mod 8; 8 neighbours reads as 0, which is dead either way) */
+    uint ones_a, twos_a;
+    full_add(west(tile[source][y - 1][left_x] & has_left, above), above, east(above, tile[source][y - 1][right_x] & has_right), ones_a, twos_a);
+
+    uint ones_b, twos_b;
+    full_add(west(tile[source][y + 1][left_x] & has_left, below), below, east(below, tile[source][y + 1][right_x] & has_right), ones_b, twos_b);
+
+    uint middle_west = west(tile[source][y][left_x] & has_left, middle);
+    uint middle_east = east(middle, tile[source][y][right_x] & has_right);
+    uint ones_c = middle_west ^ middle_east;
+    uint twos_c = middle_west & middle_east;
+
+    uint ones, twos_d;
+    full_add(ones_a, ones_b, ones_c, ones, twos_d);
+
+    uint twos_partial, fours_a;
+    full_add(twos_a, twos_b, twos_c, twos_partial, fours_a);
+
+    uint twos = twos_partial ^ twos_d;
+    uint fours = fours_a ^ (twos_partial & twos_d);
+
+    /* alive with 2 or 3 neighbours, born with 3 */
+    return twos & ~fours & (ones | middle);
+}
 
 [numthreads(GROUP_DIMENSIONS_NUMTHREAD)]
 void cellular_automata(
     uint3 group_id : SV_GroupID,
-    uint3 group_thread_id : SV_GroupThreadID,
-    uint3 thread_coordinate_id : SV_DispatchThreadID
+    uint3 group_thread_id : SV_GroupThreadID
 ) {
-    
+    uint generations = clamp(generations_per_dispatch, 1, GENERATIONS_PER_DISPATCH_MAX);
+    uint tile_rows = GROUP_DIMENSIONS_Y + 2 * generations;
+    uint thread_index = group_thread_id.y * GROUP_DIMENSIONS_X + group_thread_id.x;
+
+    uint tile_index = current_step.all_tiles != 0 ? group_id.x : active_tiles[group_id.x];
+    uint2 tile_coordinate = uint2(tile_index % current_step.tiles_x, tile_index / current_step.tiles_x);
+    uint2 word = tile_coordinate * _group_dimensions.xy + group_thread_id.xy;
+    if (thread_index == 0) {
+        tile_changed = 0;
+    }
+
+    /* every thread strides over the tile, so the halo (corners included) loads without special cases */
+    int2 tile_origin = int2(tile_coordinate * _group_dimensions.xy) - int2(1, generations);
+    for (uint i = thread_index; i < TILE_WIDTH * tile_rows; i += GROUP_DIMENSIONS_X * GROUP_DIMENSIONS_Y) {
+        uint2 t = uint2(i % TILE_WIDTH, i / TILE_WIDTH);
+        tile[0][t.y][t.x] = load_word(tile_origin + int2(t));
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+    uint previous = tile[0][group_thread_id.y + generations][group_thread_id.x + 1];
+
+    /* the whole tile but its first and last rows is stepped every generation. what goes wrong at the edges (the rows that
+       aren't stepped, the dead cells past the side words) creeps in by a row and a cell per generation, which the halo absorbs */
+    uint source = 0;
+    for (uint generation = 0; generation < generations; ++generation) {
+        for (uint i = thread_index; i < TILE_WIDTH * (tile_rows - 2); i += GROUP_DIMENSIONS_X * GROUP_DIMENSIONS_Y) {
+            uint y = i / TILE_WIDTH + 1;
+            uint x = i % TILE_WIDTH;
+            tile[source ^ 1][y][x] = step_word(source, y, x);
+        }
+
+        source ^= 1;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint next = tile[source][group_thread_id.y + generations][group_thread_id.x + 1];
+    output_grid[word.y * u_x + word.x] = next;
+
+    /* one shared-memory atomic per wave at most. a seeded grid counts as changed, since input_grid doesn't hold the seed */
+    if (WaveActiveAnyTrue(next != previous) && WaveIsFirstLane()) {
+        InterlockedOr(tile_changed, 1u);
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+    if (thread_index == 0) {
+        tile_flags[tile_index] = tile_changed | (current_step.generation == 0 ? 1u : 0u);
+    }
+}
+
+/*
+ * a tile whose own and whose neighbours' last steps changed nothing is skipped: its next step would reproduce what both grid
+ * buffers already hold for it. that only holds while a dispatch's generations can't reach past the neighbouring tiles, i.e.
+ * generations_per_dispatch <= GROUP_DIMENSIONS_Y. a single workgroup walks every tile, so the count starts from zero without
+ * a separate clear
+ */
+#define COMPACT_GROUP_SIZE 256
+
+groupshared uint active_count;
+
+[numthreads(COMPACT_GROUP_SIZE, 1, 1)]
+void compact_active_tiles(uint3 group_thread_id : SV_GroupThreadID) {
+    if (group_thread_id.x == 0) {
+        active_count = 0;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    uint tile_count = current_step.tiles_x * current_step.tiles_y;
+    uint rounded_count = (tile_count + COMPACT_GROUP_SIZE - 1) / COMPACT_GROUP_SIZE * COMPACT_GROUP_SIZE;
+    for (uint i = group_thread_id.x; i < rounded_count; i += COMPACT_GROUP_SIZE) {
+        uint changed = 0;
+        if (i < tile_count) {
+            int2 tile_coordinate = int2(i % current_step.tiles_x, i / current_step.tiles_x);
+            int2 tiles = int2(current_step.tiles_x, current_step.tiles_y);
+            for (int y = -1; y <= 1; ++y) {
+                for (int x = -1; x <= 1; ++x) {
+                    uint2 neighbour = uint2((tile_coordinate + int2(x, y) + tiles) % tiles);
+                    changed |= tile_flags[neighbour.y * current_step.tiles_x + neighbour.x];
+                }
+            }
+        }
+
+        /* each wave reserves its slots with one atomic, lanes take theirs in order */
+        bool active = changed != 0;
+        uint wave_count = WaveActiveCountBits(active);
+        uint base = 0;
+        if (WaveIsFirstLane()) {
+            InterlockedAdd(active_count, wave_count, base);
+        }
+
+        base = WaveReadLaneFirst(base);
+        if (active) {
+            active_tiles[base + WavePrefixCountBits(active)] = i;
+        }
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+    if (group_thread_id.x == 0) {
+        dispatch_args[0] = active_count;
+        dispatch_args[1] = 1;
+        dispatch_args[2] = 1;
+    }
+}
+
+/* nearest-neighbour scale of the grid into output_image; runs over every pixel, since skipped tiles still have to be drawn */
+#define RENDER_GROUP_SIZE 8
+
+[numthreads(RENDER_GROUP_SIZE, RENDER_GROUP_SIZE, 1)]
+void render_cells(uint3 thread_coordinate_id : SV_DispatchThreadID) {
+    uint2 image_dimensions;
+    output_image.GetDimensions(image_dimensions.x, image_dimensions.y);
+    if (any(thread_coordinate_id.xy >= image_dimensions)) {
+        return;
+    }
+
+    uint2 cell = thread_coordinate_id.xy * uint2(u_x * CELLS_PER_WORD, u_y) / image_dimensions;
+    uint word = output_grid[cell.y * u_x + cell.x / CELLS_PER_WORD];
+    float alive = float((word >> (cell.x % CELLS_PER_WORD)) & 1);
+    output_image[thread_coordinate_id.xy] = float4(alive, alive, alive, 1.0);
 }
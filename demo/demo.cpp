@@ -3,16 +3,50 @@
 #include <fstream>
 #include <string>
 #include <filesystem>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <array>
 
-#define KVK_USE_DXC
 #include "kvk.h"
+#include "life.h"
+
+#ifndef KVK_USE_DXC
+#include "cellular_automata.spv.h"
+#include "compact_active_tiles.spv.h"
+#include "render_cells.spv.h"
+
+/* the life kernel at every other workgroup shape that's tuned, compiled and packed into one archive by meson.build as nothing can compile it at runtime */
+#ifndef CELLULAR_AUTOMATA_SHADER_ARCHIVE_PATH
+#define CELLULAR_AUTOMATA_SHADER_ARCHIVE_PATH "cellular_automata_variants.kvka"
+#endif
+#elif !defined(CELLULAR_AUTOMATA_SHADER_PATH)
+#define CELLULAR_AUTOMATA_SHADER_PATH "cellular_automata.hlsl"
+#endif
 
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_vulkan.h>
 
-#define CELLULAR_AUTOMATA_GRID_WIDTH 256
-#define CELLULAR_AUTOMATA_GRID_HEIGHT 256
-#define CELLULAR_AUTOMATA_CELLS_PER_BYTE 2
+#define CELLULAR_AUTOMATA_GRID_WIDTH 2048
+#define CELLULAR_AUTOMATA_GRID_HEIGHT 2048
+#define CELLULAR_AUTOMATA_CELLS_PER_WORD 32
+#define CELLULAR_AUTOMATA_GRID_WORDS (CELLULAR_AUTOMATA_GRID_WIDTH / CELLULAR_AUTOMATA_CELLS_PER_WORD)
+#define CELLULAR_AUTOMATA_SEED 0x5eed
+
+/* generations stepped in shared memory per dispatch (spec constant 0), at most the shader's GENERATIONS_PER_DISPATCH_MAX */
+#define CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH 4
+
+/* a tile is one life workgroup; the smallest shape tuned is 8x8 */
+#define CELLULAR_AUTOMATA_MAX_TILES (CELLULAR_AUTOMATA_GRID_WORDS * CELLULAR_AUTOMATA_GRID_HEIGHT / 64)
+
+/* render_cells' workgroup is this square */
+#define CELLULAR_AUTOMATA_RENDER_GROUP_SIZE 8
+
+/* rows per job when the cpu steps the grid */
+#define CELLULAR_AUTOMATA_CPU_BAND_ROWS 32
+
+#define FRAMES_IN_FLIGHT 2
 
 struct Queue {
     VkQueue vk_queue;
@@ -26,12 +60,238 @@ struct Queues {
 };
 
 struct Uniforms {
-    uint32_t x;
-    uint32_t y;
-    uint32_t v;
+    uint32_t x; /* grid width in words */
+    uint32_t y; /* grid height in rows */
+    uint32_t v; /* seed for generation 0 */
+};
+
+/* written into a set or pushed in one go through an update template, in binding order */
+struct ComputePass0_0Descriptors {
+    VkDescriptorBufferInfo input_grid;
+    VkDescriptorBufferInfo output_grid;
+    VkDescriptorImageInfo output_image;
+    VkDescriptorBufferInfo uniforms;
+    VkDescriptorBufferInfo tile_flags;
+    VkDescriptorBufferInfo active_tiles;
+    VkDescriptorBufferInfo dispatch_args;
+};
+
+/* pushed to every kernel in cellular_automata.hlsl; mirrors its Step */
+struct LifeStep {
+    uint32_t generation; /* of the input grid; 0 seeds the grid */
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    uint32_t all_tiles; /* step every tile instead of the active ones, e.g. when the tile shape has changed */
+};
+
+/* the life, compaction and render kernels share a layout and one set of descriptors per frame */
+struct ComputeRecordState {
+    VkPipeline vk_pipeline;
+    VkPipeline vk_compact_pipeline;
+    VkPipeline vk_render_pipeline;
+    VkPipelineLayout vk_pipeline_layout;
+    VkDescriptorSet vk_descriptor_set;
+    kvk::update::UpdateTemplate const* push_template; /* pushes descriptors instead of binding vk_descriptor_set */
+    kvk::descriptor_buffer::DescriptorBufferHeap const* descriptor_buffer_heap; /* binds descriptor_buffer_set instead, with --descriptor-buffer */
+    kvk::descriptor_buffer::DescriptorBufferSet descriptor_buffer_set;
+    ComputePass0_0Descriptors descriptors;
+    LifeStep step;
+    uint32_t band_tiles_y; /* tile rows from the top an all-tiles dispatch covers; fewer than tiles_y when the cpu steps the rest */
+    VkBuffer vk_dispatch_args;
+
+    /* of the render kernel, which every worker records a band of workgroup rows of */
+    uint32_t group_count_x;
+    uint32_t group_count_y;
+};
+
+/* one workgroup shape of the life kernel, tuned against the others on this device */
+struct LifeVariant {
+    std::string label;
+    uint32_t workgroup_size[2]; /* in words x rows */
+    std::vector<std::string> defines;
+    VkShaderModule vk_shader_module;
+    VkPipeline vk_pipeline;
+    uint32_t watch_id;
 };
 
-int main() {
+/* rows [begin, end) of the grid */
+struct RowRange {
+    uint32_t begin;
+    uint32_t end;
+};
+
+/*
+ * --hybrid: the gpu steps rows [0, split) and the cpu workers the rest, both a dispatch's worth of generations at a time.
+ * rows cross over through a persistently mapped buffer laid out like the grid: the cpu's band goes up whole (the gpu needs
+ * its edges, the renderer all of it) and only the gpu rows the cpu's next band reads come back down. the band is copied into
+ * the input grid only, so the renderer draws the copy the output grid got when it was last the input, two dispatches behind
+ * the gpu's rows. each side waits for the other's last dispatch, so frames in flight no longer overlap
+ */
+struct HybridState {
+    life::Grid grid; /* valid over the cpu's band and the gpu rows it was last sent */
+    VkBuffer vk_exchange_buffer;
+    uint32_t* exchange;
+
+    /* split is decided a dispatch ahead, so the gpu knows which rows to send down */
+    uint32_t last_split;
+    uint32_t split;
+    uint32_t next_split;
+    uint32_t frame_splits[FRAMES_IN_FLIGHT]; /* split of the dispatch each frame slot carried, for its timestamps */
+
+    /* smoothed time either side takes per row; 0 until measured */
+    double gpu_row_seconds;
+    double cpu_row_seconds;
+};
+
+/* the graph's record callbacks can't fail, so errors are parked here and checked after execution */
+struct LifePassState {
+    VkDevice vk_device;
+    kvk::job::JobSystem* jobs;
+    kvk::command::Recycler* recycler;
+    kvk::tune::TuneSession* tune_session;
+    HybridState* hybrid; /* null unless --hybrid */
+    uint32_t frame_index;
+    ComputeRecordState compute;
+    VkResult vk_result;
+};
+
+static void cmd_bind_compute(VkCommandBuffer vk_command_buffer, ComputeRecordState const& state, VkPipeline vk_pipeline) {
+    vkCmdBindPipeline(vk_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, vk_pipeline);
+    if (state.descriptor_buffer_heap != nullptr) {
+        kvk::descriptor_buffer::cmd_bind(vk_command_buffer, *state.descriptor_buffer_heap);
+        kvk::descriptor_buffer::cmd_set_set(vk_command_buffer, *state.descriptor_buffer_heap, VK_PIPELINE_BIND_POINT_COMPUTE, state.vk_pipeline_layout, 0, state.descriptor_buffer_set);
+    } else if (state.push_template != nullptr) {
+        kvk::update::cmd_push(vk_command_buffer, *state.push_template, state.descriptors);
+    } else {
+        vkCmdBindDescriptorSets(vk_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, state.vk_pipeline_layout, 0, 1, &state.vk_descriptor_set, 0, nullptr);
+    }
+
+    vkCmdPushConstants(vk_command_buffer, state.vk_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(LifeStep), &state.step);
+}
+
+/* writes the frame's descriptors into descriptor buffer memory; buffers go by address there, so their ranges are spelled out */
+static void write_descriptor_buffer_set(VkDevice vk_device, kvk::descriptor_buffer::DescriptorBufferHeap const& heap, kvk::descriptor_buffer::DescriptorBufferLayout const& layout, ComputeRecordState const& state) {
+    struct BufferBinding {
+        uint32_t binding;
+        VkDescriptorType vk_descriptor_type;
+        VkBuffer vk_buffer;
+        VkDeviceSize vk_range;
+    };
+
+    VkDeviceSize grid_size = CELLULAR_AUTOMATA_GRID_WORDS * CELLULAR_AUTOMATA_GRID_HEIGHT * sizeof(uint32_t);
+    VkDeviceSize tiles_size = CELLULAR_AUTOMATA_MAX_TILES * sizeof(uint32_t);
+    BufferBinding const buffer_bindings[] = {
+        { 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, state.descriptors.input_grid.buffer, grid_size },
+        { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, state.descriptors.output_grid.buffer, grid_size },
+        { 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, state.descriptors.uniforms.buffer, sizeof(Uniforms) },
+        { 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, state.descriptors.tile_flags.buffer, tiles_size },
+        { 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, state.descriptors.active_tiles.buffer, tiles_size },
+        { 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, state.descriptors.dispatch_args.buffer, sizeof(VkDispatchIndirectCommand) },
+    };
+
+    for (BufferBinding const& buffer_binding : buffer_bindings) {
+        kvk::descriptor_buffer::write_buffer(vk_device, heap, layout, state.descriptor_buffer_set, buffer_binding.binding, 0, buffer_binding.vk_descriptor_type, kvk::descriptor_buffer::buffer_address(vk_device, buffer_binding.vk_buffer), buffer_binding.vk_range);
+    }
+
+    kvk::descriptor_buffer::write_image(vk_device, heap, layout, state.descriptor_buffer_set, 3, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, state.descriptors.output_image);
+}
+
+/* the gpu rows (of [0, split)) the cpu's band [next_split, height) reads over a dispatch: those its last rows wrap around to and those just above it */
+static std::array<RowRange, 2> hybrid_edge_rows(uint32_t split, uint32_t next_split) {
+    if (next_split >= CELLULAR_AUTOMATA_GRID_HEIGHT) {
+        return {};
+    }
+
+    uint32_t top_end = std::min<uint32_t>(CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH, split);
+    uint32_t above_begin = std::max<uint32_t>(next_split - CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH, top_end);
+    return {
+        RowRange { 0, top_end },
+        RowRange { std::min(above_begin, split), split },
+    };
+}
+
+static void copy_rows(uint32_t* destination, uint32_t const* source, RowRange rows) {
+    if (rows.begin < rows.end) {
+        size_t offset = static_cast<size_t>(rows.begin) * CELLULAR_AUTOMATA_GRID_WORDS;
+        std::memcpy(destination + offset, source + offset, static_cast<size_t>(rows.end - rows.begin) * CELLULAR_AUTOMATA_GRID_WORDS * sizeof(uint32_t));
+    }
+}
+
+static void cmd_copy_rows(VkCommandBuffer vk_command_buffer, VkBuffer vk_source, VkBuffer vk_destination, RowRange rows) {
+    if (rows.begin < rows.end) {
+        VkBufferCopy vk_buffer_copy = {
+            .srcOffset = static_cast<VkDeviceSize>(rows.begin) * CELLULAR_AUTOMATA_GRID_WORDS * sizeof(uint32_t),
+            .dstOffset = static_cast<VkDeviceSize>(rows.begin) * CELLULAR_AUTOMATA_GRID_WORDS * sizeof(uint32_t),
+            .size = static_cast<VkDeviceSize>(rows.end - rows.begin) * CELLULAR_AUTOMATA_GRID_WORDS * sizeof(uint32_t),
+        };
+
+        vkCmdCopyBuffer(vk_command_buffer, vk_source, vk_destination, 1, &vk_buffer_copy);
+    }
+}
+
+/* a single slow frame (a page fault, a preempted worker) shouldn't swing the split */
+static double smooth(double average, double sample) {
+    return average > 0.0 ? average + (sample - average) * 0.25 : sample;
+}
+
+/* steps the grid on the cpu alone, for nodes without a GPU or display */
+static int run_headless(uint64_t generations) {
+    kvk::job::JobSystem jobs;
+    kvk::job::create_job_system({}, jobs);
+
+    life::Grid grid;
+    if (!life::create_grid(CELLULAR_AUTOMATA_GRID_WORDS, CELLULAR_AUTOMATA_GRID_HEIGHT, grid)) {
+        std::cerr << "Failed to create the cpu grid" << std::endl;
+        kvk::job::destroy_job_system(jobs);
+        return 1;
+    }
+
+    life::seed(grid, CELLULAR_AUTOMATA_SEED);
+
+    auto begin = std::chrono::steady_clock::now();
+    life::run(jobs, grid, generations, CELLULAR_AUTOMATA_CPU_BAND_ROWS);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    double cell_updates = static_cast<double>(CELLULAR_AUTOMATA_GRID_WIDTH) * CELLULAR_AUTOMATA_GRID_HEIGHT * static_cast<double>(generations);
+    std::cout << "Life (cpu, " << life::simd_path() << ", " << kvk::job::worker_count(jobs) << " threads): " << generations << " generations in " << seconds << " s, " << cell_updates / seconds / 1e9 << " G cell-updates/s, population " << life::population(grid) << std::endl;
+
+    kvk::job::destroy_job_system(jobs);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    /* --headless <generations> runs the cpu engine without a window; --validate <dispatches> compares the GPU's grid against it after that many frames;
+       --hybrid splits the grid between the GPU and the cpu workers; --descriptor-buffer binds descriptors through VK_EXT_descriptor_buffer */
+    uint64_t headless_generations = 0;
+    uint64_t validate_dispatches = 0;
+    bool hybrid = false;
+    bool descriptor_buffer = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--hybrid") {
+            hybrid = true;
+            continue;
+        }
+
+        if (argument == "--descriptor-buffer") {
+            descriptor_buffer = true;
+            continue;
+        }
+
+        char* end = nullptr;
+        uint64_t value = i + 1 < argc ? std::strtoull(argv[++i], &end, 10) : 0;
+        if (value == 0 || *end != '\0' || (argument != "--headless" && argument != "--validate")) {
+            std::cerr << "Usage: demo [--headless <generations>] [--validate <dispatches>] [--hybrid] [--descriptor-buffer]" << std::endl;
+            return 1;
+        }
+
+        (argument == "--headless" ? headless_generations : validate_dispatches) = value;
+    }
+
+    if (headless_generations > 0) {
+        return run_headless(headless_generations);
+    }
+
     /* setup SDL3 and window */
     if (!SDL_Init(SDL_INIT_VIDEO)) {
         std::cerr << "SDL_Init Error: " << SDL_GetError() << std::endl;
@@ -132,6 +392,11 @@ int main() {
     }
 
     /* setup device */
+    std::vector<VkExtensionProperties> vk_required_extensions;
+    if (descriptor_buffer) {
+        vk_required_extensions.push_back({ VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME, 0 });
+    }
+
     VkDevice vk_device;
     VkPhysicalDevice vk_physical_device;
     std::vector<kvk::DeviceQueueReturn> vk_device_queues;
@@ -141,17 +406,24 @@ int main() {
             .minimum_vk_version = VK_MAKE_API_VERSION(0, 1, 2, 197),
             .excluded_device_types = kvk::PhysicalDeviceTypeFlags::CPU | kvk::PhysicalDeviceTypeFlags::VIRTUAL_GPU | kvk::PhysicalDeviceTypeFlags::OTHER,
             .minimum_features = {
+                .shaderStorageImageWriteWithoutFormat = true,
                 .shaderSampledImageArrayDynamicIndexing = true,
                 .shaderStorageBufferArrayDynamicIndexing = true,
                 .shaderStorageImageArrayDynamicIndexing = true,
             },
             .minimum_limits = {},
-            .required_extensions = {},
+            .required_extensions = vk_required_extensions,
             .minimum_format_properties = {
                 {
                     .format = VK_FORMAT_B8G8R8A8_SRGB,
                     .minimum_properties = {
-                        .optimalTilingFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT,
+                        .optimalTilingFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT,
+                    },
+                },
+                {
+                    .format = VK_FORMAT_B8G8R8A8_UNORM,
+                    .minimum_properties = {
+                        .optimalTilingFeatures = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT,
                     },
                 },
                 {
@@ -175,8 +447,9 @@ int main() {
             },
             .required_queues = {
                 {
+                    /* graphics for the blit fallback when backbuffers can't be storage images */
                     .properties = {
-                        .queueFlags = VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT,
+                        .queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT,
                         .queueCount = 1,
                     },
                     .surface_support = vk_surface,
@@ -194,11 +467,21 @@ int main() {
                     },
                 },
             },
+            /* the life kernel flags changed tiles with a wave vote, and compaction appends active tiles with wave ballots */
+            .minimum_subgroup_properties = VkPhysicalDeviceSubgroupProperties {
+                .supportedStages = VK_SHADER_STAGE_COMPUTE_BIT,
+                .supportedOperations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_BALLOT_BIT | VK_SUBGROUP_FEATURE_VOTE_BIT,
+            },
         },
         .presets = {
             .recommended = true,
             .enable_swapchain = true,
             .enable_dynamic_rendering = true,
+            .enable_present_wait = true,
+            .enable_timeline_semaphore = true,
+            .enable_synchronization2 = true,
+            .enable_push_descriptor = true,
+            .enable_descriptor_buffer = descriptor_buffer,
         },
     }, vk_physical_device, vk_device, vk_device_queues) != VK_SUCCESS) {
         if (vk_physical_device == nullptr) {
@@ -229,83 +512,58 @@ int main() {
         },
     };
 
-    /* setup command pool and buffer */
-    VkCommandPoolCreateInfo vk_compute_queue0_command_pool0_create_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .queueFamilyIndex = queues.compute0_0.family_index,
-    };
-
-    VkCommandPool vk_compute_queue0_command_pool0;
-    if (vkCreateCommandPool(vk_device, &vk_compute_queue0_command_pool0_create_info, nullptr, &vk_compute_queue0_command_pool0) != VK_SUCCESS) {
-        std::cerr << "Failed to create compute queue 0 command pool 0" << std::endl;
+    /* setup submission scheduling over every queue we got */
+    kvk::scheduler::Scheduler scheduler;
+    if (kvk::scheduler::create_scheduler(vk_device, {
+        .vk_physical_device = vk_physical_device,
+        .queues = vk_device_queues,
+        .vk_present_surface = vk_surface,
+    }, scheduler) != VK_SUCCESS) {
+        std::cerr << "Failed to create submission scheduler" << std::endl;
         return 1;
     }
 
-    VkCommandBufferAllocateInfo vk_compute_queue0_command_pool0_command_buffer0_allocate_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = vk_compute_queue0_command_pool0,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
-    };
-
-    VkCommandBuffer vk_compute_queue0_command_pool0_command_buffer0;
-    if (vkAllocateCommandBuffers(vk_device, &vk_compute_queue0_command_pool0_command_buffer0_allocate_info, &vk_compute_queue0_command_pool0_command_buffer0) != VK_SUCCESS) {
-        std::cerr << "Failed to allocate compute queue 0 command pool 0 command buffer 0" << std::endl;
+    /* setup job system and command buffer recycling, one recycler thread per worker */
+    kvk::job::JobSystem jobs;
+    kvk::job::create_job_system({}, jobs);
+
+    kvk::command::Recycler command_recycler;
+    if (kvk::command::create_recycler(vk_device, {
+        .queue_family_index = queues.compute0_0.family_index,
+        .thread_count = kvk::job::worker_count(jobs),
+        .frames_in_flight = FRAMES_IN_FLIGHT,
+        .allocation_batch_size = 1,
+    }, command_recycler) != VK_SUCCESS) {
+        std::cerr << "Failed to create command recycler" << std::endl;
         return 1;
     }
 
     /* setup swapchain */
     std::vector<VkImage> vk_swapchain_backbuffers;
-    kvk::SwapchainReturns swapchain_returns;
+    kvk::SwapchainReturns swapchain_returns = {
+        .vk_backbuffers = vk_swapchain_backbuffers,
+    };
+
+    /* cells are either black or white, so a UNORM backbuffer looks the same as an sRGB one and usually allows storage writes */
     if (kvk::create_swapchain(vk_device, {
         .vk_physical_device = vk_physical_device,
         .vk_surface = vk_surface,
-        .vk_image_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        .vk_image_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .vk_optional_image_usage = VK_IMAGE_USAGE_STORAGE_BIT,
         .preferences = {
             {
-                .image_count = 3,
                 .layer_count = 1,
                 .vk_surface_format = {
-                    .format = VK_FORMAT_B8G8R8A8_SRGB,
+                    .format = VK_FORMAT_B8G8R8A8_UNORM,
                     .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
                 },
-                .vk_present_mode = VK_PRESENT_MODE_MAILBOX_KHR,
             },
             {
-                .image_count = 3,
                 .layer_count = 1,
                 .vk_surface_format = {
                     .format = VK_FORMAT_B8G8R8A8_SRGB,
                     .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
                 },
-                .vk_present_mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR,
-            },
-            {
-                .image_count = 2,
-                .layer_count = 1,
-                .vk_surface_format = {
-                    .format = VK_FORMAT_B8G8R8A8_SRGB,
-                    .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
-                },
-                .vk_present_mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR,
-            },
-            {
-                .image_count = 3,
-                .layer_count = 1,
-                .vk_surface_format = {
-                    .format = VK_FORMAT_B8G8R8A8_SRGB,
-                    .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
-                },
-                .vk_present_mode = VK_PRESENT_MODE_FIFO_KHR,
-            },
-            {
-                .image_count = 2,
-                .layer_count = 1,
-                .vk_surface_format = {
-                    .format = VK_FORMAT_B8G8R8A8_SRGB,
-                    .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
-                },
-                .vk_present_mode = VK_PRESENT_MODE_FIFO_KHR,
             },
         },
         .vk_image_sharing_mode = VK_SHARING_MODE_EXCLUSIVE,
@@ -313,11 +571,36 @@ int main() {
         .vk_pre_transform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
         .vk_composite_alpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
         .vk_clipped = VK_TRUE,
+        .policy = kvk::SwapchainPolicy::NO_TEARING_BOUNDED,
+        .policy_max_queued_images = 2,
     }, swapchain_returns) != VK_SUCCESS) {
         std::cerr << "Failed to create Vulkan swapchain" << std::endl;
         return 1;
     }
 
+    std::cout << "Swapchain: " << swapchain_returns.choice_reason << std::endl;
+
+    /*
+     * present latency is measured and reported, but suggest_preference() isn't acted on: the preferences here differ in format,
+     * which decides whether compute can write the backbuffer directly, so switching would mean rebuilding the frame graph
+     */
+    kvk::present::LatencyTelemetry latency_telemetry;
+    if (kvk::present::create_latency_telemetry(vk_device, {
+        .vk_swapchain = swapchain_returns.vk_swapchain,
+        .preference = swapchain_returns.chosen_preference,
+        .preference_count = 2,
+        .sample_capacity = 600,
+        .use_present_id = kvk::present::present_id_supported(vk_physical_device),
+        .use_present_wait = kvk::present::present_wait_supported(vk_physical_device),
+    }, latency_telemetry) != VK_SUCCESS) {
+        std::cerr << "Failed to create present latency telemetry" << std::endl;
+        return 1;
+    }
+
+    /* write backbuffers straight from the compute shader when possible, otherwise render at grid resolution and blit */
+    bool direct_backbuffer_writes = (swapchain_returns.vk_image_usage & VK_IMAGE_USAGE_STORAGE_BIT) != 0;
+    std::cout << "Presenting via " << (direct_backbuffer_writes ? "direct compute writes to the backbuffer" : "scaled blit from an intermediate image") << std::endl;
+
     VkSwapchainKHR vk_swapchain = swapchain_returns.vk_swapchain;
     std::vector<VkImageView> vk_swapchain_backbuffer_views(vk_swapchain_backbuffers.size());
     for (uint32_t i = 0; i < vk_swapchain_backbuffers.size(); ++i) {
@@ -325,7 +608,7 @@ int main() {
             .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
             .image = vk_swapchain_backbuffers[i],
             .viewType = VK_IMAGE_VIEW_TYPE_2D,
-            .format = VK_FORMAT_B8G8R8A8_SRGB,
+            .format = swapchain_returns.vk_surface_format.format,
             .components = {
                 .r = VK_COMPONENT_SWIZZLE_IDENTITY,
                 .g = VK_COMPONENT_SWIZZLE_IDENTITY,
@@ -347,11 +630,14 @@ int main() {
         }
     }
 
-    /* setup cellular automata resources and allocate heaps */
+    /* setup cellular automata resources and allocate heaps; descriptor buffers reach buffers by device address */
+    VkBufferUsageFlags vk_descriptor_address_usage = descriptor_buffer ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0;
+    VkMemoryAllocateFlags vk_descriptor_address_allocate_flags = descriptor_buffer ? VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT : 0;
+
     VkBufferCreateInfo vk_cellular_automata_buffer_create_info = {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = CELLULAR_AUTOMATA_GRID_WIDTH * CELLULAR_AUTOMATA_GRID_HEIGHT / CELLULAR_AUTOMATA_CELLS_PER_BYTE,
-        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        .size = CELLULAR_AUTOMATA_GRID_WORDS * CELLULAR_AUTOMATA_GRID_HEIGHT * sizeof(uint32_t),
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | vk_descriptor_address_usage,
     };
 
     VkBuffer vk_cellular_automata_buffer0, vk_cellular_automata_buffer1;
@@ -365,10 +651,29 @@ int main() {
         return 1;
     }
 
+    /* the active tile list is rebuilt on the GPU every dispatch and fed back through vkCmdDispatchIndirect */
+    VkBufferCreateInfo vk_tile_buffer_create_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = CELLULAR_AUTOMATA_MAX_TILES * sizeof(uint32_t),
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | vk_descriptor_address_usage,
+    };
+
+    VkBufferCreateInfo vk_dispatch_args_buffer_create_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = sizeof(VkDispatchIndirectCommand),
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | vk_descriptor_address_usage,
+    };
+
+    VkBuffer vk_tile_flags_buffer, vk_active_tiles_buffer, vk_dispatch_args_buffer;
+    if (vkCreateBuffer(vk_device, &vk_tile_buffer_create_info, nullptr, &vk_tile_flags_buffer) != VK_SUCCESS || vkCreateBuffer(vk_device, &vk_tile_buffer_create_info, nullptr, &vk_active_tiles_buffer) != VK_SUCCESS || vkCreateBuffer(vk_device, &vk_dispatch_args_buffer_create_info, nullptr, &vk_dispatch_args_buffer) != VK_SUCCESS) {
+        std::cerr << "Failed to create cellular automata tile buffers" << std::endl;
+        return 1;
+    }
+
     VkImageCreateInfo vk_cellular_automata_render_image_create_info = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .imageType = VK_IMAGE_TYPE_2D,
-        .format = VK_FORMAT_B8G8R8A8_SRGB,
+        .format = VK_FORMAT_B8G8R8A8_UNORM,
         .extent = {
             .width = CELLULAR_AUTOMATA_GRID_WIDTH,
             .height = CELLULAR_AUTOMATA_GRID_HEIGHT,
@@ -383,10 +688,35 @@ int main() {
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
     };
 
-    VkImage vk_cellular_automata_render_image;
-    if (vkCreateImage(vk_device, &vk_cellular_automata_render_image_create_info, nullptr, &vk_cellular_automata_render_image) != VK_SUCCESS) {
-        std::cerr << "Failed to create cellular automata render image" << std::endl;
-        return 1;
+    std::vector<kvk::resource::MonoAllocationResidentID> cellular_automata_residents = {
+        {
+            .vk_buffer = vk_cellular_automata_buffer0,
+        },
+        {
+            .vk_buffer = vk_cellular_automata_buffer1,
+        },
+        {
+            .vk_buffer = vk_tile_flags_buffer,
+        },
+        {
+            .vk_buffer = vk_active_tiles_buffer,
+        },
+        {
+            .vk_buffer = vk_dispatch_args_buffer,
+        },
+    };
+
+    VkImage vk_cellular_automata_render_image = VK_NULL_HANDLE;
+    if (!direct_backbuffer_writes) {
+        if (vkCreateImage(vk_device, &vk_cellular_automata_render_image_create_info, nullptr, &vk_cellular_automata_render_image) != VK_SUCCESS) {
+            std::cerr << "Failed to create cellular automata render image" << std::endl;
+            return 1;
+        }
+
+        cellular_automata_residents.push_back({
+            .vk_image = vk_cellular_automata_render_image,
+            .is_image = true,
+        });
     }
 
     kvk::resource::MonoAllocationHeap cellular_automata_heap;
@@ -394,18 +724,8 @@ int main() {
         .vk_physical_device = vk_physical_device,
         .vk_minimum_heap_size = 0,
         .vk_memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        .residents = {
-            {
-                .vk_buffer = vk_cellular_automata_buffer0,
-            },
-            {
-                .vk_buffer = vk_cellular_automata_buffer1,
-            },
-            {
-                .vk_image = vk_cellular_automata_render_image,
-                .is_image = true,
-            },
-        },
+        .residents = cellular_automata_residents,
+        .vk_memory_allocate_flags = vk_descriptor_address_allocate_flags,
     }, cellular_automata_heap) != VK_SUCCESS) {
         std::cerr << "Failed to create mono allocation for cellular automata buffers" << std::endl;
         return 1;
@@ -416,11 +736,39 @@ int main() {
         return 1;
     }
 
+    VkImageView vk_cellular_automata_render_image_view = VK_NULL_HANDLE;
+    if (!direct_backbuffer_writes) {
+        VkImageViewCreateInfo vk_image_view_create_info = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = vk_cellular_automata_render_image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = vk_cellular_automata_render_image_create_info.format,
+            .components = {
+                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .a = VK_COMPONENT_SWIZZLE_IDENTITY,
+            },
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        };
+
+        if (vkCreateImageView(vk_device, &vk_image_view_create_info, nullptr, &vk_cellular_automata_render_image_view) != VK_SUCCESS) {
+            std::cerr << "Failed to create cellular automata render image view" << std::endl;
+            return 1;
+        }
+    }
+
     /* setup uniform resources and allocate heap */
     VkBufferCreateInfo vk_uniform_buffer_create_info = {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .size = sizeof(Uniforms),
-        .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | vk_descriptor_address_usage,
     };
 
     VkBuffer vk_uniform_buffer;
@@ -439,6 +787,7 @@ int main() {
                 .vk_buffer = vk_uniform_buffer,
             },
         },
+        .vk_memory_allocate_flags = vk_descriptor_address_allocate_flags,
     }, uniform_heap) != VK_SUCCESS) {
         std::cerr << "Failed to allocate uniform heap" << std::endl;
         return 1;
@@ -449,102 +798,773 @@ int main() {
         return 1;
     }
 
-    /* prepare for pipeline creation */
-    VkDescriptorSetLayoutBinding vk_compute_pass0_0_descriptor_set_layout_bindings[4] = {
-        {
-            .binding = 0,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-        },
-        {
-            .binding = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-        },
-        {
-            .binding = 2,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-        },
-        {
-            .binding = 3,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-        },
-    };
+    /* the uniforms never change, so they are written once before anything can read them */
+    {
+        Uniforms uniforms = {
+            .x = CELLULAR_AUTOMATA_GRID_WORDS,
+            .y = CELLULAR_AUTOMATA_GRID_HEIGHT,
+            .v = CELLULAR_AUTOMATA_SEED,
+        };
 
-    VkDescriptorSetLayoutCreateInfo vk_compute_pass0_0_descriptor_set_layout_create_info = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .bindingCount = sizeof(vk_compute_pass0_0_descriptor_set_layout_bindings) / sizeof(VkDescriptorSetLayoutBinding),
-        .pBindings = &vk_compute_pass0_0_descriptor_set_layout_bindings[0],
-    };
+        void* mapped;
+        VkDeviceSize vk_offset = uniform_heap.residents.at({ .vk_buffer = vk_uniform_buffer, .is_image = false }).vk_heap_offset;
+        if (vkMapMemory(vk_device, uniform_heap.vk_heap_memory, vk_offset, sizeof(Uniforms), 0, &mapped) != VK_SUCCESS) {
+            std::cerr << "Failed to map uniform heap" << std::endl;
+            return 1;
+        }
 
-    VkDescriptorSetLayout vk_compute_pass0_0_descriptor_set_layout;
-    if (vkCreateDescriptorSetLayout(vk_device, &vk_compute_pass0_0_descriptor_set_layout_create_info, nullptr, &vk_compute_pass0_0_descriptor_set_layout) != VK_SUCCESS) {
-        std::cerr << "Failed to create compute pass 0.0 descriptor set layout" << std::endl;
-        return 1;
+        std::memcpy(mapped, &uniforms, sizeof(Uniforms));
+        vkUnmapMemory(vk_device, uniform_heap.vk_heap_memory);
     }
 
-    VkPipelineLayoutCreateInfo vk_compute_pass0_0_pipeline_layout_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &vk_compute_pass0_0_descriptor_set_layout,
+    /* the gpu starts out with every row, as the cpu's share isn't known until the life kernel is tuned and timed */
+    HybridState hybrid_state = {
+        .vk_exchange_buffer = VK_NULL_HANDLE,
+        .exchange = nullptr,
+        .last_split = CELLULAR_AUTOMATA_GRID_HEIGHT,
+        .split = CELLULAR_AUTOMATA_GRID_HEIGHT,
+        .next_split = CELLULAR_AUTOMATA_GRID_HEIGHT,
+        .gpu_row_seconds = 0.0,
+        .cpu_row_seconds = 0.0,
     };
 
-    VkPipelineLayout vk_compute_pass0_0_pipeline_layout;
-    if (vkCreatePipelineLayout(vk_device, &vk_compute_pass0_0_pipeline_layout_create_info, nullptr, &vk_compute_pass0_0_pipeline_layout) != VK_SUCCESS) {
-        std::cerr << "Failed to create compute pass 0.0 pipeline layout" << std::endl;
+    std::fill(std::begin(hybrid_state.frame_splits), std::end(hybrid_state.frame_splits), CELLULAR_AUTOMATA_GRID_HEIGHT);
+
+    kvk::resource::MonoAllocationHeap exchange_heap = {};
+    if (hybrid) {
+        if (!life::create_grid(CELLULAR_AUTOMATA_GRID_WORDS, CELLULAR_AUTOMATA_GRID_HEIGHT, hybrid_state.grid)) {
+            std::cerr << "Failed to create the cpu grid" << std::endl;
+            return 1;
+        }
+
+        VkBufferCreateInfo vk_exchange_buffer_create_info = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = vk_cellular_automata_buffer_create_info.size,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        };
+
+        if (vkCreateBuffer(vk_device, &vk_exchange_buffer_create_info, nullptr, &hybrid_state.vk_exchange_buffer) != VK_SUCCESS) {
+            std::cerr << "Failed to create exchange buffer" << std::endl;
+            return 1;
+        }
+
+        if (kvk::resource::mono_alloc_for_residents(vk_device, {
+            .vk_physical_device = vk_physical_device,
+            .vk_minimum_heap_size = 0,
+            .vk_memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            .residents = {
+                {
+                    .vk_buffer = hybrid_state.vk_exchange_buffer,
+                },
+            },
+        }, exchange_heap) != VK_SUCCESS || kvk::resource::mono_bind_residents(vk_device, exchange_heap) != VK_SUCCESS) {
+            std::cerr << "Failed to allocate exchange heap" << std::endl;
+            return 1;
+        }
+
+        /* stays mapped until cleanup; coherent, so neither side flushes */
+        void* mapped;
+        VkDeviceSize vk_offset = exchange_heap.residents.at({ .vk_buffer = hybrid_state.vk_exchange_buffer, .is_image = false }).vk_heap_offset;
+        if (vkMapMemory(vk_device, exchange_heap.vk_heap_memory, vk_offset, vk_exchange_buffer_create_info.size, 0, &mapped) != VK_SUCCESS) {
+            std::cerr << "Failed to map exchange heap" << std::endl;
+            return 1;
+        }
+
+        hybrid_state.exchange = static_cast<uint32_t*>(mapped);
+    }
+
+    /* prepare for pipeline creation; layouts are deduplicated so sets stay compatible across pipelines */
+    kvk::layout::LayoutCache layout_cache;
+    kvk::layout::create_layout_cache({}, layout_cache);
+
+    /* load and compile shader; in-process compiles are memoized in shader_cache/ so warm starts skip dxc entirely */
+    kvk::shader::CompileCache shader_cache;
+    if (kvk::shader::create_compile_cache({ .directory = "shader_cache" }, shader_cache) != VK_SUCCESS) {
+        std::cerr << "Failed to create shader compile cache" << std::endl;
         return 1;
     }
 
-    /* load and compile shader */
-    std::vector<uint32_t> compute0_0_shader_spv(std::filesystem::file_size("cellular_automata.hlsl.bin") / sizeof(uint32_t));
+    std::vector<uint32_t> compute0_0_shader_spv;
+    std::vector<uint32_t> compact_shader_spv;
+    std::vector<uint32_t> render_shader_spv;
+#ifdef KVK_USE_DXC
+    std::string compute0_0_shader_source;
+    std::string compute0_0_shader_entry = "cellular_automata";
+    std::string compact_shader_entry = "compact_active_tiles";
+    std::string render_shader_entry = "render_cells";
     {
-        std::ifstream in("cellular_automata.hlsl.bin");
+        std::ifstream in(CELLULAR_AUTOMATA_SHADER_PATH);
         if (!in.good()) {
-            std::cerr << "Failed to open cellular_automata.hlsl.bin" << std::endl;
+            std::cerr << "Failed to open " << CELLULAR_AUTOMATA_SHADER_PATH << std::endl;
             return 1;
         }
 
-        in.read(reinterpret_cast<char*>(&compute0_0_shader_spv[0]), compute0_0_shader_spv.size() * sizeof(uint32_t));
-        in.close();
+        compute0_0_shader_source.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        std::pair<std::string const*, std::vector<uint32_t>*> const entries[] = {
+            { &compute0_0_shader_entry, &compute0_0_shader_spv },
+            { &compact_shader_entry, &compact_shader_spv },
+            { &render_shader_entry, &render_shader_spv },
+        };
+
+        for (auto const& [entry, spirv] : entries) {
+            if (kvk::shader::hlsl::compile_spirv({
+                .source = compute0_0_shader_source,
+                .entry = *entry,
+                .vk_shader_stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .defines = {},
+                .cache = &shader_cache,
+            }, *spirv) != VK_SUCCESS) {
+                std::cerr << "Failed to compile " << *entry << " from cellular_automata.hlsl" << std::endl;
+                return 1;
+            }
+        }
+    }
+#else
+    /* compiled by dxc and embedded at build time */
+    compute0_0_shader_spv.assign(std::begin(cellular_automata_spv), std::end(cellular_automata_spv));
+    compact_shader_spv.assign(std::begin(compact_active_tiles_spv), std::end(compact_active_tiles_spv));
+    render_shader_spv.assign(std::begin(render_cells_spv), std::end(render_cells_spv));
+#endif
+
+    /* layouts come from the shaders themselves, so they can't drift from their bindings; descriptors change every frame, so push them when the device can */
+    std::vector<kvk::shader::Reflection> compute_pass0_0_stage_reflections(3);
+    kvk::shader::Reflection compute_pass0_0_reflection;
+    if (kvk::shader::reflect(compute0_0_shader_spv, compute_pass0_0_stage_reflections[0]) != VK_SUCCESS || kvk::shader::reflect(compact_shader_spv, compute_pass0_0_stage_reflections[1]) != VK_SUCCESS || kvk::shader::reflect(render_shader_spv, compute_pass0_0_stage_reflections[2]) != VK_SUCCESS || kvk::shader::merge_reflections(compute_pass0_0_stage_reflections, compute_pass0_0_reflection) != VK_SUCCESS) {
+        std::cerr << "Failed to reflect cellular_automata.hlsl" << std::endl;
+        return 1;
     }
 
-    VkShaderModuleCreateInfo vk_compute_pass0_0_shader_module_create_info = {
-        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize = compute0_0_shader_spv.size() * sizeof(uint32_t),
-        .pCode = compute0_0_shader_spv.data(),
-    };
+    kvk::shader::Reflection const& life_reflection = compute_pass0_0_stage_reflections[0];
 
-    VkShaderModule vk_compute_pass0_0_shader_module;
-    if (vkCreateShaderModule(vk_device, &vk_compute_pass0_0_shader_module_create_info, nullptr, &vk_compute_pass0_0_shader_module) != VK_SUCCESS) {
-        std::cerr << "Failed to create compute pass 0.0 shader module" << std::endl;
+    bool push_descriptors = !descriptor_buffer && kvk::update::push_descriptors_supported(vk_device);
+    VkDescriptorSetLayoutCreateFlags vk_compute_pass0_0_set_flag = 0;
+    if (descriptor_buffer) {
+        vk_compute_pass0_0_set_flag = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+    } else if (push_descriptors) {
+        vk_compute_pass0_0_set_flag = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+    }
+
+    std::vector<VkDescriptorSetLayoutCreateFlags> vk_compute_pass0_0_set_flags = { vk_compute_pass0_0_set_flag };
+
+    kvk::shader::ReflectedLayouts compute_pass0_0_layouts;
+    if (kvk::shader::create_layouts(vk_device, layout_cache, {
+        .reflection = compute_pass0_0_reflection,
+        .vk_set_flags = vk_compute_pass0_0_set_flags,
+    }, compute_pass0_0_layouts) != VK_SUCCESS || compute_pass0_0_layouts.vk_descriptor_set_layouts.size() != 1) {
+        std::cerr << "Failed to create compute pass 0.0 layouts" << std::endl;
         return 1;
     }
 
-    /* setup compute pass 0.0 pipeline */
-    VkComputePipelineCreateInfo vk_compute_pass0_0_pipeline_create_info = {
+    VkDescriptorSetLayout vk_compute_pass0_0_descriptor_set_layout = compute_pass0_0_layouts.vk_descriptor_set_layouts[0];
+    VkPipelineLayout vk_compute_pass0_0_pipeline_layout = compute_pass0_0_layouts.vk_pipeline_layout;
+
+    /* pipelines are built against per-worker caches seeded from the last run, so warm starts skip backend compilation */
+    kvk::pipeline::PipelineCache pipeline_cache;
+    if (kvk::pipeline::create_pipeline_cache(vk_device, {
+        .vk_physical_device = vk_physical_device,
+        .path = "pipeline_cache.bin",
+        .thread_count = kvk::job::worker_count(jobs),
+        .save_interval = std::chrono::seconds(30),
+    }, pipeline_cache) != VK_SUCCESS) {
+        std::cerr << "Failed to create pipeline cache" << std::endl;
+        return 1;
+    }
+
+    VkShaderModule vk_compute_pass0_0_shader_module, vk_compact_shader_module, vk_render_shader_module;
+    if (kvk::shader::create_module(vk_device, compute0_0_shader_spv, vk_compute_pass0_0_shader_module) != VK_SUCCESS || kvk::shader::create_module(vk_device, compact_shader_spv, vk_compact_shader_module) != VK_SUCCESS || kvk::shader::create_module(vk_device, render_shader_spv, vk_render_shader_module) != VK_SUCCESS) {
+        std::cerr << "Failed to create compute pass 0.0 shader modules" << std::endl;
+        return 1;
+    }
+
+    /* workgroup shapes to tune between; the shader's own comes first, so an untuned device runs what the shader was written for */
+    std::vector<LifeVariant> life_variants = {
+        {
+            .label = std::to_string(life_reflection.workgroup_size[0]) + "x" + std::to_string(life_reflection.workgroup_size[1]),
+            .workgroup_size = { life_reflection.workgroup_size[0], life_reflection.workgroup_size[1] },
+            .defines = {},
+            .vk_shader_module = vk_compute_pass0_0_shader_module,
+        },
+    };
+
+    /* dxc can only put specialization constants in numthreads through LocalSizeId, which needs maintenance4; shapes are compiled as
+       defines instead, here with the compile cache making that a one-time cost, or by meson.build when there's no dxc to link */
+    {
+        VkPhysicalDeviceProperties vk_physical_device_properties;
+        vkGetPhysicalDeviceProperties(vk_physical_device, &vk_physical_device_properties);
+        VkPhysicalDeviceLimits const& vk_limits = vk_physical_device_properties.limits;
+
+#ifndef KVK_USE_DXC
+        /* mapped rather than read, and the modules are created straight from the mapping */
+        kvk::shader::Archive life_variant_archive;
+        if (kvk::shader::open_archive(CELLULAR_AUTOMATA_SHADER_ARCHIVE_PATH, life_variant_archive) != VK_SUCCESS) {
+            std::cerr << "Failed to open " << CELLULAR_AUTOMATA_SHADER_ARCHIVE_PATH << std::endl;
+            return 1;
+        }
+#endif
+
+        uint32_t const workgroup_shapes[][2] = { { 8, 8 }, { 16, 8 }, { 16, 16 }, { 32, 8 }, { 32, 16 }, { 64, 4 }, { 32, 32 } };
+        for (auto const& shape : workgroup_shapes) {
+            if (shape[0] == life_variants[0].workgroup_size[0] && shape[1] == life_variants[0].workgroup_size[1]) {
+                continue;
+            }
+
+            if (shape[0] * shape[1] > vk_limits.maxComputeWorkGroupInvocations || shape[0] > vk_limits.maxComputeWorkGroupSize[0] || shape[1] > vk_limits.maxComputeWorkGroupSize[1]) {
+                continue;
+            }
+
+            if (CELLULAR_AUTOMATA_GRID_WORDS % shape[0] != 0 || CELLULAR_AUTOMATA_GRID_HEIGHT % shape[1] != 0) {
+                continue;
+            }
+
+            /* a dispatch's generations must not reach past the neighbouring tiles, or skipping inactive tiles isn't exact */
+            if (shape[1] < CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH) {
+                continue;
+            }
+
+            std::vector<std::string> defines = {
+                "GROUP_DIMENSIONS_X=" + std::to_string(shape[0]),
+                "GROUP_DIMENSIONS_Y=" + std::to_string(shape[1]),
+            };
+
+            std::string label = std::to_string(shape[0]) + "x" + std::to_string(shape[1]);
+            VkShaderModule vk_shader_module;
+#ifdef KVK_USE_DXC
+            std::vector<uint32_t> spirv;
+            bool compiled = kvk::shader::hlsl::compile_spirv({
+                .source = compute0_0_shader_source,
+                .entry = compute0_0_shader_entry,
+                .vk_shader_stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .defines = defines,
+                .cache = &shader_cache,
+            }, spirv) == VK_SUCCESS && kvk::shader::create_module(vk_device, spirv, vk_shader_module) == VK_SUCCESS;
+#else
+            /* named as meson.build packs them */
+            bool compiled = kvk::shader::create_module(vk_device, life_variant_archive, "cellular_automata_" + label, vk_shader_module) == VK_SUCCESS;
+#endif
+
+            if (!compiled) {
+                std::cerr << "Skipping " << label << " life variant, it failed to compile" << std::endl;
+                continue;
+            }
+
+            life_variants.push_back({
+                .label = label,
+                .workgroup_size = { shape[0], shape[1] },
+                .defines = defines,
+                .vk_shader_module = vk_shader_module,
+            });
+        }
+
+#ifndef KVK_USE_DXC
+        kvk::shader::close_archive(life_variant_archive);
+#endif
+    }
+
+    /* setup compute pass 0.0 pipelines; every variant is built in one batch across the job workers */
+    kvk::shader::Specialization life_specialization;
+    kvk::shader::add_constant(life_specialization, 0, CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH);
+
+    VkPipelineCreateFlags vk_descriptor_pipeline_flags = descriptor_buffer ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
+
+    std::vector<VkComputePipelineCreateInfo> vk_compute_pipeline_create_infos;
+    for (LifeVariant const& life_variant : life_variants) {
+        vk_compute_pipeline_create_infos.push_back({
+            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .flags = vk_descriptor_pipeline_flags,
+            .stage = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = life_variant.vk_shader_module,
+                .pName = "cellular_automata",
+                .pSpecializationInfo = &life_specialization.vk_specialization_info,
+            },
+            .layout = vk_compute_pass0_0_pipeline_layout,
+        });
+    }
+
+    /* the compaction and render kernels follow the variants */
+    uint32_t compact_pipeline_index = static_cast<uint32_t>(vk_compute_pipeline_create_infos.size());
+    vk_compute_pipeline_create_infos.push_back({
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .flags = vk_descriptor_pipeline_flags,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = vk_compact_shader_module,
+            .pName = "compact_active_tiles",
+        },
+        .layout = vk_compute_pass0_0_pipeline_layout,
+    });
+
+    uint32_t render_pipeline_index = static_cast<uint32_t>(vk_compute_pipeline_create_infos.size());
+    vk_compute_pipeline_create_infos.push_back({
         .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .flags = VK_PIPELINE_CREATE_DISPATCH_BASE_BIT | vk_descriptor_pipeline_flags,
         .stage = {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
             .stage = VK_SHADER_STAGE_COMPUTE_BIT,
-            .module = vk_compute_pass0_0_shader_module,
-            .pName = "cellular_automata",
+            .module = vk_render_shader_module,
+            .pName = "render_cells",
         },
         .layout = vk_compute_pass0_0_pipeline_layout,
+    });
+
+    kvk::pipeline::PipelineBatch pipeline_batch;
+    kvk::pipeline::build(vk_device, jobs, pipeline_cache, {
+        .vk_compute_create_infos = vk_compute_pipeline_create_infos,
+        .vk_graphics_create_infos = {},
+        .vk_placeholders = {},
+    }, pipeline_batch);
+
+    /* nothing can run without these, so there is no placeholder to fall back on */
+    if (kvk::pipeline::wait(jobs, pipeline_batch) != VK_SUCCESS) {
+        std::cerr << "Failed to create compute pass 0.0 pipelines" << std::endl;
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < life_variants.size(); ++i) {
+        life_variants[i].vk_pipeline = kvk::pipeline::get(pipeline_batch, i);
+    }
+
+    VkPipeline vk_compact_pipeline = kvk::pipeline::get(pipeline_batch, compact_pipeline_index);
+    VkPipeline vk_render_pipeline = kvk::pipeline::get(pipeline_batch, render_pipeline_index);
+
+#ifdef KVK_USE_DXC
+    /* edits to cellular_automata.hlsl are recompiled in the background and swapped in between frames, so the simulation keeps running; layout changes still need a restart */
+    kvk::reload::Watcher shader_watcher;
+    if (kvk::reload::create_watcher(vk_device, { .cache = &shader_cache }, shader_watcher) != VK_SUCCESS) {
+        std::cerr << "Failed to start shader watcher" << std::endl;
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < life_variants.size(); ++i) {
+        LifeVariant& variant = life_variants[i];
+        variant.watch_id = kvk::reload::watch(shader_watcher, {
+            .path = CELLULAR_AUTOMATA_SHADER_PATH,
+            .entry = compute0_0_shader_entry,
+            .vk_shader_stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .defines = variant.defines,
+            .vk_compute_create_infos = { vk_compute_pipeline_create_infos[i] },
+            .vk_shader_module = variant.vk_shader_module,
+            .vk_pipelines = { variant.vk_pipeline },
+        });
+    }
+
+    uint32_t compact_watch_id = kvk::reload::watch(shader_watcher, {
+        .path = CELLULAR_AUTOMATA_SHADER_PATH,
+        .entry = compact_shader_entry,
+        .vk_shader_stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .defines = {},
+        .vk_compute_create_infos = { vk_compute_pipeline_create_infos[compact_pipeline_index] },
+        .vk_shader_module = vk_compact_shader_module,
+        .vk_pipelines = { vk_compact_pipeline },
+    });
+
+    uint32_t render_watch_id = kvk::reload::watch(shader_watcher, {
+        .path = CELLULAR_AUTOMATA_SHADER_PATH,
+        .entry = render_shader_entry,
+        .vk_shader_stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .defines = {},
+        .vk_compute_create_infos = { vk_compute_pipeline_create_infos[render_pipeline_index] },
+        .vk_shader_module = vk_render_shader_module,
+        .vk_pipelines = { vk_render_pipeline },
+    });
+#endif
+
+    /* time the variants on live frames until the fastest is known for this device; later runs pick it straight from tuning.txt */
+    kvk::tune::Tuner tuner;
+    kvk::tune::create_tuner({
+        .vk_physical_device = vk_physical_device,
+        .path = "tuning.txt",
+    }, tuner);
+
+    std::vector<std::string> life_variant_labels;
+    for (LifeVariant const& life_variant : life_variants) {
+        life_variant_labels.push_back(life_variant.label);
+    }
+
+    kvk::tune::TuneSession life_tune_session;
+    if (kvk::tune::begin_session(vk_device, tuner, {
+        .vk_physical_device = vk_physical_device,
+        .queue_family_index = queues.compute0_0.family_index,
+        .kernel = "cellular_automata_packed_k" + std::to_string(CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH),
+        .labels = life_variant_labels,
+        .frames_in_flight = FRAMES_IN_FLIGHT,
+        .keep_measuring = true,
+        .items_per_sample = static_cast<double>(CELLULAR_AUTOMATA_GRID_WIDTH) * CELLULAR_AUTOMATA_GRID_HEIGHT * CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH,
+    }, life_tune_session) != VK_SUCCESS) {
+        std::cerr << "Failed to start tuning the life kernel" << std::endl;
+        return 1;
+    }
+
+    LifeVariant const* life_variant = &life_variants[kvk::tune::variant(life_tune_session)];
+
+    /* setup descriptor sets; they are written per frame since the output image changes with every acquire, and their pools are reset whole */
+    std::vector<VkDescriptorPoolSize> vk_compute_pass0_0_descriptor_pool_sizes = kvk::shader::pool_sizes(compute_pass0_0_reflection, 0);
+
+    kvk::descriptor::DescriptorAllocator descriptor_allocator;
+    if (kvk::descriptor::create_descriptor_allocator({
+        .frames_in_flight = FRAMES_IN_FLIGHT,
+        .initial_sets_per_pool = 4,
+        .initial_sizes = vk_compute_pass0_0_descriptor_pool_sizes,
+    }, descriptor_allocator) != VK_SUCCESS) {
+        std::cerr << "Failed to create descriptor allocator" << std::endl;
+        return 1;
+    }
+
+    kvk::descriptor::register_layout(descriptor_allocator, vk_compute_pass0_0_descriptor_set_layout, vk_compute_pass0_0_descriptor_pool_sizes);
+
+    kvk::update::UpdateTemplate compute_pass0_0_update_template;
+    if (kvk::update::create_update_template<ComputePass0_0Descriptors>(vk_device, {
+        .vk_descriptor_set_layout = vk_compute_pass0_0_descriptor_set_layout,
+        .push = push_descriptors,
+        .vk_pipeline_bind_point = VK_PIPELINE_BIND_POINT_COMPUTE,
+        .vk_pipeline_layout = vk_compute_pass0_0_pipeline_layout,
+        .set = 0,
+        .entries = {
+            KVK_UPDATE_ENTRY(ComputePass0_0Descriptors, input_grid, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            KVK_UPDATE_ENTRY(ComputePass0_0Descriptors, output_grid, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            KVK_UPDATE_ENTRY(ComputePass0_0Descriptors, uniforms, 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
+            KVK_UPDATE_ENTRY(ComputePass0_0Descriptors, output_image, 3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE),
+            KVK_UPDATE_ENTRY(ComputePass0_0Descriptors, tile_flags, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            KVK_UPDATE_ENTRY(ComputePass0_0Descriptors, active_tiles, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            KVK_UPDATE_ENTRY(ComputePass0_0Descriptors, dispatch_args, 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+        },
+    }, compute_pass0_0_update_template) != VK_SUCCESS) {
+        std::cerr << "Failed to create compute pass 0.0 descriptor update template" << std::endl;
+        return 1;
+    }
+
+    /* --descriptor-buffer: one set per frame, written into a ring of host visible descriptor memory */
+    kvk::descriptor_buffer::DescriptorBufferHeap descriptor_buffer_heap;
+    kvk::descriptor_buffer::DescriptorBufferLayout compute_pass0_0_descriptor_buffer_layout;
+    if (descriptor_buffer) {
+        std::vector<uint32_t> compute_pass0_0_bindings;
+        for (kvk::shader::ReflectedBinding const& binding : compute_pass0_0_reflection.bindings) {
+            if (binding.set == 0) {
+                compute_pass0_0_bindings.push_back(binding.binding);
+            }
+        }
+
+        if (kvk::descriptor_buffer::create_descriptor_buffer_heap(vk_device, {
+            .vk_physical_device = vk_physical_device,
+            .vk_size_per_frame = 64 * 1024,
+            .frames_in_flight = FRAMES_IN_FLIGHT,
+            .samplers = false,
+        }, descriptor_buffer_heap) != VK_SUCCESS || kvk::descriptor_buffer::get_layout(vk_device, descriptor_buffer_heap, vk_compute_pass0_0_descriptor_set_layout, compute_pass0_0_bindings, compute_pass0_0_descriptor_buffer_layout) != VK_SUCCESS) {
+            std::cerr << "Failed to create compute pass 0.0 descriptor buffer" << std::endl;
+            return 1;
+        }
+    }
+
+    /* setup frame synchronization */
+    VkSemaphoreCreateInfo vk_semaphore_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
     };
 
-    VkPipeline vk_compute_pass0_0_pipeline;
-    if (vkCreateComputePipelines(vk_device, nullptr, 1, &vk_compute_pass0_0_pipeline_create_info, nullptr, &vk_compute_pass0_0_pipeline) != VK_SUCCESS) {
-        std::cerr << "Failed to create compute pass 0.0 pipeline" << std::endl;
+    VkSemaphore vk_image_acquired_semaphores[FRAMES_IN_FLIGHT];
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        if (vkCreateSemaphore(vk_device, &vk_semaphore_create_info, nullptr, &vk_image_acquired_semaphores[i]) != VK_SUCCESS) {
+            std::cerr << "Failed to create image acquired semaphore " << i << std::endl;
+            return 1;
+        }
+    }
+
+    /* one per backbuffer since a present may still be waiting on it when the next frame is submitted */
+    std::vector<VkSemaphore> vk_render_finished_semaphores(vk_swapchain_backbuffers.size());
+    for (uint32_t i = 0; i < vk_render_finished_semaphores.size(); ++i) {
+        if (vkCreateSemaphore(vk_device, &vk_semaphore_create_info, nullptr, &vk_render_finished_semaphores[i]) != VK_SUCCESS) {
+            std::cerr << "Failed to create render finished semaphore " << i << std::endl;
+            return 1;
+        }
+    }
+
+    /* setup frame graph; barriers are derived once here, only the backbuffer changes between frames */
+    VkImageSubresourceRange vk_color_subresource_range = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = 1,
+    };
+
+    /* the acquire semaphore is waited on at the first stage that touches the backbuffer */
+    VkPipelineStageFlags2 vk_backbuffer_wait_stage = direct_backbuffer_writes ? VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+
+    kvk::graph::Graph frame_graph = {};
+    kvk::graph::ResourceID cellular_automata_input_resource = kvk::graph::import_buffer(frame_graph, vk_cellular_automata_buffer0, {
+        .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .vk_access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+    }, std::nullopt);
+
+    kvk::graph::ResourceID cellular_automata_output_resource = kvk::graph::import_buffer(frame_graph, vk_cellular_automata_buffer1, {
+        .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .vk_access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+    }, std::nullopt);
+
+    /* last frame's compaction wrote these */
+    kvk::graph::ResourceID tile_flags_resource = kvk::graph::import_buffer(frame_graph, vk_tile_flags_buffer, {
+        .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .vk_access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+    }, std::nullopt);
+
+    kvk::graph::ResourceID active_tiles_resource = kvk::graph::import_buffer(frame_graph, vk_active_tiles_buffer, {
+        .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .vk_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+    }, std::nullopt);
+
+    kvk::graph::ResourceID dispatch_args_resource = kvk::graph::import_buffer(frame_graph, vk_dispatch_args_buffer, {
+        .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .vk_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+    }, std::nullopt);
+
+    kvk::graph::ResourceID backbuffer_resource = kvk::graph::import_image(frame_graph, VK_NULL_HANDLE, vk_color_subresource_range, {
+        .vk_stages = vk_backbuffer_wait_stage,
+        .vk_access = 0,
+        .vk_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+    }, kvk::graph::ResourceState {
+        .vk_stages = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
+        .vk_access = 0,
+        .vk_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+    });
+
+    /* render_cells runs over every pixel of whatever it draws into */
+    VkExtent2D render_extent = direct_backbuffer_writes ? swapchain_returns.vk_current_extent : VkExtent2D { CELLULAR_AUTOMATA_GRID_WIDTH, CELLULAR_AUTOMATA_GRID_HEIGHT };
+
+    LifePassState life_pass_state = {
+        .vk_device = vk_device,
+        .jobs = &jobs,
+        .recycler = &command_recycler,
+        .tune_session = &life_tune_session,
+        .hybrid = hybrid ? &hybrid_state : nullptr,
+        .frame_index = 0,
+        .compute = {
+            .vk_pipeline = life_variant->vk_pipeline,
+            .vk_compact_pipeline = vk_compact_pipeline,
+            .vk_render_pipeline = vk_render_pipeline,
+            .vk_pipeline_layout = vk_compute_pass0_0_pipeline_layout,
+            .push_template = push_descriptors ? &compute_pass0_0_update_template : nullptr,
+            .descriptor_buffer_heap = descriptor_buffer ? &descriptor_buffer_heap : nullptr,
+            .descriptors = {
+                .input_grid = {
+                    .buffer = vk_cellular_automata_buffer0,
+                    .offset = 0,
+                    .range = VK_WHOLE_SIZE,
+                },
+                .output_grid = {
+                    .buffer = vk_cellular_automata_buffer1,
+                    .offset = 0,
+                    .range = VK_WHOLE_SIZE,
+                },
+                .output_image = {
+                    .imageView = vk_cellular_automata_render_image_view,
+                    .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+                },
+                .uniforms = {
+                    .buffer = vk_uniform_buffer,
+                    .offset = 0,
+                    .range = VK_WHOLE_SIZE,
+                },
+                .tile_flags = {
+                    .buffer = vk_tile_flags_buffer,
+                    .offset = 0,
+                    .range = VK_WHOLE_SIZE,
+                },
+                .active_tiles = {
+                    .buffer = vk_active_tiles_buffer,
+                    .offset = 0,
+                    .range = VK_WHOLE_SIZE,
+                },
+                .dispatch_args = {
+                    .buffer = vk_dispatch_args_buffer,
+                    .offset = 0,
+                    .range = VK_WHOLE_SIZE,
+                },
+            },
+            .step = {},
+            .band_tiles_y = 0,
+            .vk_dispatch_args = vk_dispatch_args_buffer,
+            .group_count_x = (render_extent.width + CELLULAR_AUTOMATA_RENDER_GROUP_SIZE - 1) / CELLULAR_AUTOMATA_RENDER_GROUP_SIZE,
+            .group_count_y = (render_extent.height + CELLULAR_AUTOMATA_RENDER_GROUP_SIZE - 1) / CELLULAR_AUTOMATA_RENDER_GROUP_SIZE,
+        },
+    };
+
+    /* the graph moves the render image to TRANSFER_SRC and the backbuffer to TRANSFER_DST around the blit pass */
+    kvk::present::BackbufferBlitInfo blit_info = {
+        .vk_source_image = vk_cellular_automata_render_image,
+        .vk_source_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .vk_source_extent = { CELLULAR_AUTOMATA_GRID_WIDTH, CELLULAR_AUTOMATA_GRID_HEIGHT },
+        .vk_backbuffer = VK_NULL_HANDLE,
+        .vk_backbuffer_extent = swapchain_returns.vk_current_extent,
+        .vk_filter = VK_FILTER_NEAREST,
+    };
+
+    /* the cpu's band from last dispatch goes into the grid the gpu steps from; the host wrote it before submitting */
+    kvk::graph::ResourceID exchange_resource = 0;
+    if (hybrid) {
+        exchange_resource = kvk::graph::import_buffer(frame_graph, hybrid_state.vk_exchange_buffer, {
+            .vk_stages = VK_PIPELINE_STAGE_2_HOST_BIT,
+            .vk_access = VK_ACCESS_2_HOST_WRITE_BIT,
+        }, kvk::graph::ResourceState {
+            .vk_stages = VK_PIPELINE_STAGE_2_HOST_BIT,
+            .vk_access = VK_ACCESS_2_HOST_READ_BIT,
+        });
+
+        kvk::graph::add_pass(frame_graph, {
+            .name = "exchange in",
+            .reads = {
+                { .resource = exchange_resource, .vk_stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT, .vk_access = VK_ACCESS_2_TRANSFER_READ_BIT },
+            },
+            .writes = {
+                { .resource = cellular_automata_input_resource, .vk_stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT, .vk_access = VK_ACCESS_2_TRANSFER_WRITE_BIT },
+            },
+            .record = [](VkCommandBuffer vk_command_buffer, void* pdata) {
+                LifePassState const& state = *reinterpret_cast<LifePassState*>(pdata);
+                cmd_copy_rows(vk_command_buffer, state.hybrid->vk_exchange_buffer, state.compute.descriptors.input_grid.buffer, { state.hybrid->last_split, CELLULAR_AUTOMATA_GRID_HEIGHT });
+            },
+            .pdata = &life_pass_state,
+        });
+    }
+
+    /* only the tiles the last compaction found active are stepped, straight from its indirect arguments */
+    kvk::graph::add_pass(frame_graph, {
+        .name = "life",
+        .reads = {
+            { .resource = cellular_automata_input_resource, .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, .vk_access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT },
+            { .resource = active_tiles_resource, .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, .vk_access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT },
+            { .resource = dispatch_args_resource, .vk_stages = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, .vk_access = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT },
+        },
+        .writes = {
+            { .resource = cellular_automata_output_resource, .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, .vk_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT },
+            { .resource = tile_flags_resource, .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, .vk_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT },
+        },
+        .record = [](VkCommandBuffer vk_command_buffer, void* pdata) {
+            LifePassState& state = *reinterpret_cast<LifePassState*>(pdata);
+            kvk::tune::cmd_begin(vk_command_buffer, *state.tune_session, state.frame_index);
+            cmd_bind_compute(vk_command_buffer, state.compute, state.compute.vk_pipeline);
+            if (state.compute.step.all_tiles != 0) {
+                vkCmdDispatch(vk_command_buffer, state.compute.step.tiles_x * state.compute.band_tiles_y, 1, 1);
+            } else {
+                vkCmdDispatchIndirect(vk_command_buffer, state.compute.vk_dispatch_args, 0);
+            }
+
+            kvk::tune::cmd_end(vk_command_buffer, *state.tune_session, state.frame_index);
+        },
+        .pdata = &life_pass_state,
+    });
+
+    /* the gpu rows the cpu reads next dispatch go down; the host reads them once this frame has retired */
+    if (hybrid) {
+        kvk::graph::add_pass(frame_graph, {
+            .name = "exchange out",
+            .reads = {
+                { .resource = cellular_automata_output_resource, .vk_stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT, .vk_access = VK_ACCESS_2_TRANSFER_READ_BIT },
+            },
+            .writes = {
+                { .resource = exchange_resource, .vk_stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT, .vk_access = VK_ACCESS_2_TRANSFER_WRITE_BIT },
+            },
+            .side_effects = true,
+            .record = [](VkCommandBuffer vk_command_buffer, void* pdata) {
+                LifePassState const& state = *reinterpret_cast<LifePassState*>(pdata);
+                for (RowRange rows : hybrid_edge_rows(state.hybrid->split, state.hybrid->next_split)) {
+                    cmd_copy_rows(vk_command_buffer, state.compute.descriptors.output_grid.buffer, state.hybrid->vk_exchange_buffer, rows);
+                }
+            },
+            .pdata = &life_pass_state,
+        });
+    }
+
+    /* builds next frame's active tile list and indirect arguments from the flags the life pass just wrote */
+    kvk::graph::add_pass(frame_graph, {
+        .name = "compact",
+        .reads = {
+            { .resource = tile_flags_resource, .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, .vk_access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT },
+        },
+        .writes = {
+            { .resource = active_tiles_resource, .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, .vk_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT },
+            { .resource = dispatch_args_resource, .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, .vk_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT },
+        },
+        .record = [](VkCommandBuffer vk_command_buffer, void* pdata) {
+            LifePassState const& state = *reinterpret_cast<LifePassState*>(pdata);
+
+            /* the cpu's rows change under the gpu's tiles every dispatch, so hybrid mode steps every tile of its band */
+            if (state.hybrid != nullptr) {
+                return;
+            }
+
+            cmd_bind_compute(vk_command_buffer, state.compute, state.compute.vk_compact_pipeline);
+            vkCmdDispatch(vk_command_buffer, 1, 1, 1);
+        },
+        .pdata = &life_pass_state,
+    });
+
+    /* the render image is fully overwritten every frame, so its contents are dropped; last frame's blit still has to finish reading it */
+    kvk::graph::ResourceID render_target_resource = backbuffer_resource;
+    if (!direct_backbuffer_writes) {
+        render_target_resource = kvk::graph::import_image(frame_graph, vk_cellular_automata_render_image, vk_color_subresource_range, {
+            .vk_stages = VK_PIPELINE_STAGE_2_BLIT_BIT,
+            .vk_access = VK_ACCESS_2_TRANSFER_READ_BIT,
+            .vk_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+        }, std::nullopt);
+    }
+
+    /* every pixel is drawn, skipped tiles included; each worker records a band of workgroup rows into its own secondary, executed in row order */
+    kvk::graph::add_pass(frame_graph, {
+        .name = "render",
+        .reads = {
+            { .resource = cellular_automata_output_resource, .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, .vk_access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT },
+        },
+        .writes = {
+            { .resource = render_target_resource, .vk_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, .vk_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, .vk_layout = VK_IMAGE_LAYOUT_GENERAL },
+        },
+        .record = [](VkCommandBuffer vk_command_buffer, void* pdata) {
+            LifePassState& state = *reinterpret_cast<LifePassState*>(pdata);
+            state.vk_result = kvk::command::record_parallel(state.vk_device, *state.jobs, *state.recycler, {
+                .vk_primary = vk_command_buffer,
+                .item_count = state.compute.group_count_y,
+                .vk_usage_flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                .record = [](VkCommandBuffer vk_secondary, uint32_t begin, uint32_t end, void* pdata) {
+                    ComputeRecordState const& state = *reinterpret_cast<ComputeRecordState*>(pdata);
+                    cmd_bind_compute(vk_secondary, state, state.vk_render_pipeline);
+                    vkCmdDispatchBase(vk_secondary, 0, begin, 0, state.group_count_x, end - begin, 1);
+                },
+                .pdata = &state.compute,
+            });
+        },
+        .pdata = &life_pass_state,
+    });
+
+    if (!direct_backbuffer_writes) {
+        kvk::graph::add_pass(frame_graph, {
+            .name = "blit",
+            .reads = {
+                { .resource = render_target_resource, .vk_stages = VK_PIPELINE_STAGE_2_BLIT_BIT, .vk_access = VK_ACCESS_2_TRANSFER_READ_BIT, .vk_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
+            },
+            .writes = {
+                { .resource = backbuffer_resource, .vk_stages = VK_PIPELINE_STAGE_2_BLIT_BIT, .vk_access = VK_ACCESS_2_TRANSFER_WRITE_BIT, .vk_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+            },
+            .record = [](VkCommandBuffer vk_command_buffer, void* pdata) {
+                kvk::present::cmd_blit_to_backbuffer(vk_command_buffer, *reinterpret_cast<kvk::present::BackbufferBlitInfo*>(pdata));
+            },
+            .pdata = &blit_info,
+        });
+    }
+
+    if (kvk::graph::compile(vk_device, vk_physical_device, frame_graph) != VK_SUCCESS) {
+        std::cerr << "Failed to compile frame graph" << std::endl;
         return 1;
     }
 
-    /* setup descriptor sets */
+    std::cout << "Frame graph: " << frame_graph.statistics.pipeline_barriers << " pipeline barriers (" << frame_graph.statistics.image_barriers << " image), " << frame_graph.statistics.dropped_transitions << " redundant dropped, " << frame_graph.statistics.culled_passes << " passes culled" << std::endl;
+
+    /* frames retire when the scheduler's timeline passes their work */
+    std::optional<kvk::scheduler::WorkHandle> frame_work[FRAMES_IN_FLIGHT];
+
+    /* anything retired at runtime goes through here instead of waiting for the device to idle */
+    kvk::deletion::DeletionQueue deletion_queue;
+
+    uint64_t frame_number = 0;
+    uint64_t dispatches_submitted = 0;
 
     bool running = true;
     SDL_Event sdl_event;
@@ -555,35 +1575,441 @@ int main() {
                 break;
             }
         }
+
+        if (!running) {
+            break;
+        }
+
+        /* record and submit frame */
+        uint32_t frame_index = static_cast<uint32_t>(frame_number++ % FRAMES_IN_FLIGHT);
+        if (frame_work[frame_index].has_value()) {
+            kvk::scheduler::wait(vk_device, scheduler, frame_work[frame_index].value(), std::numeric_limits<uint64_t>::max());
+        }
+
+        /* both sides of a hybrid dispatch read what the other wrote in the last one */
+        kvk::scheduler::WorkHandle last_work = frame_work[(frame_index + FRAMES_IN_FLIGHT - 1) % FRAMES_IN_FLIGHT].value_or(kvk::scheduler::WorkHandle {});
+        if (hybrid && frame_work[(frame_index + FRAMES_IN_FLIGHT - 1) % FRAMES_IN_FLIGHT].has_value()) {
+            kvk::scheduler::wait(vk_device, scheduler, last_work, std::numeric_limits<uint64_t>::max());
+        }
+
+        kvk::deletion::collect(vk_device, scheduler, deletion_queue);
+        kvk::pipeline::save_if_due(vk_device, pipeline_cache);
+
+        /* a rebuilt kernel may step differently, so the active tile list can't be trusted across a reload */
+        bool step_all_tiles = false;
+
+#ifdef KVK_USE_DXC
+        /* the replaced pipelines are destroyed once the most recently submitted frame is done with them */
+        if (kvk::reload::apply(shader_watcher, deletion_queue, last_work) > 0) {
+            for (LifeVariant& variant : life_variants) {
+                variant.vk_pipeline = kvk::reload::pipeline(shader_watcher, variant.watch_id, 0);
+            }
+
+            life_pass_state.compute.vk_compact_pipeline = kvk::reload::pipeline(shader_watcher, compact_watch_id, 0);
+            life_pass_state.compute.vk_render_pipeline = kvk::reload::pipeline(shader_watcher, render_watch_id, 0);
+            step_all_tiles = true;
+        }
+#endif
+
+        /* this frame's previous timestamps are complete after the wait; switch to whichever variant is measured (or chosen) next */
+        kvk::tune::collect(vk_device, tuner, life_tune_session, frame_index);
+        life_variant = &life_variants[kvk::tune::variant(life_tune_session)];
+        life_pass_state.frame_index = frame_index;
+        life_pass_state.compute.vk_pipeline = life_variant->vk_pipeline;
+
+        if (hybrid) {
+            double gpu_seconds;
+            if (kvk::tune::latest_seconds(life_tune_session, gpu_seconds)) {
+                hybrid_state.gpu_row_seconds = smooth(hybrid_state.gpu_row_seconds, gpu_seconds / hybrid_state.frame_splits[frame_index]);
+            }
+
+            /* the gpu rows the cpu's band needs come down, the band itself goes up for the gpu to copy into place */
+            for (RowRange rows : hybrid_edge_rows(hybrid_state.last_split, hybrid_state.split)) {
+                copy_rows(hybrid_state.grid.words.data(), hybrid_state.exchange, rows);
+            }
+
+            copy_rows(hybrid_state.exchange, hybrid_state.grid.words.data(), { hybrid_state.last_split, CELLULAR_AUTOMATA_GRID_HEIGHT });
+
+            /* next dispatch is split so both sides should take as long, in whole tile rows with at least one on either side. tuning
+               times every variant over the whole grid, so the cpu only joins in once it is done */
+            hybrid_state.next_split = CELLULAR_AUTOMATA_GRID_HEIGHT;
+            if (life_tune_session.done) {
+                uint32_t tile_rows = life_variant->workgroup_size[1];
+                double gpu_share = 0.5;
+                if (hybrid_state.gpu_row_seconds > 0.0 && hybrid_state.cpu_row_seconds > 0.0) {
+                    gpu_share = hybrid_state.cpu_row_seconds / (hybrid_state.gpu_row_seconds + hybrid_state.cpu_row_seconds);
+                }
+
+                uint32_t split = static_cast<uint32_t>(gpu_share * CELLULAR_AUTOMATA_GRID_HEIGHT / tile_rows + 0.5) * tile_rows;
+                hybrid_state.next_split = std::clamp<uint32_t>(split, tile_rows, CELLULAR_AUTOMATA_GRID_HEIGHT - tile_rows);
+            }
+
+            hybrid_state.frame_splits[frame_index] = hybrid_state.split;
+        }
+
+        /* one dispatch per frame, ping-ponging between the grid buffers; the graph's barriers are per role, so only the buffers move */
+        uint64_t dispatch = frame_number - 1;
+        VkBuffer vk_input_grid = dispatch % 2 == 0 ? vk_cellular_automata_buffer0 : vk_cellular_automata_buffer1;
+        VkBuffer vk_output_grid = dispatch % 2 == 0 ? vk_cellular_automata_buffer1 : vk_cellular_automata_buffer0;
+        life_pass_state.compute.step.generation = static_cast<uint32_t>(std::min<uint64_t>(dispatch * CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH, UINT32_MAX));
+        life_pass_state.compute.descriptors.input_grid.buffer = vk_input_grid;
+        life_pass_state.compute.descriptors.output_grid.buffer = vk_output_grid;
+        kvk::graph::set_buffer(frame_graph, cellular_automata_input_resource, vk_input_grid);
+        kvk::graph::set_buffer(frame_graph, cellular_automata_output_resource, vk_output_grid);
+
+        /* tiles are workgroups, so a different shape invalidates last frame's flags and active list; the seed has none to begin with.
+           while tuning, every variant steps every tile, so each is timed on the same workload rather than on however much is still active */
+        uint32_t tiles_x = CELLULAR_AUTOMATA_GRID_WORDS / life_variant->workgroup_size[0];
+        uint32_t tiles_y = CELLULAR_AUTOMATA_GRID_HEIGHT / life_variant->workgroup_size[1];
+        step_all_tiles = step_all_tiles || hybrid || !life_tune_session.done || dispatch == 0 || tiles_x != life_pass_state.compute.step.tiles_x || tiles_y != life_pass_state.compute.step.tiles_y;
+        life_pass_state.compute.step.tiles_x = tiles_x;
+        life_pass_state.compute.step.tiles_y = tiles_y;
+        life_pass_state.compute.step.all_tiles = step_all_tiles ? 1 : 0;
+        life_pass_state.compute.band_tiles_y = hybrid ? hybrid_state.split / life_variant->workgroup_size[1] : tiles_y;
+
+        if (dispatch % 600 == 599 && hybrid) {
+            /* a dispatch takes as long as the slower side */
+            double seconds = std::max(hybrid_state.split * hybrid_state.gpu_row_seconds, (CELLULAR_AUTOMATA_GRID_HEIGHT - hybrid_state.split) * hybrid_state.cpu_row_seconds);
+            if (seconds > 0.0) {
+                double cell_updates = static_cast<double>(CELLULAR_AUTOMATA_GRID_WIDTH) * CELLULAR_AUTOMATA_GRID_HEIGHT * CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH / seconds;
+                std::cout << "Life: " << cell_updates / 1e9 << " G cell-updates/s (" << life_variant->label << " on " << hybrid_state.split << " rows, cpu " << life::simd_path() << " on " << CELLULAR_AUTOMATA_GRID_HEIGHT - hybrid_state.split << ")" << std::endl;
+            }
+        } else if (dispatch % 600 == 599) {
+            /* skipped tiles count as updated, so this is the full-grid rate the same time would buy */
+            double cell_updates = kvk::tune::throughput(life_tune_session);
+            if (cell_updates > 0.0) {
+                std::cout << "Life: " << cell_updates / 1e9 << " G cell-updates/s (" << life_variant->label << ")" << std::endl;
+            }
+        }
+
+        uint32_t image_index;
+        VkResult vk_result = vkAcquireNextImageKHR(vk_device, vk_swapchain, std::numeric_limits<uint64_t>::max(), vk_image_acquired_semaphores[frame_index], VK_NULL_HANDLE, &image_index);
+        if (vk_result != VK_SUCCESS && vk_result != VK_SUBOPTIMAL_KHR) {
+            std::cerr << "Failed to acquire swapchain image (" << vk_result << ")" << std::endl;
+            break;
+        }
+
+        kvk::present::mark_acquired(latency_telemetry);
+
+        /* the timeline wait above retired this frame's previous use, so its pools can be reset whole */
+        VkCommandBuffer vk_command_buffer;
+        if (kvk::command::begin_frame(vk_device, command_recycler, frame_index) != VK_SUCCESS || kvk::command::acquire_command_buffer(vk_device, command_recycler, 0, VK_COMMAND_BUFFER_LEVEL_PRIMARY, vk_command_buffer) != VK_SUCCESS) {
+            std::cerr << "Failed to get a command buffer for frame " << frame_index << std::endl;
+            break;
+        }
+
+        VkCommandBufferBeginInfo vk_command_buffer_begin_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        };
+
+        vkBeginCommandBuffer(vk_command_buffer, &vk_command_buffer_begin_info);
+
+        if (direct_backbuffer_writes) {
+            life_pass_state.compute.descriptors.output_image.imageView = vk_swapchain_backbuffer_views[image_index];
+        }
+
+        if (descriptor_buffer) {
+            kvk::descriptor_buffer::begin_frame(descriptor_buffer_heap, frame_index);
+            if (kvk::descriptor_buffer::allocate(descriptor_buffer_heap, compute_pass0_0_descriptor_buffer_layout, life_pass_state.compute.descriptor_buffer_set) != VK_SUCCESS) {
+                std::cerr << "Failed to allocate compute pass 0.0 descriptor buffer set for frame " << frame_index << std::endl;
+                break;
+            }
+
+            write_descriptor_buffer_set(vk_device, descriptor_buffer_heap, compute_pass0_0_descriptor_buffer_layout, life_pass_state.compute);
+        } else if (!push_descriptors) {
+            if (kvk::descriptor::begin_frame(vk_device, descriptor_allocator, frame_index) != VK_SUCCESS || kvk::descriptor::allocate(vk_device, descriptor_allocator, vk_compute_pass0_0_descriptor_set_layout, life_pass_state.compute.vk_descriptor_set) != VK_SUCCESS) {
+                std::cerr << "Failed to allocate compute pass 0.0 descriptor set for frame " << frame_index << std::endl;
+                break;
+            }
+
+            kvk::update::update_set(vk_device, compute_pass0_0_update_template, life_pass_state.compute.vk_descriptor_set, life_pass_state.compute.descriptors);
+        }
+
+        kvk::graph::set_image(frame_graph, backbuffer_resource, vk_swapchain_backbuffers[image_index]);
+        blit_info.vk_backbuffer = vk_swapchain_backbuffers[image_index];
+
+        kvk::graph::execute(frame_graph, vk_command_buffer);
+        if (life_pass_state.vk_result != VK_SUCCESS) {
+            std::cerr << "Failed to record compute pass 0.0" << std::endl;
+            break;
+        }
+
+        vkEndCommandBuffer(vk_command_buffer);
+
+        kvk::scheduler::WorkHandle work;
+        if (kvk::scheduler::enqueue(scheduler, {
+            .vk_required_flags = direct_backbuffer_writes ? VK_QUEUE_COMPUTE_BIT : VK_QUEUE_GRAPHICS_BIT,
+            .requires_present = true,
+            .family_index = queues.compute0_0.family_index,
+            .vk_command_buffers = { vk_command_buffer },
+            .vk_wait_semaphores = {
+                {
+                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                    .semaphore = vk_image_acquired_semaphores[frame_index],
+                    .stageMask = vk_backbuffer_wait_stage,
+                },
+            },
+            .vk_signal_semaphores = {
+                {
+                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                    .semaphore = vk_render_finished_semaphores[image_index],
+                    .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                },
+            },
+        }, work) != VK_SUCCESS || kvk::scheduler::flush(scheduler) != VK_SUCCESS) {
+            std::cerr << "Failed to submit frame" << std::endl;
+            break;
+        }
+
+        kvk::present::mark_submitted(latency_telemetry);
+        frame_work[frame_index] = work;
+
+        /* the cpu steps its band while the gpu works through the rest */
+        if (hybrid) {
+            if (hybrid_state.split < CELLULAR_AUTOMATA_GRID_HEIGHT) {
+                auto begin = std::chrono::steady_clock::now();
+                life::run_rows(jobs, hybrid_state.grid, CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH, hybrid_state.split, CELLULAR_AUTOMATA_GRID_HEIGHT, CELLULAR_AUTOMATA_CPU_BAND_ROWS);
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                hybrid_state.cpu_row_seconds = smooth(hybrid_state.cpu_row_seconds, seconds / (CELLULAR_AUTOMATA_GRID_HEIGHT - hybrid_state.split));
+            }
+
+            hybrid_state.last_split = hybrid_state.split;
+            hybrid_state.split = hybrid_state.next_split;
+        }
+
+        VkPresentInfoKHR vk_present_info = {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &vk_render_finished_semaphores[image_index],
+            .swapchainCount = 1,
+            .pSwapchains = &vk_swapchain,
+            .pImageIndices = &image_index,
+        };
+
+        vk_result = kvk::scheduler::queue_present(scheduler, work.queue, vk_present_info, &latency_telemetry);
+        if (vk_result != VK_SUCCESS && vk_result != VK_SUBOPTIMAL_KHR) {
+            std::cerr << "Failed to present swapchain image (" << vk_result << ")" << std::endl;
+            break;
+        }
+
+        /* never blocks; frames not yet displayed are picked up on a later frame */
+        kvk::present::poll_displayed(latency_telemetry, 0);
+        if (dispatch % 600 == 599) {
+            kvk::present::LatencyReport latency_report;
+            kvk::present::get_latency_report(latency_telemetry, latency_report);
+            std::cout << "Present latency over " << latency_report.sample_count << " frames: p50 " << latency_report.end_to_end.p50_ns / 1e6 << " ms, p90 " << latency_report.end_to_end.p90_ns / 1e6 << " ms, p99 " << latency_report.end_to_end.p99_ns / 1e6 << " ms (acquire to " << (latency_telemetry.vk_wait_for_present_khr != nullptr ? "display" : "present") << ")" << std::endl;
+        }
+
+        if (++dispatches_submitted == validate_dispatches) {
+            break;
+        }
+    }
+
+    /* every submission goes through the scheduler, so its timelines cover all outstanding GPU work */
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        if (frame_work[i].has_value()) {
+            kvk::scheduler::wait(vk_device, scheduler, frame_work[i].value(), std::numeric_limits<uint64_t>::max());
+        }
+    }
+
+    kvk::deletion::drain(vk_device, scheduler, deletion_queue);
+
+    /* read back the grid the last dispatch wrote and compare it with the cpu engine stepped as many generations */
+    int exit_code = 0;
+    if (validate_dispatches > 0 && dispatches_submitted > 0) {
+        VkBuffer vk_last_output_grid = (dispatches_submitted - 1) % 2 == 0 ? vk_cellular_automata_buffer1 : vk_cellular_automata_buffer0;
+        VkDeviceSize vk_grid_size = vk_cellular_automata_buffer_create_info.size;
+
+        VkBufferCreateInfo vk_readback_buffer_create_info = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = vk_grid_size,
+            .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        };
+
+        VkBuffer vk_readback_buffer;
+        if (vkCreateBuffer(vk_device, &vk_readback_buffer_create_info, nullptr, &vk_readback_buffer) != VK_SUCCESS) {
+            std::cerr << "Failed to create readback buffer" << std::endl;
+            return 1;
+        }
+
+        kvk::resource::MonoAllocationHeap readback_heap;
+        if (kvk::resource::mono_alloc_for_residents(vk_device, {
+            .vk_physical_device = vk_physical_device,
+            .vk_minimum_heap_size = 0,
+            .vk_memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            .residents = {
+                {
+                    .vk_buffer = vk_readback_buffer,
+                },
+            },
+        }, readback_heap) != VK_SUCCESS || kvk::resource::mono_bind_residents(vk_device, readback_heap) != VK_SUCCESS) {
+            std::cerr << "Failed to allocate readback heap" << std::endl;
+            return 1;
+        }
+
+        /* every frame has retired, so any frame's pools can be reset for the copy */
+        VkCommandBuffer vk_command_buffer;
+        if (kvk::command::begin_frame(vk_device, command_recycler, 0) != VK_SUCCESS || kvk::command::acquire_command_buffer(vk_device, command_recycler, 0, VK_COMMAND_BUFFER_LEVEL_PRIMARY, vk_command_buffer) != VK_SUCCESS) {
+            std::cerr << "Failed to get a command buffer for readback" << std::endl;
+            return 1;
+        }
+
+        VkCommandBufferBeginInfo vk_command_buffer_begin_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        };
+
+        vkBeginCommandBuffer(vk_command_buffer, &vk_command_buffer_begin_info);
+
+        VkMemoryBarrier vk_compute_to_transfer_barrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+        };
+
+        vkCmdPipelineBarrier(vk_command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &vk_compute_to_transfer_barrier, 0, nullptr, 0, nullptr);
+
+        VkBufferCopy vk_buffer_copy = {
+            .srcOffset = 0,
+            .dstOffset = 0,
+            .size = vk_grid_size,
+        };
+
+        vkCmdCopyBuffer(vk_command_buffer, vk_last_output_grid, vk_readback_buffer, 1, &vk_buffer_copy);
+
+        VkMemoryBarrier vk_transfer_to_host_barrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+        };
+
+        vkCmdPipelineBarrier(vk_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &vk_transfer_to_host_barrier, 0, nullptr, 0, nullptr);
+        vkEndCommandBuffer(vk_command_buffer);
+
+        kvk::scheduler::WorkHandle work;
+        if (kvk::scheduler::enqueue(scheduler, {
+            .vk_required_flags = VK_QUEUE_COMPUTE_BIT,
+            .requires_present = false,
+            .family_index = queues.compute0_0.family_index,
+            .vk_command_buffers = { vk_command_buffer },
+        }, work) != VK_SUCCESS || kvk::scheduler::flush(scheduler) != VK_SUCCESS || kvk::scheduler::wait(vk_device, scheduler, work, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+            std::cerr << "Failed to read back the grid" << std::endl;
+            return 1;
+        }
+
+        life::Grid gpu_grid;
+        life::Grid cpu_grid;
+        if (!life::create_grid(CELLULAR_AUTOMATA_GRID_WORDS, CELLULAR_AUTOMATA_GRID_HEIGHT, gpu_grid) || !life::create_grid(CELLULAR_AUTOMATA_GRID_WORDS, CELLULAR_AUTOMATA_GRID_HEIGHT, cpu_grid)) {
+            std::cerr << "Failed to create the validation grids" << std::endl;
+            return 1;
+        }
+
+        void* mapped;
+        VkDeviceSize vk_offset = readback_heap.residents.at({ .vk_buffer = vk_readback_buffer, .is_image = false }).vk_heap_offset;
+        if (vkMapMemory(vk_device, readback_heap.vk_heap_memory, vk_offset, vk_grid_size, 0, &mapped) != VK_SUCCESS) {
+            std::cerr << "Failed to map readback heap" << std::endl;
+            return 1;
+        }
+
+        std::memcpy(gpu_grid.words.data(), mapped, vk_grid_size);
+        vkUnmapMemory(vk_device, readback_heap.vk_heap_memory);
+
+        /* in hybrid mode the rows past the split were last stepped on the cpu */
+        if (hybrid) {
+            copy_rows(gpu_grid.words.data(), hybrid_state.grid.words.data(), { hybrid_state.last_split, CELLULAR_AUTOMATA_GRID_HEIGHT });
+        }
+
+        vkDestroyBuffer(vk_device, vk_readback_buffer, nullptr);
+        kvk::resource::mono_free_heap(vk_device, readback_heap);
+
+        life::seed(cpu_grid, CELLULAR_AUTOMATA_SEED);
+
+        uint64_t generations = dispatches_submitted * CELLULAR_AUTOMATA_GENERATIONS_PER_DISPATCH;
+        life::run(jobs, cpu_grid, generations, CELLULAR_AUTOMATA_CPU_BAND_ROWS);
+
+        auto mismatch = std::mismatch(gpu_grid.words.begin(), gpu_grid.words.end(), cpu_grid.words.begin());
+        if (mismatch.first != gpu_grid.words.end()) {
+            size_t index = static_cast<size_t>(mismatch.first - gpu_grid.words.begin());
+            std::cerr << "Validation failed after " << generations << " generations: word " << index % CELLULAR_AUTOMATA_GRID_WORDS << " of row " << index / CELLULAR_AUTOMATA_GRID_WORDS << " is " << std::hex << *mismatch.first << " on the GPU and " << *mismatch.second << " on the cpu" << std::dec << std::endl;
+            exit_code = 1;
+        } else {
+            std::cout << "Validation passed: " << generations << " generations match the cpu engine (" << life::simd_path() << "), population " << life::population(gpu_grid) << std::endl;
+        }
+    }
+
+    /* cleanup frame graph */
+    kvk::graph::destroy_graph(vk_device, frame_graph);
+
+    /* cleanup frame synchronization */
+    for (uint32_t i = 0; i < vk_render_finished_semaphores.size(); ++i) {
+        vkDestroySemaphore(vk_device, vk_render_finished_semaphores[i], nullptr);
+    }
+
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        vkDestroySemaphore(vk_device, vk_image_acquired_semaphores[i], nullptr);
+    }
+
+    /* cleanup descriptor sets */
+    kvk::update::destroy_update_template(vk_device, compute_pass0_0_update_template);
+    kvk::descriptor::destroy_descriptor_allocator(vk_device, descriptor_allocator);
+    if (descriptor_buffer) {
+        kvk::descriptor_buffer::destroy_descriptor_buffer_heap(vk_device, descriptor_buffer_heap);
     }
 
     /* cleanup compute pass 0.0 pipeline and shaders */
-    vkDestroyPipeline(vk_device, vk_compute_pass0_0_pipeline, nullptr);
-    vkDestroyShaderModule(vk_device, vk_compute_pass0_0_shader_module, nullptr);
+#ifdef KVK_USE_DXC
+    kvk::reload::destroy_watcher(shader_watcher);
+#endif
+    kvk::tune::end_session(vk_device, life_tune_session);
+    kvk::pipeline::destroy_batch(jobs, pipeline_batch);
+    for (LifeVariant const& variant : life_variants) {
+        vkDestroyShaderModule(vk_device, variant.vk_shader_module, nullptr);
+    }
+    vkDestroyShaderModule(vk_device, vk_render_shader_module, nullptr);
+    vkDestroyShaderModule(vk_device, vk_compact_shader_module, nullptr);
+    kvk::shader::destroy_compile_cache(shader_cache);
+    kvk::pipeline::save(vk_device, pipeline_cache);
+    kvk::pipeline::destroy_pipeline_cache(vk_device, pipeline_cache);
 
-    /* cleanup compute pass 0.0 layouts */
-    vkDestroyPipelineLayout(vk_device, vk_compute_pass0_0_pipeline_layout, nullptr);
-    vkDestroyDescriptorSetLayout(vk_device, vk_compute_pass0_0_descriptor_set_layout, nullptr);
+    /* cleanup layouts */
+    kvk::layout::destroy_layout_cache(vk_device, layout_cache);
 
     /* cleanup uniform resources and free heap */
     vkDestroyBuffer(vk_device, vk_uniform_buffer, nullptr);
     kvk::resource::mono_free_heap(vk_device, uniform_heap);
 
     /* cleanup cellular automata resources and free heap */
-    vkDestroyImage(vk_device, vk_cellular_automata_render_image, nullptr);
+    if (vk_cellular_automata_render_image != VK_NULL_HANDLE) {
+        vkDestroyImageView(vk_device, vk_cellular_automata_render_image_view, nullptr);
+        vkDestroyImage(vk_device, vk_cellular_automata_render_image, nullptr);
+    }
+    vkDestroyBuffer(vk_device, vk_dispatch_args_buffer, nullptr);
+    vkDestroyBuffer(vk_device, vk_active_tiles_buffer, nullptr);
+    vkDestroyBuffer(vk_device, vk_tile_flags_buffer, nullptr);
     vkDestroyBuffer(vk_device, vk_cellular_automata_buffer1, nullptr);
     vkDestroyBuffer(vk_device, vk_cellular_automata_buffer0, nullptr);
     kvk::resource::mono_free_heap(vk_device, cellular_automata_heap);
 
+    /* cleanup exchange resources and free heap */
+    if (hybrid) {
+        vkUnmapMemory(vk_device, exchange_heap.vk_heap_memory);
+        vkDestroyBuffer(vk_device, hybrid_state.vk_exchange_buffer, nullptr);
+        kvk::resource::mono_free_heap(vk_device, exchange_heap);
+    }
+
     /* cleanup swapchain */
     for (uint32_t i = 0; i < vk_swapchain_backbuffer_views.size(); ++i) {
         vkDestroyImageView(vk_device, vk_swapchain_backbuffer_views[i], nullptr);
     }
     vkDestroySwapchainKHR(vk_device, vk_swapchain, nullptr);
 
-    /* cleanup command pool and buffers */
-    vkFreeCommandBuffers(vk_device, vk_compute_queue0_command_pool0, 1, &vk_compute_queue0_command_pool0_command_buffer0);
-    vkDestroyCommandPool(vk_device, vk_compute_queue0_command_pool0, nullptr);
+    /* cleanup command pools and buffers, then the workers that recorded into them */
+    kvk::command::destroy_recycler(vk_device, command_recycler);
+    kvk::job::destroy_job_system(jobs);
+
+    /* cleanup submission scheduling */
+    kvk::scheduler::destroy_scheduler(vk_device, scheduler);
 
     /* cleanup device, instance and surface */
     vkDestroyDevice(vk_device, nullptr);
@@ -594,4 +2020,5 @@ int main() {
     SDL_Vulkan_UnloadLibrary();
     SDL_DestroyWindow(sdl_window);
     SDL_Quit();
+    return exit_code;
 }
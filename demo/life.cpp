@@ -0,0 +1,272 @@
+#include "life.h"
+
+#include <cstring>
+#include <algorithm>
+#include <bit>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace life {
+
+static_assert(std::endian::native == std::endian::little, "two adjacent grid words are read as one 64-bit lane");
+
+/* the vector types step_rows is written against; each lane is 64 cells of a row */
+struct Lanes64 {
+    using Lane = uint64_t;
+    static constexpr uint32_t WIDTH = 1;
+
+    static Lane load(uint64_t const* p) { return *p; }
+    static void store(uint64_t* p, Lane a) { *p = a; }
+    static Lane bit_and(Lane a, Lane b) { return a & b; }
+    static Lane bit_or(Lane a, Lane b) { return a | b; }
+    static Lane bit_xor(Lane a, Lane b) { return a ^ b; }
+    static Lane and_not(Lane a, Lane b) { return ~a & b; }
+    static Lane xor3(Lane a, Lane b, Lane c) { return a ^ b ^ c; }
+    static Lane majority(Lane a, Lane b, Lane c) { return (a & b) | (c & (a ^ b)); }
+    template<int N> static Lane shift_left(Lane a) { return a << N; }
+    template<int N> static Lane shift_right(Lane a) { return a >> N; }
+};
+
+#ifdef __AVX2__
+struct Lanes256 {
+    using Lane = __m256i;
+    static constexpr uint32_t WIDTH = 4;
+
+    static Lane load(uint64_t const* p) { return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p)); }
+    static void store(uint64_t* p, Lane a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a); }
+    static Lane bit_and(Lane a, Lane b) { return _mm256_and_si256(a, b); }
+    static Lane bit_or(Lane a, Lane b) { return _mm256_or_si256(a, b); }
+    static Lane bit_xor(Lane a, Lane b) { return _mm256_xor_si256(a, b); }
+    static Lane and_not(Lane a, Lane b) { return _mm256_andnot_si256(a, b); }
+    static Lane xor3(Lane a, Lane b, Lane c) { return bit_xor(bit_xor(a, b), c); }
+    static Lane majority(Lane a, Lane b, Lane c) { return bit_or(bit_and(a, b), bit_and(c, bit_xor(a, b))); }
+    template<int N> static Lane shift_left(Lane a) { return _mm256_slli_epi64(a, N); }
+    template<int N> static Lane shift_right(Lane a) { return _mm256_srli_epi64(a, N); }
+};
+#endif
+
+#ifdef __AVX512F__
+/* the adders' three-input functions are a single ternary logic op each */
+struct Lanes512 {
+    using Lane = __m512i;
+    static constexpr uint32_t WIDTH = 8;
+
+    static Lane load(uint64_t const* p) { return _mm512_loadu_si512(p); }
+    static void store(uint64_t* p, Lane a) { _mm512_storeu_si512(p, a); }
+    static Lane bit_and(Lane a, Lane b) { return _mm512_and_si512(a, b); }
+    static Lane bit_or(Lane a, Lane b) { return _mm512_or_si512(a, b); }
+    static Lane bit_xor(Lane a, Lane b) { return _mm512_xor_si512(a, b); }
+    static Lane and_not(Lane a, Lane b) { return _mm512_andnot_si512(a, b); }
+    static Lane xor3(Lane a, Lane b, Lane c) { return _mm512_ternarylogic_epi64(a, b, c, 0x96); }
+    static Lane majority(Lane a, Lane b, Lane c) { return _mm512_ternarylogic_epi64(a, b, c, 0xe8); }
+    template<int N> static Lane shift_left(Lane a) { return _mm512_slli_epi64(a, N); }
+    template<int N> static Lane shift_right(Lane a) { return _mm512_srli_epi64(a, N); }
+};
+using Lanes = Lanes512;
+static constexpr char const* LANES_NAME = "avx-512";
+#elif defined(__AVX2__)
+using Lanes = Lanes256;
+static constexpr char const* LANES_NAME = "avx2";
+#else
+using Lanes = Lanes64;
+static constexpr char const* LANES_NAME = "64-bit";
+#endif
+
+/* mirrors cellular_automata.hlsl's hash */
+static uint32_t hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/* steps lanes [begin, end) of a row; rows are padded with the wrapped lane at [-1] and [lanes] */
+template<typename L>
+static uint32_t step_lanes(uint64_t const* above, uint64_t const* middle, uint64_t const* below, uint64_t* output, uint32_t begin, uint32_t end) {
+    uint32_t i = begin;
+    for (; i + L::WIDTH <= end; i += L::WIDTH) {
+        auto west = [&](uint64_t const* row) { return L::bit_or(L::template shift_left<1>(L::load(row + i)), L::template shift_right<63>(L::load(row + i - 1))); };
+        auto east = [&](uint64_t const* row) { return L::bit_or(L::template shift_right<1>(L::load(row + i)), L::template shift_left<63>(L::load(row + i + 1))); };
+
+        /* same adder network as the gpu kernel */
+        typename L::Lane a = L::load(above + i);
+        typename L::Lane a_west = west(above);
+        typename L::Lane a_east = east(above);
+        typename L::Lane ones_a = L::xor3(a_west, a, a_east);
+        typename L::Lane twos_a = L::majority(a_west, a, a_east);
+
+        typename L::Lane b = L::load(below + i);
+        typename L::Lane b_west = west(below);
+        typename L::Lane b_east = east(below);
+        typename L::Lane ones_b = L::xor3(b_west, b, b_east);
+        typename L::Lane twos_b = L::majority(b_west, b, b_east);
+
+        typename L::Lane m = L::load(middle + i);
+        typename L::Lane m_west = west(middle);
+        typename L::Lane m_east = east(middle);
+        typename L::Lane ones_c = L::bit_xor(m_west, m_east);
+        typename L::Lane twos_c = L::bit_and(m_west, m_east);
+
+        typename L::Lane ones = L::xor3(ones_a, ones_b, ones_c);
+        typename L::Lane twos_d = L::majority(ones_a, ones_b, ones_c);
+
+        typename L::Lane twos_partial = L::xor3(twos_a, twos_b, twos_c);
+        typename L::Lane fours_a = L::majority(twos_a, twos_b, twos_c);
+
+        typename L::Lane twos = L::bit_xor(twos_partial, twos_d);
+        typename L::Lane fours = L::bit_xor(fours_a, L::bit_and(twos_partial, twos_d));
+
+        /* born on 3, survives on 2 or 3 */
+        L::store(output + i, L::bit_and(L::and_not(fours, twos), L::bit_or(ones, m)));
+    }
+
+    return i;
+}
+
+bool create_grid(uint32_t words_x, uint32_t rows, Grid& grid) {
+    if (words_x == 0 || words_x % 2 != 0 || rows == 0) {
+        return false;
+    }
+
+    grid.words_x = words_x;
+    grid.rows = rows;
+    grid.words.assign(static_cast<size_t>(words_x) * rows, 0);
+    grid.next_words.assign(grid.words.size(), 0);
+    return true;
+}
+
+void seed(Grid& grid, uint32_t seed) {
+    for (size_t i = 0; i < grid.words.size(); ++i) {
+        grid.words[i] = hash(static_cast<uint32_t>(i) ^ seed);
+    }
+}
+
+/* four padded rows of the grid */
+static size_t scratch_words(Grid const& grid) {
+    return (static_cast<size_t>(grid.words_x) / 2 + 2) * 4;
+}
+
+/* writes rows [row_begin, row_end) of output, laid out like input's words, as input's next generation; the grid wraps at its edges */
+static void step_rows(Grid const& input, uint32_t* output, uint32_t row_begin, uint32_t row_end, uint64_t* scratch) {
+    uint32_t lanes = input.words_x / 2;
+    size_t row_bytes = static_cast<size_t>(input.words_x) * sizeof(uint32_t);
+    size_t stride = lanes + 2;
+
+    /* three padded input rows rotate through the scratch, so each input row is copied once per band; the grid's words are only touched through memcpy */
+    uint64_t* out = scratch + stride * 3 + 1;
+
+    auto load_row = [&](uint32_t row, uint32_t slot) {
+        uint64_t* padded = scratch + stride * slot;
+        std::memcpy(padded + 1, input.words.data() + static_cast<size_t>(row) * input.words_x, row_bytes);
+        padded[0] = padded[lanes];
+        padded[lanes + 1] = padded[1];
+    };
+
+    auto wrap = [&](uint32_t row, int32_t offset) {
+        return static_cast<uint32_t>((static_cast<int64_t>(row) + offset + input.rows) % input.rows);
+    };
+
+    uint32_t slot_above = 0, slot_middle = 1, slot_below = 2;
+    load_row(wrap(row_begin, -1), slot_above);
+    load_row(row_begin, slot_middle);
+
+    for (uint32_t row = row_begin; row < row_end; ++row) {
+        load_row(wrap(row, 1), slot_below);
+
+        uint64_t const* above = scratch + stride * slot_above + 1;
+        uint64_t const* middle = scratch + stride * slot_middle + 1;
+        uint64_t const* below = scratch + stride * slot_below + 1;
+
+        uint32_t done = step_lanes<Lanes>(above, middle, below, out, 0, lanes);
+        step_lanes<Lanes64>(above, middle, below, out, done, lanes);
+
+        std::memcpy(output + static_cast<size_t>(row) * input.words_x, out, row_bytes);
+
+        uint32_t recycled = slot_above;
+        slot_above = slot_middle;
+        slot_middle = slot_below;
+        slot_below = recycled;
+    }
+}
+
+/* a generation's rows are row_count rows from first_row on, wrapping past the last row */
+struct RunState {
+    Grid const* input;
+    uint32_t* output;
+    uint64_t* scratch; /* scratch_words() per worker */
+    uint32_t first_row;
+    uint32_t row_count;
+    uint32_t band_rows;
+};
+
+static void step_bands(uint32_t begin, uint32_t end, uint32_t worker_index, void* pdata) {
+    RunState const& state = *static_cast<RunState const*>(pdata);
+    uint32_t rows = state.input->rows;
+    uint64_t* scratch = state.scratch + scratch_words(*state.input) * worker_index;
+    for (uint32_t band = begin; band < end; ++band) {
+        uint32_t row_begin = state.first_row + band * state.band_rows;
+        uint32_t row_end = state.first_row + std::min((band + 1) * state.band_rows, state.row_count);
+        if (row_begin >= rows) {
+            step_rows(*state.input, state.output, row_begin - rows, row_end - rows, scratch);
+        } else if (row_end > rows) {
+            step_rows(*state.input, state.output, row_begin, rows, scratch);
+            step_rows(*state.input, state.output, 0, row_end - rows, scratch);
+        } else {
+            step_rows(*state.input, state.output, row_begin, row_end, scratch);
+        }
+    }
+}
+
+void run(kvk::job::JobSystem& jobs, Grid& grid, uint64_t generations, uint32_t band_rows) {
+    run_rows(jobs, grid, generations, 0, grid.rows, band_rows);
+}
+
+void run_rows(kvk::job::JobSystem& jobs, Grid& grid, uint64_t generations, uint32_t row_begin, uint32_t row_end, uint32_t band_rows) {
+    /* sized once; later runs reuse them */
+    grid.next_words.resize(grid.words.size());
+    grid.scratch.resize(scratch_words(grid) * kvk::job::worker_count(jobs));
+
+    band_rows = std::max(band_rows, 1u);
+    for (uint64_t generation = 0; generation < generations; ++generation) {
+        RunState state = {
+            .input = &grid,
+            .output = grid.next_words.data(),
+            .scratch = grid.scratch.data(),
+            .first_row = 0,
+            .row_count = grid.rows,
+            .band_rows = band_rows,
+        };
+
+        /* rows this close to the range are still read by the generations after this one */
+        uint64_t margin = generations - 1 - generation;
+        if (row_end - row_begin + 2 * margin < grid.rows) {
+            state.first_row = static_cast<uint32_t>((row_begin + grid.rows - margin) % grid.rows);
+            state.row_count = static_cast<uint32_t>(row_end - row_begin + 2 * margin);
+        }
+
+        kvk::job::Counter counter;
+        kvk::job::parallel_for(jobs, (state.row_count + band_rows - 1) / band_rows, 1, step_bands, &state, counter);
+        kvk::job::wait(jobs, counter);
+
+        std::swap(grid.words, grid.next_words);
+    }
+}
+
+uint64_t population(Grid const& grid) {
+    uint64_t count = 0;
+    for (uint32_t word : grid.words) {
+        count += std::popcount(word);
+    }
+
+    return count;
+}
+
+char const* simd_path() {
+    return LANES_NAME;
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "kvk.h"
+
+#include <cstdint>
+#include <vector>
+
+/* cpu reference for cellular_automata.hlsl: the same bit-packed grid, seed and rule, stepped bit-sliced on every core */
+namespace life {
+
+/* laid out like the gpu grid buffers: rows of words_x words, cell x of a row in bit x % 32 of word x / 32 */
+struct Grid {
+    uint32_t words_x; /* even, as rows are stepped 64 cells at a time */
+    uint32_t rows;
+    std::vector<uint32_t> words;
+
+    /* run_rows()' working memory, kept so stepping doesn't allocate: the generation being written and every job worker's padded rows */
+    std::vector<uint32_t> next_words;
+    std::vector<uint64_t> scratch;
+};
+
+/* fails on an odd words_x or an empty grid */
+bool create_grid(uint32_t words_x, uint32_t rows, Grid& grid);
+
+/* what the gpu's generation 0 would write for seed */
+void seed(Grid& grid, uint32_t seed);
+
+/* steps grid generations times, each generation split into bands of band_rows rows across the job system */
+void run(kvk::job::JobSystem& jobs, Grid& grid, uint64_t generations, uint32_t band_rows);
+
+/* like run(), but only rows [row_begin, row_end) end up stepped; the rows around them are stepped only as far as those need
+   (generations - 1 deep at first, one less each generation) and everything else is left stale. the input must be valid
+   generations rows past either end, wrapping */
+void run_rows(kvk::job::JobSystem& jobs, Grid& grid, uint64_t generations, uint32_t row_begin, uint32_t row_end, uint32_t band_rows);
+
+/* live cells */
+uint64_t population(Grid const& grid);
+
+/* the vector width step_rows was compiled for, e.g. "avx2" */
+char const* simd_path();
+
+}
@@ -5,7 +5,17 @@
 #include <vector>
 #include <stdexcept>
 #include <optional>
+#include <string>
 #include <unordered_map>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
+#include <cstddef>
+#include <type_traits>
 
 #ifdef KVK_USE_DXC
 #include <dxc/dxcapi.h>
@@ -160,6 +170,12 @@ struct PhysicalDeviceQuery {
 
     //std::vector<VkQueueFamilyProperties> const& minimum_queue_family_properties;
     std::vector<PhysicalDeviceQueueRequirements> const& required_queues;
+
+    /* needs Vulkan 1.1 for vkGetPhysicalDeviceFeatures2; sType/pNext are ignored */
+    std::optional<VkPhysicalDeviceDescriptorIndexingFeatures> minimum_descriptor_indexing_features;
+
+    /* needs Vulkan 1.1; every stage and operation bit has to be supported, subgroupSize is a minimum; sType/pNext are ignored */
+    std::optional<VkPhysicalDeviceSubgroupProperties> minimum_subgroup_properties;
 };
 
 VkPhysicalDevice select_physical_device(VkInstance vk_instance, PhysicalDeviceQuery const& query);
@@ -174,6 +190,13 @@ struct DevicePresets {
     bool enable_swapchain;
     bool enable_dynamic_rendering;
     bool enable_maintenance1;
+    bool enable_present_id; /* only if available; see present::present_id_supported() */
+    bool enable_present_wait; /* implies enable_present_id; only if both are available, see present::present_wait_supported() */
+    bool enable_timeline_semaphore;
+    bool enable_synchronization2;
+    bool enable_descriptor_indexing; /* enables every descriptor indexing feature the device supports */
+    bool enable_push_descriptor; /* only if available; see update::push_descriptors_supported() */
+    bool enable_descriptor_buffer; /* also enables buffer device addresses */
 };
 
 struct DeviceCreateInfo {
@@ -208,6 +231,16 @@ struct SwapchainPreference {
     VkPresentModeKHR vk_present_mode;
 };
 
+enum class SwapchainPolicy : uint32_t {
+    /* first supported entry of SwapchainCreateInfo::preferences wins */
+    PREFERENCES = 0,
+
+    /* present mode and image count are derived from the surface capabilities; preferences only supply format and layer count */
+    LOWEST_LATENCY,
+    LOWEST_POWER,
+    NO_TEARING_BOUNDED, /* never tears and queues at most policy_max_queued_images */
+};
+
 struct SwapchainCreateInfo {
     VkPhysicalDevice vk_physical_device;
     VkSurfaceKHR vk_surface;
@@ -218,6 +251,9 @@ struct SwapchainCreateInfo {
     std::optional<VkExtent2D> vk_extent;
     VkImageUsageFlags vk_image_usage;
 
+    /* added to vk_image_usage only if the surface and the chosen format support them (e.g. STORAGE for compute writes into backbuffers) */
+    VkImageUsageFlags vk_optional_image_usage;
+
     std::vector<SwapchainPreference> const& preferences;
 
     VkSharingMode vk_image_sharing_mode;
@@ -226,6 +262,12 @@ struct SwapchainCreateInfo {
     VkSurfaceTransformFlagBitsKHR vk_pre_transform;
     VkCompositeAlphaFlagBitsKHR vk_composite_alpha;
     VkBool32 vk_clipped;
+
+    /* tried before walking preferences in list order (see present::suggest_preference()) */
+    std::optional<uint32_t> preference_override;
+
+    SwapchainPolicy policy;
+    uint32_t policy_max_queued_images;
 };
 
 struct SwapchainReturns {
@@ -234,10 +276,348 @@ struct SwapchainReturns {
     uint32_t chosen_preference;
     VkExtent2D vk_current_extent;
     std::optional<ArrayReference<VkImage>> vk_backbuffers;
+
+    /* what was actually requested from the driver, and why when a policy picked it */
+    uint32_t image_count;
+    VkSurfaceFormatKHR vk_surface_format;
+    VkPresentModeKHR vk_present_mode;
+    VkImageUsageFlags vk_image_usage;
+    std::string choice_reason;
 };
 
 VkResult create_swapchain(VkDevice vk_device, SwapchainCreateInfo const& create_info, SwapchainReturns& returns);
 
+namespace present {
+
+/* timestamps are nanoseconds since the telemetry epoch; displayed_ns is 0 when VK_KHR_present_wait is not in use */
+struct FrameTiming {
+    uint64_t present_id;
+    uint32_t preference;
+
+    uint64_t acquire_ns;
+    uint64_t submit_ns;
+    uint64_t present_ns;
+    uint64_t displayed_ns;
+};
+
+struct LatencyPercentiles {
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+};
+
+struct LatencyReport {
+    uint32_t sample_count;
+
+    LatencyPercentiles acquire_to_submit;
+    LatencyPercentiles submit_to_present;
+    LatencyPercentiles present_to_displayed;
+
+    /* acquire to displayed with present wait, acquire to present without */
+    LatencyPercentiles end_to_end;
+};
+
+struct PreferenceLatency {
+    std::deque<uint64_t> end_to_end_ns;
+    bool unsupported;
+};
+
+struct LatencyTelemetryCreateInfo {
+    VkSwapchainKHR vk_swapchain;
+
+    /* SwapchainReturns::chosen_preference and SwapchainCreateInfo::preferences.size() */
+    uint32_t preference;
+    uint32_t preference_count;
+
+    uint32_t sample_capacity;
+
+    /* requires DevicePresets::enable_present_id; without it presents go out untagged and end-to-end stops at the present */
+    bool use_present_id;
+
+    /* requires DevicePresets::enable_present_wait and use_present_id */
+    bool use_present_wait;
+};
+
+struct LatencyTelemetry {
+    VkDevice vk_device;
+    VkSwapchainKHR vk_swapchain;
+    PFN_vkWaitForPresentKHR vk_wait_for_present_khr;
+
+    uint32_t preference;
+    bool use_present_id;
+    uint64_t next_present_id;
+    std::chrono::steady_clock::time_point epoch;
+
+    FrameTiming recording;
+    std::deque<FrameTiming> awaiting_display;
+
+    /* ring of the last sample_capacity completed frames */
+    std::vector<FrameTiming> samples;
+    uint32_t sample_head;
+    uint32_t sample_count;
+
+    std::vector<PreferenceLatency> preferences;
+};
+
+/* whether create_device() enables the extensions behind use_present_id/use_present_wait on this device */
+bool present_id_supported(VkPhysicalDevice vk_physical_device);
+bool present_wait_supported(VkPhysicalDevice vk_physical_device);
+
+VkResult create_latency_telemetry(VkDevice vk_device, LatencyTelemetryCreateInfo const& create_info, LatencyTelemetry& telemetry);
+
+/* call after every swapchain (re)creation; requested is the preference_override that was asked for, if any */
+void rebind_swapchain(LatencyTelemetry& telemetry, VkSwapchainKHR vk_swapchain, std::optional<uint32_t> requested, uint32_t chosen_preference);
+
+/* call right after vkAcquireNextImageKHR() and right after the frame's last vkQueueSubmit*() respectively */
+void mark_acquired(LatencyTelemetry& telemetry);
+void mark_submitted(LatencyTelemetry& telemetry);
+
+/* vkQueuePresentKHR() that records the telemetry swapchain's present, tagged with a present id if use_present_id; see also scheduler::queue_present() */
+VkResult queue_present(LatencyTelemetry& telemetry, VkQueue vk_queue, VkPresentInfoKHR const& vk_present_info);
+
+/* retires presented frames that have been displayed; waits at most timeout_ns for the oldest one */
+VkResult poll_displayed(LatencyTelemetry& telemetry, uint64_t timeout_ns);
+
+void get_latency_report(LatencyTelemetry const& telemetry, LatencyReport& report);
+
+/* explores each untried preference for samples_per_preference frames, then settles on the lowest p90 end-to-end latency; nullopt means keep the current one */
+std::optional<uint32_t> suggest_preference(LatencyTelemetry const& telemetry, uint32_t samples_per_preference);
+
+/*
+ * backbuffer writes: with STORAGE in SwapchainReturns::vk_image_usage, compute writes the acquired backbuffer directly (in GENERAL while
+ * bound); otherwise render to an intermediate image and blit it over (needs TRANSFER_DST). either way the transitions are the caller's,
+ * e.g. a graph::import_image of the backbuffer
+ */
+struct BackbufferBlitInfo {
+    /* written by compute beforehand, in vk_source_layout (GENERAL or TRANSFER_SRC_OPTIMAL) by the time of the blit */
+    VkImage vk_source_image;
+    VkImageLayout vk_source_layout;
+    VkExtent2D vk_source_extent;
+
+    VkImage vk_backbuffer;
+    VkExtent2D vk_backbuffer_extent;
+
+    VkFilter vk_filter;
+};
+
+/* scales the source over the whole backbuffer, which must be in TRANSFER_DST_OPTIMAL; records no barriers, those come from the caller (e.g. a frame graph pass) */
+void cmd_blit_to_backbuffer(VkCommandBuffer vk_command_buffer, BackbufferBlitInfo const& blit_info);
+
+}
+
+namespace job {
+
+/* runs items [begin, end); worker_index is stable per OS thread, 0 being the one thread outside the job system that calls into it */
+using JobFunction = void(*)(uint32_t begin, uint32_t end, uint32_t worker_index, void* pdata);
+
+struct Counter {
+    std::atomic<uint32_t> pending = 0;
+};
+
+struct Job {
+    JobFunction function;
+    void* pdata;
+    uint32_t begin;
+    uint32_t end;
+    Counter* counter;
+};
+
+/* the owner pushes and pops at the back, thieves take from the front */
+struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+};
+
+struct JobSystemCreateInfo {
+    /* threads spawned in addition to the calling thread; 0 picks hardware concurrency - 1 */
+    uint32_t worker_thread_count;
+};
+
+/* besides its own workers, only one thread (worker 0, usually the creating one) may submit, parallel_for or wait; worker 0's queue and
+   per-worker state such as command::Recycler threads aren't safe to share, and workers of another job system count as outside threads */
+struct JobSystem {
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+    std::atomic<bool> running;
+    std::atomic<uint32_t> queued;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+};
+
+void create_job_system(JobSystemCreateInfo const& create_info, JobSystem& jobs);
+void destroy_job_system(JobSystem& jobs);
+
+/* including the creating thread */
+uint32_t worker_count(JobSystem const& jobs);
+
+/* queues on the calling worker's deque; counter must outlive the job */
+void submit(JobSystem& jobs, Job const& job);
+
+/* splits [0, count) into batches of batch_size items, one job each */
+void parallel_for(JobSystem& jobs, uint32_t count, uint32_t batch_size, JobFunction function, void* pdata, Counter& counter);
+
+/* executes or steals pending jobs until counter reaches zero, sleeping while there are none to take */
+void wait(JobSystem& jobs, Counter& counter);
+
+}
+
+namespace command {
+
+/* command buffers handed out from one pool; they are only ever reset together with it */
+struct RecyclerPool {
+    VkCommandPool vk_command_pool;
+
+    std::vector<VkCommandBuffer> vk_primaries;
+    std::vector<VkCommandBuffer> vk_secondaries;
+    uint32_t primaries_used;
+    uint32_t secondaries_used;
+};
+
+/* a pool per frame in flight, bound to whichever thread first records from it */
+struct RecyclerThread {
+    std::thread::id owner;
+    bool owned;
+
+    std::vector<RecyclerPool> frames;
+};
+
+struct RecyclerCreateInfo {
+    uint32_t queue_family_index;
+    uint32_t thread_count;
+    uint32_t frames_in_flight;
+
+    /* TRANSIENT is always added; RESET_COMMAND_BUFFER is pointless since pools are reset whole */
+    VkCommandPoolCreateFlags vk_flags;
+
+    /* allocated per vkAllocateCommandBuffers() call whenever a free list runs dry */
+    uint32_t allocation_batch_size;
+};
+
+struct Recycler {
+    uint32_t frame_index;
+    uint32_t allocation_batch_size;
+
+    std::vector<RecyclerThread> threads;
+};
+
+VkResult create_recycler(VkDevice vk_device, RecyclerCreateInfo const& create_info, Recycler& recycler);
+void destroy_recycler(VkDevice vk_device, Recycler& recycler);
+
+/* resets every thread's pool for frame_index at once; only call after that frame's submissions have retired and before any thread records for it */
+VkResult begin_frame(VkDevice vk_device, Recycler& recycler, uint32_t frame_index);
+
+/* hands out a buffer from thread_index's pool for the current frame; each thread_index must only ever be used from one thread */
+VkResult acquire_command_buffer(VkDevice vk_device, Recycler& recycler, uint32_t thread_index, VkCommandBufferLevel vk_level, VkCommandBuffer& vk_command_buffer);
+
+/* records items [begin, end) into a secondary that is already begun; compute state is not inherited, so bind pipelines and descriptors here */
+using RecordFunction = void(*)(VkCommandBuffer vk_command_buffer, uint32_t begin, uint32_t end, void* pdata);
+
+struct ParallelRecordInfo {
+    /* must be recording; secondaries are executed into it in batch order, whichever worker recorded them */
+    VkCommandBuffer vk_primary;
+
+    uint32_t item_count;
+    uint32_t items_per_batch; /* 0 spreads the items evenly over every worker */
+
+    /* nullptr for work outside a render pass */
+    VkCommandBufferInheritanceInfo const* vk_inheritance_info;
+    VkCommandBufferUsageFlags vk_usage_flags;
+
+    RecordFunction record;
+    void* pdata;
+};
+
+/* worker i records from recycler thread index i, so the recycler needs at least job::worker_count() threads */
+VkResult record_parallel(VkDevice vk_device, job::JobSystem& jobs, Recycler& recycler, ParallelRecordInfo const& record_info);
+
+}
+
+namespace scheduler {
+
+/* identifies submitted work: complete once queue's timeline reaches value */
+struct WorkHandle {
+    uint32_t queue;
+    uint64_t value;
+};
+
+struct WorkItem {
+    /* mapped to the queue that has these flags with the fewest others, i.e. dedicated transfer/async compute queues win */
+    VkQueueFlags vk_required_flags;
+    bool requires_present;
+
+    /* command buffers may only go to a queue of the family their pool was created for */
+    std::optional<uint32_t> family_index;
+    std::vector<VkCommandBuffer> vk_command_buffers;
+
+    /* waited on as timeline values at vk_dependency_stage */
+    std::vector<WorkHandle> dependencies;
+    VkPipelineStageFlags2 vk_dependency_stage;
+
+    /* extra (e.g. binary swapchain) semaphores */
+    std::vector<VkSemaphoreSubmitInfo> vk_wait_semaphores;
+    std::vector<VkSemaphoreSubmitInfo> vk_signal_semaphores;
+};
+
+struct SchedulerQueue {
+    VkQueue vk_queue;
+    uint32_t family_index;
+    VkQueueFlags vk_queue_flags;
+    bool present_support;
+
+    /* signalled with each submission's value in submission order; values handed out by enqueue() only count as submitted once
+       vkQueueSubmit2 took them, a failed submit never signals its values */
+    VkSemaphore vk_timeline;
+    uint64_t last_value;
+    uint64_t last_submitted_value;
+
+    /* Vulkan requires external synchronization of every vkQueue* call */
+    std::unique_ptr<std::mutex> mutex;
+};
+
+struct PendingWork {
+    WorkHandle handle;
+    WorkItem item;
+};
+
+struct SchedulerCreateInfo {
+    VkPhysicalDevice vk_physical_device;
+    std::vector<DeviceQueueReturn> const& queues;
+
+    /* queues that can present to it may take WorkItem::requires_present work; VK_NULL_HANDLE for none */
+    VkSurfaceKHR vk_present_surface;
+};
+
+/* requires DevicePresets::enable_timeline_semaphore and enable_synchronization2 */
+struct Scheduler {
+    PFN_vkQueueSubmit2KHR vk_queue_submit2_khr;
+
+    std::vector<SchedulerQueue> queues;
+
+    std::mutex pending_mutex;
+    std::vector<PendingWork> pending;
+};
+
+VkResult create_scheduler(VkDevice vk_device, SchedulerCreateInfo const& create_info, Scheduler& scheduler);
+
+/* waits for every queue's timeline to drain first */
+void destroy_scheduler(VkDevice vk_device, Scheduler& scheduler);
+
+/* picks a queue and timeline value immediately, nothing is submitted until flush(); safe to call from any thread */
+VkResult enqueue(Scheduler& scheduler, WorkItem item, WorkHandle& handle);
+
+/* submits everything enqueued so far with one vkQueueSubmit2 per queue */
+VkResult flush(Scheduler& scheduler);
+
+/* presents under the queue's lock; through telemetry when given, so the present is timed and tagged */
+VkResult queue_present(Scheduler& scheduler, uint32_t queue, VkPresentInfoKHR const& vk_present_info, present::LatencyTelemetry* telemetry = nullptr);
+
+VkResult wait(VkDevice vk_device, Scheduler const& scheduler, WorkHandle handle, uint64_t timeout_ns);
+bool is_complete(VkDevice vk_device, Scheduler const& scheduler, WorkHandle handle);
+
+}
+
 namespace resource {
 
 uint32_t find_memory_type_index(VkPhysicalDevice vk_physical_device, std::vector<VkMemoryRequirements> const& vk_memory_requirementses, VkMemoryPropertyFlags vk_memory_properties);
@@ -285,6 +665,7 @@ struct MonoAllocationResident {
 struct MonoAllocationHeap {
     VkDeviceMemory vk_heap_memory;
     VkDeviceSize vk_heap_size;
+    uint32_t memory_type_index;
 
     std::unordered_map<MonoAllocationResidentID, MonoAllocationResident> residents;
 };
@@ -295,22 +676,648 @@ struct MonoAllocationCreateInfo {
     VkMemoryPropertyFlags vk_memory_properties;
 
     std::vector<MonoAllocationResidentID> const& residents;
+
+    VkMemoryAllocateFlags vk_memory_allocate_flags; /* e.g. VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT */
 };
 
 VkResult mono_alloc_for_residents(VkDevice vk_device, MonoAllocationCreateInfo const& create_info, MonoAllocationHeap& heap);
 VkResult mono_bind_residents(VkDevice vk_device, MonoAllocationHeap& heap);
 
+/* first-fit placement into a range no resident occupies, e.g. one given back by mono_release_resident(); bind with mono_bind_residents() */
+VkResult mono_place_resident(VkDevice vk_device, MonoAllocationHeap& heap, MonoAllocationResidentID id);
+
+/* destroys the resident's buffer/image and gives its range back to the heap; the GPU must be done with it (see deletion::defer_resident) */
+void mono_release_resident(VkDevice vk_device, MonoAllocationHeap& heap, MonoAllocationResidentID id);
+
 /* NOTE: destroy all resident resources before freeing */
 void mono_free_heap(VkDevice vk_device, MonoAllocationHeap& heap);
 
 }
 
+namespace graph {
+
+using ResourceID = uint32_t;
+
+/* how a resource was last touched (or, for imports, how it is handed over) */
+struct ResourceState {
+    VkPipelineStageFlags2 vk_stages;
+    VkAccessFlags2 vk_access;
+    VkImageLayout vk_layout; /* ignored for buffers */
+};
+
+struct GraphResource {
+    bool is_image;
+    bool imported;
+
+    /* may be swapped between executions with set_buffer()/set_image() without recompiling */
+    VkBuffer vk_buffer;
+    VkImage vk_image;
+    VkImageSubresourceRange vk_subresource_range;
+
+    ResourceState initial_state;
+    std::optional<ResourceState> final_state;
+
+    /* transients only: created by compile(), placed in memory shared with transients whose lifetimes don't overlap */
+    VkBufferCreateInfo vk_buffer_create_info;
+    VkImageCreateInfo vk_image_create_info;
+    std::vector<ResourceID> aliased_predecessors;
+};
+
+struct ResourceUse {
+    ResourceID resource;
+    VkPipelineStageFlags2 vk_stages;
+    VkAccessFlags2 vk_access;
+    VkImageLayout vk_layout;
+};
+
+using PassRecordFunction = void(*)(VkCommandBuffer vk_command_buffer, void* pdata);
+
+struct PassInfo {
+    const char* name;
+
+    /* a resource both read and written goes in writes with the combined access */
+    std::vector<ResourceUse> reads;
+    std::vector<ResourceUse> writes;
+
+    /* keeps the pass even if nothing reads what it writes */
+    bool side_effects;
+
+    PassRecordFunction record;
+    void* pdata;
+};
+
+struct CompiledImageBarrier {
+    ResourceID resource;
+    VkPipelineStageFlags2 vk_src_stages;
+    VkAccessFlags2 vk_src_access;
+    VkPipelineStageFlags2 vk_dst_stages;
+    VkAccessFlags2 vk_dst_access;
+    VkImageLayout vk_old_layout;
+    VkImageLayout vk_new_layout;
+};
+
+/* everything needed before a pass, issued as one vkCmdPipelineBarrier2 */
+struct CompiledBarriers {
+    VkMemoryBarrier2 vk_memory_barrier; /* buffers and layout-preserving image hazards, merged */
+    std::vector<CompiledImageBarrier> image_barriers;
+};
+
+struct CompiledPass {
+    uint32_t pass;
+    CompiledBarriers barriers;
+};
+
+struct GraphStatistics {
+    uint32_t culled_passes;
+    uint32_t pipeline_barriers;
+    uint32_t image_barriers;
+    uint32_t dropped_transitions;
+    VkDeviceSize transient_bytes;
+    VkDeviceSize transient_bytes_unaliased;
+};
+
+struct Graph {
+    std::vector<GraphResource> resources;
+    std::vector<PassInfo> passes;
+
+    /* filled by compile() */
+    PFN_vkCmdPipelineBarrier2KHR vk_cmd_pipeline_barrier2_khr;
+    std::vector<CompiledPass> compiled;
+    CompiledBarriers final_barriers;
+    resource::MonoAllocationHeap transient_heap;
+    GraphStatistics statistics;
+};
+
+ResourceID import_buffer(Graph& graph, VkBuffer vk_buffer, ResourceState const& initial_state, std::optional<ResourceState> final_state);
+ResourceID import_image(Graph& graph, VkImage vk_image, VkImageSubresourceRange const& vk_subresource_range, ResourceState const& initial_state, std::optional<ResourceState> final_state);
+ResourceID create_transient_buffer(Graph& graph, VkBufferCreateInfo const& vk_buffer_create_info);
+ResourceID create_transient_image(Graph& graph, VkImageCreateInfo const& vk_image_create_info);
+
+void set_buffer(Graph& graph, ResourceID resource, VkBuffer vk_buffer);
+void set_image(Graph& graph, ResourceID resource, VkImage vk_image);
+
+void add_pass(Graph& graph, PassInfo pass);
+
+/* culls passes that contribute nothing, derives synchronization2 barriers and creates/aliases transients; requires DevicePresets::enable_synchronization2.
+   compiling again destroys the transients of the last compile, so the gpu must be done with them; the graph must start out zero-initialized */
+VkResult compile(VkDevice vk_device, VkPhysicalDevice vk_physical_device, Graph& graph);
+
+void execute(Graph const& graph, VkCommandBuffer vk_command_buffer);
+
+/* destroys transients; imported resources are left alone */
+void destroy_graph(VkDevice vk_device, Graph& graph);
+
+}
+
+namespace deletion {
+
+using DestroyFunction = void(*)(VkDevice vk_device, uint64_t handle, void* pdata);
+
+/* destroyed once the scheduler timeline passes after */
+struct Deletion {
+    scheduler::WorkHandle after;
+    DestroyFunction destroy;
+    uint64_t handle;
+    void* pdata;
+};
+
+struct DeletionQueue {
+    std::mutex mutex;
+    std::deque<Deletion> pending;
+};
+
+/* after should be the last work that touches the resource */
+void defer(DeletionQueue& queue, scheduler::WorkHandle after, DestroyFunction destroy, uint64_t handle, void* pdata);
+void defer_buffer(DeletionQueue& queue, scheduler::WorkHandle after, VkBuffer vk_buffer);
+void defer_image(DeletionQueue& queue, scheduler::WorkHandle after, VkImage vk_image);
+void defer_image_view(DeletionQueue& queue, scheduler::WorkHandle after, VkImageView vk_image_view);
+void defer_pipeline(DeletionQueue& queue, scheduler::WorkHandle after, VkPipeline vk_pipeline);
+void defer_shader_module(DeletionQueue& queue, scheduler::WorkHandle after, VkShaderModule vk_shader_module);
+void defer_descriptor_pool(DeletionQueue& queue, scheduler::WorkHandle after, VkDescriptorPool vk_descriptor_pool);
+
+/* destroys the resident and returns its range to heap; heap must outlive the deletion */
+void defer_resident(DeletionQueue& queue, scheduler::WorkHandle after, resource::MonoAllocationHeap& heap, resource::MonoAllocationResidentID id);
+
+/* destroys everything the GPU is done with, reading each timeline once; returns how many were destroyed */
+uint32_t collect(VkDevice vk_device, scheduler::Scheduler const& scheduler, DeletionQueue& queue);
+
+/* waits for and destroys everything still pending, e.g. at shutdown */
+VkResult drain(VkDevice vk_device, scheduler::Scheduler const& scheduler, DeletionQueue& queue);
+
+}
+
+namespace descriptor {
+
+struct DescriptorAllocatorCreateInfo {
+    uint32_t frames_in_flight;
+    uint32_t initial_sets_per_pool; /* 0 = 64 */
+    uint32_t max_sets_per_pool; /* 0 = 4096 */
+
+    /* descriptors per set to size the first pool with; later pools grow past them with observed usage but never below */
+    std::vector<VkDescriptorPoolSize> const& initial_sizes;
+    VkDescriptorPoolCreateFlags vk_flags;
+};
+
+struct DescriptorAllocatorFrame {
+    std::vector<VkDescriptorPool> vk_ready_pools;
+    std::vector<VkDescriptorPool> vk_full_pools;
+};
+
+struct DescriptorAllocator {
+    std::mutex mutex;
+    uint32_t frame_index;
+    uint32_t sets_per_pool;
+    uint32_t max_sets_per_pool;
+    VkDescriptorPoolCreateFlags vk_flags;
+    std::vector<VkDescriptorPoolSize> initial_sizes;
+
+    /* descriptors per type over every set allocated so far, to size new pools with */
+    std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorPoolSize>> layout_sizes;
+    std::unordered_map<VkDescriptorType, uint64_t> observed_descriptors;
+    uint64_t observed_sets;
+
+    std::vector<DescriptorAllocatorFrame> frames;
+};
+
+/* pools are created on first use */
+VkResult create_descriptor_allocator(DescriptorAllocatorCreateInfo const& create_info, DescriptorAllocator& allocator);
+void destroy_descriptor_allocator(VkDevice vk_device, DescriptorAllocator& allocator);
+
+/* lets allocations from layout count towards pool sizing; unregistered layouts only get the initial sizes */
+void register_layout(DescriptorAllocator& allocator, VkDescriptorSetLayout vk_descriptor_set_layout, VkDescriptorSetLayoutCreateInfo const& vk_descriptor_set_layout_create_info);
+
+/* same, for sizes known up front (e.g. from shader::pool_sizes()) */
+void register_layout(DescriptorAllocator& allocator, VkDescriptorSetLayout vk_descriptor_set_layout, std::vector<VkDescriptorPoolSize> sizes);
+
+/* resets every pool of frame_index whole; the frame's previous submission must have retired */
+VkResult begin_frame(VkDevice vk_device, DescriptorAllocator& allocator, uint32_t frame_index);
+
+/* from the current frame's pools; valid until that frame comes around again */
+VkResult allocate(VkDevice vk_device, DescriptorAllocator& allocator, VkDescriptorSetLayout vk_descriptor_set_layout, VkDescriptorSet& vk_descriptor_set, void const* vk_pnext = nullptr);
+
+}
+
+namespace bindless {
+
+/* also the binding numbers shaders declare the arrays at */
+enum class BindlessType {
+    STORAGE_BUFFER = 0,
+    STORAGE_IMAGE,
+    SAMPLED_IMAGE,
+    COUNT,
+};
+
+static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+struct BindlessArray {
+    uint32_t capacity;
+    uint32_t next;
+    std::vector<uint32_t> free_indices;
+};
+
+/* 0 capacities take the device's update-after-bind limit, capped at 65536 */
+struct BindlessHeapCreateInfo {
+    VkPhysicalDevice vk_physical_device;
+
+    /* 0 = up to 65536; clamped to the device's per-set and per-stage update-after-bind limits; other sets in the same pipeline layout count against the per-stage ones too */
+    uint32_t max_storage_buffers;
+    uint32_t max_storage_images;
+    uint32_t max_sampled_images;
+    VkShaderStageFlags vk_stages;
+};
+
+/* one set with update-after-bind, partially bound arrays; requires DevicePresets::enable_descriptor_indexing */
+struct BindlessHeap {
+    std::mutex mutex;
+    VkDescriptorSetLayout vk_descriptor_set_layout;
+    VkDescriptorPool vk_descriptor_pool;
+    VkDescriptorSet vk_descriptor_set;
+    BindlessArray arrays[static_cast<uint32_t>(BindlessType::COUNT)];
+};
+
+VkResult create_bindless_heap(VkDevice vk_device, BindlessHeapCreateInfo const& create_info, BindlessHeap& heap);
+void destroy_bindless_heap(VkDevice vk_device, BindlessHeap& heap);
+
+/* indices stay valid until released; writing one never disturbs sets already bound */
+uint32_t add_storage_buffer(VkDevice vk_device, BindlessHeap& heap, VkDescriptorBufferInfo const& vk_descriptor_buffer_info);
+uint32_t add_storage_image(VkDevice vk_device, BindlessHeap& heap, VkImageView vk_image_view, VkImageLayout vk_image_layout = VK_IMAGE_LAYOUT_GENERAL);
+uint32_t add_sampled_image(VkDevice vk_device, BindlessHeap& heap, VkImageView vk_image_view, VkImageLayout vk_image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+/* the index is handed out again straight away, so only release once the GPU is done with it (see defer_release) */
+void release(BindlessHeap& heap, BindlessType type, uint32_t index);
+void defer_release(deletion::DeletionQueue& queue, scheduler::WorkHandle after, BindlessHeap& heap, BindlessType type, uint32_t index);
+
+void cmd_bind(VkCommandBuffer vk_command_buffer, BindlessHeap const& heap, VkPipelineBindPoint vk_pipeline_bind_point, VkPipelineLayout vk_pipeline_layout, uint32_t set_index);
+
+}
+
+namespace layout {
+
+/* published once hash is stored; key and handle never change afterwards, so readers need no lock */
+struct LayoutCacheEntry {
+    std::atomic<uint64_t> hash;
+    std::vector<uint64_t> key;
+    uint64_t handle;
+};
+
+/* open addressing; entries stay put while being read, a table that fills up is copied into a larger one instead of rehashed */
+struct LayoutCacheTable {
+    std::unique_ptr<LayoutCacheEntry[]> entries;
+    uint32_t capacity;
+    uint32_t count;
+};
+
+/* readers search whichever table is current; the ones it replaced stay alive until destruction for readers that loaded them earlier */
+struct LayoutCacheMap {
+    std::atomic<LayoutCacheTable*> current;
+    std::vector<std::unique_ptr<LayoutCacheTable>> tables;
+};
+
+struct LayoutCacheCreateInfo {
+    uint32_t capacity; /* initial, per table, rounded up to a power of two; 0 = 1024 */
+};
+
+struct LayoutCache {
+    std::mutex write_mutex;
+    LayoutCacheMap descriptor_set_layouts;
+    LayoutCacheMap pipeline_layouts;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+};
+
+VkResult create_layout_cache(LayoutCacheCreateInfo const& create_info, LayoutCache& cache);
+
+/* destroys every layout the cache handed out */
+void destroy_layout_cache(VkDevice vk_device, LayoutCache& cache);
+
+/* identical bindings (in any order), flags and binding flags give back the same handle; owned by the cache */
+VkResult get_descriptor_set_layout(VkDevice vk_device, LayoutCache& cache, VkDescriptorSetLayoutCreateInfo const& vk_descriptor_set_layout_create_info, VkDescriptorSetLayout& vk_descriptor_set_layout);
+
+/* set layouts should come from get_descriptor_set_layout() so equal layouts compare equal by handle */
+VkResult get_pipeline_layout(VkDevice vk_device, LayoutCache& cache, VkPipelineLayoutCreateInfo const& vk_pipeline_layout_create_info, VkPipelineLayout& vk_pipeline_layout);
+
+}
+
+namespace update {
+
+/* what one member of a descriptor struct holds; arrays of these make array bindings */
+template<typename T>
+struct DescriptorMemberTraits;
+
+template<>
+struct DescriptorMemberTraits<VkDescriptorBufferInfo> {
+    static constexpr uint32_t count = 1;
+    static constexpr size_t stride = sizeof(VkDescriptorBufferInfo);
+};
+
+template<>
+struct DescriptorMemberTraits<VkDescriptorImageInfo> {
+    static constexpr uint32_t count = 1;
+    static constexpr size_t stride = sizeof(VkDescriptorImageInfo);
+};
+
+template<>
+struct DescriptorMemberTraits<VkBufferView> {
+    static constexpr uint32_t count = 1;
+    static constexpr size_t stride = sizeof(VkBufferView);
+};
+
+template<typename T, size_t N>
+struct DescriptorMemberTraits<T[N]> {
+    static constexpr uint32_t count = static_cast<uint32_t>(N);
+    static constexpr size_t stride = DescriptorMemberTraits<T>::stride;
+};
+
+struct UpdateTemplateEntry {
+    uint32_t binding;
+    VkDescriptorType vk_descriptor_type;
+    uint32_t count;
+    size_t offset;
+    size_t stride;
+};
+
+template<typename M>
+constexpr UpdateTemplateEntry make_entry(uint32_t binding, VkDescriptorType vk_descriptor_type, size_t offset) {
+    return {
+        .binding = binding,
+        .vk_descriptor_type = vk_descriptor_type,
+        .count = DescriptorMemberTraits<M>::count,
+        .offset = offset,
+        .stride = DescriptorMemberTraits<M>::stride,
+    };
+}
+
+/* e.g. KVK_UPDATE_ENTRY(MyDescriptors, input, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER); offset, count and stride come from the member's declaration */
+#define KVK_UPDATE_ENTRY(struct_, member_, binding_, type_) kvk::update::make_entry<decltype(struct_::member_)>(binding_, type_, offsetof(struct_, member_))
+
+struct UpdateTemplateCreateInfo {
+    VkDescriptorSetLayout vk_descriptor_set_layout;
+
+    /* push templates write straight into command buffers; the set layout needs VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR */
+    bool push;
+    VkPipelineBindPoint vk_pipeline_bind_point;
+    VkPipelineLayout vk_pipeline_layout;
+    uint32_t set;
+
+    std::vector<UpdateTemplateEntry> const& entries;
+};
+
+struct UpdateTemplate {
+    VkDescriptorUpdateTemplate vk_descriptor_update_template;
+    bool push;
+    VkPipelineLayout vk_pipeline_layout;
+    uint32_t set;
+    size_t data_size;
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR vk_cmd_push_descriptor_set_with_template_khr;
+};
+
+/* whether the device was created with VK_KHR_push_descriptor (DevicePresets::enable_push_descriptor on a device that has it) */
+bool push_descriptors_supported(VkDevice vk_device);
+
+VkResult create_update_template(VkDevice vk_device, UpdateTemplateCreateInfo const& create_info, size_t data_size, UpdateTemplate& update_template);
+void destroy_update_template(VkDevice vk_device, UpdateTemplate& update_template);
+
+void update_set(VkDevice vk_device, UpdateTemplate const& update_template, VkDescriptorSet vk_descriptor_set, void const* data, size_t data_size);
+void cmd_push(VkCommandBuffer vk_command_buffer, UpdateTemplate const& update_template, void const* data, size_t data_size);
+
+/* T is the struct the entries were made from */
+template<typename T>
+VkResult create_update_template(VkDevice vk_device, UpdateTemplateCreateInfo const& create_info, UpdateTemplate& update_template) {
+    static_assert(std::is_standard_layout_v<T>, "descriptor structs need a standard layout for offsetof");
+    return create_update_template(vk_device, create_info, sizeof(T), update_template);
+}
+
+template<typename T>
+void update_set(VkDevice vk_device, UpdateTemplate const& update_template, VkDescriptorSet vk_descriptor_set, T const& data) {
+    update_set(vk_device, update_template, vk_descriptor_set, &data, sizeof(T));
+}
+
+template<typename T>
+void cmd_push(VkCommandBuffer vk_command_buffer, UpdateTemplate const& update_template, T const& data) {
+    cmd_push(vk_command_buffer, update_template, &data, sizeof(T));
+}
+
+}
+
+namespace descriptor_buffer {
+
+struct DescriptorBufferFunctions {
+    PFN_vkGetDescriptorSetLayoutSizeEXT vk_get_descriptor_set_layout_size_ext;
+    PFN_vkGetDescriptorSetLayoutBindingOffsetEXT vk_get_descriptor_set_layout_binding_offset_ext;
+    PFN_vkGetDescriptorEXT vk_get_descriptor_ext;
+    PFN_vkCmdBindDescriptorBuffersEXT vk_cmd_bind_descriptor_buffers_ext;
+    PFN_vkCmdSetDescriptorBufferOffsetsEXT vk_cmd_set_descriptor_buffer_offsets_ext;
+};
+
+/* ring of frames_in_flight regions; a region is rewound whole when its frame comes around again */
+struct DescriptorBufferRegion {
+    VkDeviceSize vk_begin;
+    VkDeviceSize vk_end;
+    VkDeviceSize vk_head;
+};
+
+struct DescriptorBufferHeapCreateInfo {
+    VkPhysicalDevice vk_physical_device;
+    VkDeviceSize vk_size_per_frame;
+    uint32_t frames_in_flight;
+    bool samplers; /* holds sampler descriptors instead of resource descriptors */
+};
+
+/* requires DevicePresets::enable_descriptor_buffer; set layouts need VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT and pipelines VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT */
+struct DescriptorBufferHeap {
+    DescriptorBufferFunctions functions;
+    VkPhysicalDeviceDescriptorBufferPropertiesEXT vk_properties;
+
+    VkBuffer vk_buffer;
+    VkBufferUsageFlags vk_buffer_usage;
+    resource::MonoAllocationHeap heap;
+    VkDeviceAddress vk_address;
+    uint8_t* mapped;
+
+    uint32_t frame_index;
+    std::vector<DescriptorBufferRegion> regions;
+};
+
+struct DescriptorBufferLayout {
+    VkDescriptorSetLayout vk_descriptor_set_layout;
+    VkDeviceSize vk_size;
+    std::vector<VkDeviceSize> vk_binding_offsets; /* indexed by binding number, VK_WHOLE_SIZE for numbers the layout doesn't have */
+};
+
+/* one set's worth of descriptor memory */
+struct DescriptorBufferSet {
+    VkDeviceSize vk_offset;
+    uint8_t* mapped;
+};
+
+VkResult create_descriptor_buffer_heap(VkDevice vk_device, DescriptorBufferHeapCreateInfo const& create_info, DescriptorBufferHeap& heap);
+void destroy_descriptor_buffer_heap(VkDevice vk_device, DescriptorBufferHeap& heap);
+
+/* bindings are the binding numbers vk_descriptor_set_layout was created with, e.g. from shader::Reflection */
+VkResult get_layout(VkDevice vk_device, DescriptorBufferHeap const& heap, VkDescriptorSetLayout vk_descriptor_set_layout, std::vector<uint32_t> const& bindings, DescriptorBufferLayout& layout);
+
+/* the frame's previous submission must have retired */
+void begin_frame(DescriptorBufferHeap& heap, uint32_t frame_index);
+VkResult allocate(DescriptorBufferHeap& heap, DescriptorBufferLayout const& layout, DescriptorBufferSet& set);
+
+/* buffers need VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT and memory allocated with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT */
+VkDeviceAddress buffer_address(VkDevice vk_device, VkBuffer vk_buffer);
+
+/* uniform/storage (texel) buffers by address */
+void write_buffer(VkDevice vk_device, DescriptorBufferHeap const& heap, DescriptorBufferLayout const& layout, DescriptorBufferSet const& set, uint32_t binding, uint32_t array_element, VkDescriptorType vk_descriptor_type, VkDeviceAddress vk_address, VkDeviceSize vk_range);
+
+/* sampled/storage images, combined image samplers and input attachments */
+void write_image(VkDevice vk_device, DescriptorBufferHeap const& heap, DescriptorBufferLayout const& layout, DescriptorBufferSet const& set, uint32_t binding, uint32_t array_element, VkDescriptorType vk_descriptor_type, VkDescriptorImageInfo const& vk_descriptor_image_info);
+
+void write_sampler(VkDevice vk_device, DescriptorBufferHeap const& heap, DescriptorBufferLayout const& layout, DescriptorBufferSet const& set, uint32_t binding, uint32_t array_element, VkSampler vk_sampler);
+
+/* once per command buffer, before any cmd_set_set */
+void cmd_bind(VkCommandBuffer vk_command_buffer, DescriptorBufferHeap const& heap);
+void cmd_set_set(VkCommandBuffer vk_command_buffer, DescriptorBufferHeap const& heap, VkPipelineBindPoint vk_pipeline_bind_point, VkPipelineLayout vk_pipeline_layout, uint32_t set_index, DescriptorBufferSet const& set);
+
+}
+
 namespace shader {
 
+struct CompileCacheCreateInfo {
+    std::string directory; /* empty keeps the cache in memory only */
+};
+
+/* content addressed: the key covers the source, the full DXC argument list and the compiler version */
+struct CompileCache {
+    std::mutex mutex;
+    std::string directory;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> entries;
+    std::atomic<uint64_t> memory_hits;
+    std::atomic<uint64_t> disk_hits;
+    std::atomic<uint64_t> misses;
+};
+
+/* creates the directory if needed */
+VkResult create_compile_cache(CompileCacheCreateInfo const& create_info, CompileCache& cache);
+void destroy_compile_cache(CompileCache& cache);
+
+/* false if nothing is cached under key in memory or on disk */
+bool cache_lookup(CompileCache& cache, uint64_t key, std::vector<uint32_t>& spirv);
+void cache_store(CompileCache& cache, uint64_t key, std::vector<uint32_t> const& spirv);
+
+VkResult create_module(VkDevice vk_device, std::vector<uint32_t> const& spirv, VkShaderModule& vk_shader_module);
+
+/* file layout: ArchiveHeader, entry_count ArchiveEntry, names_size bytes of names, then 16 byte aligned modules */
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t names_size;
+};
+
+struct ArchiveEntry {
+    uint64_t offset; /* from the start of the file */
+    uint64_t size; /* in bytes */
+    uint32_t name_offset; /* into the names */
+    uint32_t name_size;
+};
+
+/* the file stays mapped while open; modules are created straight from the mapping */
+struct Archive {
+    uint8_t const* data;
+    size_t size;
+    std::unordered_map<std::string, uint32_t> index;
+    void* file; /* platform handles, for closing */
+    void* mapping;
+};
+
+struct ArchiveModule {
+    std::string name;
+    std::vector<uint32_t> spirv;
+};
+
+VkResult write_archive(std::string const& path, std::vector<ArchiveModule> const& modules);
+
+/* validates the header and every entry's bounds up front, so lookups can trust them */
+VkResult open_archive(std::string const& path, Archive& archive);
+void close_archive(Archive& archive);
+
+/* code points into the mapping and is valid until close_archive() */
+bool find(Archive const& archive, std::string const& name, uint32_t const*& code, size_t& size);
+
+/* vkCreateShaderModule reads the mapped pages directly, no intermediate copy */
+VkResult create_module(VkDevice vk_device, Archive const& archive, std::string const& name, VkShaderModule& vk_shader_module);
+
+inline constexpr uint32_t NO_SPEC_ID = UINT32_MAX;
+
+struct ReflectedBinding {
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType vk_descriptor_type;
+    uint32_t count; /* 0 for runtime sized arrays */
+    VkShaderStageFlags vk_shader_stage_flags;
+};
+
+struct Reflection {
+    VkShaderStageFlags vk_shader_stage_flags;
+    std::string entry;
+    std::vector<ReflectedBinding> bindings; /* sorted by set, then binding */
+    std::vector<VkPushConstantRange> vk_push_constant_ranges;
+
+    /* compute only; a spec id means the size can be overridden at pipeline creation */
+    uint32_t workgroup_size[3];
+    uint32_t workgroup_size_spec_ids[3];
+};
+
+/* reads the first entry point's decorations; only descriptor variables are considered, used or not */
+VkResult reflect(std::vector<uint32_t> const& spirv, Reflection& reflection);
+
+/* combines the stages of one pipeline; a set and binding declared by several stages must agree on type and count */
+VkResult merge_reflections(std::vector<Reflection> const& stages, Reflection& merged);
+
+/* exactly what one set needs, for sizing descriptor pools */
+std::vector<VkDescriptorPoolSize> pool_sizes(Reflection const& reflection, uint32_t set);
+
+struct ReflectedLayoutCreateInfo {
+    Reflection const& reflection;
+    std::vector<VkDescriptorSetLayoutCreateFlags> const& vk_set_flags; /* per set index; missing entries are 0 */
+};
+
+/* one set layout per set index up to the highest used, gaps get empty layouts */
+struct ReflectedLayouts {
+    std::vector<VkDescriptorSetLayout> vk_descriptor_set_layouts;
+    VkPipelineLayout vk_pipeline_layout;
+};
+
+/* layouts come from and are owned by the cache, so equal reflections share handles */
+VkResult create_layouts(VkDevice vk_device, layout::LayoutCache& cache, ReflectedLayoutCreateInfo const& create_info, ReflectedLayouts& layouts);
+
+/* owns the map entries and data vk_specialization_info points at; don't copy it after adding constants */
+struct Specialization {
+    std::vector<VkSpecializationMapEntry> vk_map_entries;
+    std::vector<uint32_t> data;
+    VkSpecializationInfo vk_specialization_info;
+};
+
+/* 32-bit constants only, which covers ints, uints and bools */
+void add_constant(Specialization& specialization, uint32_t spec_id, uint32_t value);
+
+/* false if a dimension that differs from the reflected size has no spec id to override it with */
+bool specialize_workgroup(Reflection const& reflection, uint32_t const (&workgroup_size)[3], Specialization& specialization);
+
 #ifdef KVK_USE_DXC
 
 namespace hlsl {
 
+struct CompileInfo {
+    std::string const& source;
+    std::string const& entry;
+    VkShaderStageFlags vk_shader_stage_flags;
+    std::vector<std::string> const& defines; /* "NAME" or "NAME=VALUE" */
+    CompileCache* cache; /* optional */
+};
+
+/* DXC compiler and validator version; part of every cache key */
+std::string compiler_version();
+
+VkResult compile_spirv(CompileInfo const& compile_info, std::vector<uint32_t>& spirv);
+VkResult compile(VkDevice vk_device, CompileInfo const& compile_info, VkShaderModule& vk_shader_module);
 VkResult compile(VkDevice vk_device, std::string const& source, std::string const& entry, VkShaderStageFlags vk_shader_stage_flags, VkShaderModule& vk_shader_module);
 
 }
@@ -319,4 +1326,237 @@ VkResult compile(VkDevice vk_device, std::string const& source, std::string cons
 
 }
 
+namespace pipeline {
+
+struct PipelineCacheCreateInfo {
+    VkPhysicalDevice vk_physical_device;
+    std::string path; /* empty keeps the cache in memory only */
+    uint32_t thread_count; /* one cache per job::worker_count() index; 0 = 1 */
+    std::chrono::milliseconds save_interval; /* for save_if_due(); 0 never saves periodically */
+};
+
+/* every thread cache is seeded from disk so warm starts hit no matter which worker builds a pipeline */
+struct PipelineCache {
+    std::mutex mutex;
+    std::string path;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+
+    VkPipelineCache vk_pipeline_cache; /* merge target, what gets written to disk */
+    std::vector<VkPipelineCache> vk_thread_pipeline_caches;
+
+    bool loaded; /* disk data passed validation */
+    std::chrono::milliseconds save_interval;
+    std::chrono::steady_clock::time_point last_save;
+};
+
+/* a missing, stale (other driver or device) or corrupt file is not an error, the cache just starts cold */
+VkResult create_pipeline_cache(VkDevice vk_device, PipelineCacheCreateInfo const& create_info, PipelineCache& cache);
+
+/* does not save; call save() first to keep what was built */
+void destroy_pipeline_cache(VkDevice vk_device, PipelineCache& cache);
+
+/* only worker_index may create pipelines with the returned cache at a time */
+VkPipelineCache thread_cache(PipelineCache const& cache, uint32_t worker_index);
+
+/* merges the thread caches and replaces the file with a write-then-rename */
+VkResult save(VkDevice vk_device, PipelineCache& cache);
+
+/* saves once save_interval has passed since the last save */
+VkResult save_if_due(VkDevice vk_device, PipelineCache& cache);
+
+/* published by whichever worker built it; vk_pipeline is only meaningful once ready is set */
+struct PipelineSlot {
+    std::atomic<bool> ready;
+    std::atomic<int32_t> vk_result;
+    std::atomic<uint64_t> vk_pipeline;
+    VkPipeline vk_placeholder;
+};
+
+/* everything the create infos point to (modules, layouts, names, pNext chains) must outlive the build */
+struct PipelineBatchCreateInfo {
+    std::vector<VkComputePipelineCreateInfo> const& vk_compute_create_infos;
+    std::vector<VkGraphicsPipelineCreateInfo> const& vk_graphics_create_infos;
+
+    /* optional, per pipeline: compute first, then graphics; returned by get() until the real one is ready */
+    std::vector<VkPipeline> const& vk_placeholders;
+};
+
+/* slots [0, compute count) are compute pipelines, the rest graphics; must stay put until wait() returns */
+struct PipelineBatch {
+    VkDevice vk_device;
+    PipelineCache* cache;
+    std::vector<VkComputePipelineCreateInfo> vk_compute_create_infos;
+    std::vector<VkGraphicsPipelineCreateInfo> vk_graphics_create_infos;
+    std::unique_ptr<PipelineSlot[]> slots;
+    uint32_t count;
+    job::Counter counter;
+};
+
+/* queues one job per pipeline, each built against its worker's thread_cache(); returns immediately */
+void build(VkDevice vk_device, job::JobSystem& jobs, PipelineCache& cache, PipelineBatchCreateInfo const& create_info, PipelineBatch& batch);
+
+bool ready(PipelineBatch const& batch, uint32_t index);
+
+/* the built pipeline once ready, its placeholder before that (or if building it failed) */
+VkPipeline get(PipelineBatch const& batch, uint32_t index);
+
+/* helps build until every pipeline is done; returns the first failure, if any */
+VkResult wait(job::JobSystem& jobs, PipelineBatch& batch);
+
+/* waits, then destroys every pipeline the batch built; placeholders stay with the caller */
+void destroy_batch(job::JobSystem& jobs, PipelineBatch& batch);
+
+}
+
+namespace tune {
+
+struct TunerCreateInfo {
+    VkPhysicalDevice vk_physical_device;
+    std::string path; /* shared by every device; empty keeps results in memory only */
+};
+
+/* fastest variant label per kernel, per device; only this device's entries are looked at, the rest are kept when saving */
+struct Tuner {
+    std::mutex mutex;
+    std::string path;
+    std::string device_key; /* deviceUUID in hex */
+    std::vector<std::string> lines; /* other devices' entries, written back verbatim */
+    std::unordered_map<std::string, std::string> choices;
+};
+
+/* a missing or unreadable file leaves every kernel untuned */
+VkResult create_tuner(TunerCreateInfo const& create_info, Tuner& tuner);
+
+bool lookup(Tuner& tuner, std::string const& kernel, std::string& label);
+
+/* records the choice and rewrites the file with a write-then-rename */
+VkResult store(Tuner& tuner, std::string const& kernel, std::string const& label);
+
+struct TuneSessionCreateInfo {
+    VkPhysicalDevice vk_physical_device;
+    uint32_t queue_family_index; /* the queue the measured commands are submitted to */
+    std::string kernel;
+    std::vector<std::string> const& labels; /* one per variant, stable across runs; like kernel, no whitespace */
+    uint32_t frames_in_flight;
+    uint32_t samples; /* per variant; the median is compared. 0 = 16 */
+    bool keep_measuring; /* keep timing the chosen variant after tuning, for throughput() */
+    double items_per_sample; /* work done between cmd_begin and cmd_end, e.g. cell updates; 0 reports times only */
+};
+
+/* measures variants on live frames, one variant at a time, so no extra submissions or resource setup are needed */
+struct TuneSession {
+    std::string kernel;
+    std::vector<std::string> labels;
+    VkQueryPool vk_query_pool;
+    double timestamp_period; /* nanoseconds per tick */
+    uint64_t timestamp_mask;
+    uint32_t samples;
+    bool keep_measuring;
+    double items_per_sample;
+
+    std::vector<std::vector<uint64_t>> ticks; /* per variant */
+    std::vector<uint32_t> frame_variants; /* UINT32_MAX if the frame measured nothing */
+    std::optional<uint64_t> latest_ticks; /* what the last collect() took, if anything */
+    uint32_t current;
+    bool done;
+    uint32_t chosen;
+};
+
+/* finishes immediately if tuner already knows this kernel's fastest variant among labels */
+VkResult begin_session(VkDevice vk_device, Tuner& tuner, TuneSessionCreateInfo const& create_info, TuneSession& session);
+void end_session(VkDevice vk_device, TuneSession& session);
+
+/* the variant to record this frame: the one being measured, or the chosen one once done */
+uint32_t variant(TuneSession const& session);
+
+/* bracket the measured commands; outside of a render pass */
+void cmd_begin(VkCommandBuffer vk_command_buffer, TuneSession& session, uint32_t frame_index);
+void cmd_end(VkCommandBuffer vk_command_buffer, TuneSession& session, uint32_t frame_index);
+
+/* after the frame's work has completed; picks and stores the fastest variant once all are sampled */
+VkResult collect(VkDevice vk_device, Tuner& tuner, TuneSession& session, uint32_t frame_index);
+
+/* items_per_sample per second for the current variant, over its recent samples; 0 until it has any */
+double throughput(TuneSession const& session);
+
+/* the sample the last collect() took, for callers balancing work against the frame it came from; false if it took none */
+bool latest_seconds(TuneSession const& session, double& seconds);
+
+}
+
+#ifdef KVK_USE_DXC
+
+namespace reload {
+
+struct WatcherCreateInfo {
+    shader::CompileCache* cache; /* optional; unchanged variants of an edited file still hit it */
+    std::chrono::milliseconds poll_interval; /* 0 = 250ms */
+};
+
+/* everything the create infos point to besides the module and entry name must outlive the watcher */
+struct WatchCreateInfo {
+    std::string path;
+    std::string entry;
+    VkShaderStageFlags vk_shader_stage_flags;
+    std::vector<std::string> const& defines;
+    std::vector<VkComputePipelineCreateInfo> const& vk_compute_create_infos; /* stage.module and stage.pName are filled in per rebuild */
+
+    /* what is live now, one pipeline per create info; stays owned by the caller and is never destroyed by the watcher */
+    VkShaderModule vk_shader_module;
+    std::vector<VkPipeline> const& vk_pipelines;
+};
+
+struct WatchedShader {
+    std::string path;
+    std::string entry;
+    VkShaderStageFlags vk_shader_stage_flags;
+    std::vector<std::string> defines;
+    std::vector<VkComputePipelineCreateInfo> vk_compute_create_infos;
+    int64_t last_write_time;
+
+    /* only touched by apply(), i.e. the frame loop, so reading them there needs no lock */
+    VkShaderModule vk_shader_module;
+    std::vector<VkPipeline> vk_pipelines;
+    bool owned;
+    uint32_t generation;
+
+    /* rebuilt on the watcher thread, waiting for the next apply() */
+    bool pending;
+    VkShaderModule vk_pending_shader_module;
+    std::vector<VkPipeline> vk_pending_pipelines;
+};
+
+struct Watcher {
+    VkDevice vk_device;
+    shader::CompileCache* cache;
+    VkPipelineCache vk_pipeline_cache; /* the watcher's own; rebuilds don't contend with the job workers' caches */
+    std::chrono::milliseconds poll_interval;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<WatchedShader> watched; /* a deque so ids stay valid while watching more */
+    std::atomic<bool> running;
+    std::thread thread;
+};
+
+/* starts the background thread that polls, recompiles and rebuilds */
+VkResult create_watcher(VkDevice vk_device, WatcherCreateInfo const& create_info, Watcher& watcher);
+
+/* stops the thread and destroys whatever the watcher built; wait for the GPU to finish with them first */
+void destroy_watcher(Watcher& watcher);
+
+/* returns the id to pass to pipeline() */
+uint32_t watch(Watcher& watcher, WatchCreateInfo const& create_info);
+
+/* at a frame boundary: swaps in every finished rebuild and defers destroying what it replaced until after; returns how many were swapped */
+uint32_t apply(Watcher& watcher, deletion::DeletionQueue& deletion_queue, scheduler::WorkHandle after);
+
+VkPipeline pipeline(Watcher const& watcher, uint32_t id, uint32_t index);
+
+}
+
+#endif
+
 }
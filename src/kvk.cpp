@@ -9,7 +9,7 @@
 
 namespace kvk {
 
-static MessageCallback g_error_callback = nullptr;
+MessageCallback g_error_callback = nullptr;
 
 void set_error_callback(MessageCallback callback) {
     g_error_callback = callback;
@@ -116,6 +116,20 @@ struct PhysicalDeviceFeaturesNext {
     VkBool32 b;
 };
 
+/* descriptor indexing features are a run of VkBool32 from shaderInputAttachmentArrayDynamicIndexing to runtimeDescriptorArray */
+static bool satisfies_descriptor_indexing_features(VkPhysicalDeviceDescriptorIndexingFeatures const& available, VkPhysicalDeviceDescriptorIndexingFeatures const& minimum, uint32_t& feature_index) {
+    VkBool32 const* available_next = &available.shaderInputAttachmentArrayDynamicIndexing;
+    VkBool32 const* minimum_next = &minimum.shaderInputAttachmentArrayDynamicIndexing;
+    VkBool32 const* minimum_final = &minimum.runtimeDescriptorArray;
+    for (feature_index = 0; minimum_next + feature_index <= minimum_final; ++feature_index) {
+        if (minimum_next[feature_index] && !available_next[feature_index]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 VkPhysicalDevice select_physical_device(VkInstance vk_instance, PhysicalDeviceQuery const& query) {
     VkResult vk_result;
     uint32_t physical_device_count = 0;
@@ -175,6 +189,54 @@ VkPhysicalDevice select_physical_device(VkInstance vk_instance, PhysicalDeviceQu
             continue;
         }
 
+        if (query.minimum_descriptor_indexing_features.has_value()) {
+            if (physical_device_properties.apiVersion < VK_API_VERSION_1_1) {
+                KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Physical device \"{}\" can't be queried for descriptor indexing features before Vulkan 1.1", &physical_device_properties.deviceName[0]);
+                continue;
+            }
+
+            VkPhysicalDeviceDescriptorIndexingFeatures vk_descriptor_indexing_features = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+            };
+
+            VkPhysicalDeviceFeatures2 vk_physical_device_features2 = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &vk_descriptor_indexing_features,
+            };
+
+            vkGetPhysicalDeviceFeatures2(physical_device, &vk_physical_device_features2);
+
+            uint32_t descriptor_indexing_feature_index;
+            if (!satisfies_descriptor_indexing_features(vk_descriptor_indexing_features, query.minimum_descriptor_indexing_features.value(), descriptor_indexing_feature_index)) {
+                KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Physical device \"{}\" does not satisfy minimum descriptor indexing feature at index {}", &physical_device_properties.deviceName[0], descriptor_indexing_feature_index);
+                continue;
+            }
+        }
+
+        if (query.minimum_subgroup_properties.has_value()) {
+            if (physical_device_properties.apiVersion < VK_API_VERSION_1_1) {
+                KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Physical device \"{}\" can't be queried for subgroup properties before Vulkan 1.1", &physical_device_properties.deviceName[0]);
+                continue;
+            }
+
+            VkPhysicalDeviceSubgroupProperties vk_subgroup_properties = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES,
+            };
+
+            VkPhysicalDeviceProperties2 vk_physical_device_properties2 = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                .pNext = &vk_subgroup_properties,
+            };
+
+            vkGetPhysicalDeviceProperties2(physical_device, &vk_physical_device_properties2);
+
+            VkPhysicalDeviceSubgroupProperties const& minimum = query.minimum_subgroup_properties.value();
+            if (vk_subgroup_properties.subgroupSize < minimum.subgroupSize || (vk_subgroup_properties.supportedStages & minimum.supportedStages) != minimum.supportedStages || (vk_subgroup_properties.supportedOperations & minimum.supportedOperations) != minimum.supportedOperations || (minimum.quadOperationsInAllStages && !vk_subgroup_properties.quadOperationsInAllStages)) {
+                KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Physical device \"{}\" does not satisfy minimum subgroup properties (stages {:#x}, operations {:#x})", &physical_device_properties.deviceName[0], vk_subgroup_properties.supportedStages, vk_subgroup_properties.supportedOperations);
+                continue;
+            }
+        }
+
         if (physical_device_properties.limits < query.minimum_limits) {
             KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Physical device \"{}\" does not satisfy minimum limits", &physical_device_properties.deviceName[0]);
             continue;
@@ -566,7 +628,7 @@ VkResult create_device(VkInstance vk_instance, DeviceCreateInfo const& create_in
     VkPhysicalDeviceFeatures enabled_features = {};
     if (create_info.vk_enabled_features.has_value()) {
         enabled_features = create_info.vk_enabled_features.value();
-    } else if (create_info.vk_physical_device != nullptr) {
+    } else if (create_info.vk_physical_device == nullptr) {
         enabled_features = create_info.physical_device_query.minimum_features;
     }
 
@@ -600,6 +662,47 @@ VkResult create_device(VkInstance vk_instance, DeviceCreateInfo const& create_in
         .dynamicRendering = VK_TRUE,
     };
 
+    VkPhysicalDevicePresentIdFeaturesKHR vk_present_id_features_khr = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+        .pNext = nullptr,
+        .presentId = VK_TRUE,
+    };
+
+    VkPhysicalDevicePresentWaitFeaturesKHR vk_present_wait_features_khr = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+        .pNext = nullptr,
+        .presentWait = VK_TRUE,
+    };
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR vk_timeline_semaphore_features_khr = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+        .pNext = nullptr,
+        .timelineSemaphore = VK_TRUE,
+    };
+
+    VkPhysicalDeviceSynchronization2FeaturesKHR vk_synchronization2_features_khr = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR,
+        .pNext = nullptr,
+        .synchronization2 = VK_TRUE,
+    };
+
+    VkPhysicalDeviceDescriptorIndexingFeatures vk_descriptor_indexing_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+        .pNext = nullptr,
+    };
+
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT vk_descriptor_buffer_features_ext = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+        .pNext = nullptr,
+        .descriptorBuffer = VK_TRUE,
+    };
+
+    VkPhysicalDeviceBufferDeviceAddressFeatures vk_buffer_device_address_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES,
+        .pNext = nullptr,
+        .bufferDeviceAddress = VK_TRUE,
+    };
+
     #define KVK_TMP_HAS_EXT(list_, name_) (std::find_if(list_.begin(), list_.end(), [](VkExtensionProperties const& p) -> bool { return std::strcmp(p.extensionName, name_) == 0; }) != list_.end())
 
     if (create_info.presets.recommended && KVK_TMP_HAS_EXT(available_extensions, VK_EXT_PAGEABLE_DEVICE_LOCAL_MEMORY_EXTENSION_NAME)) {
@@ -620,6 +723,69 @@ VkResult create_device(VkInstance vk_instance, DeviceCreateInfo const& create_in
         vk_pnext = &vk_dynamic_rendering_features_ext;
     }
 
+    bool present_id_enabled = (create_info.presets.enable_present_id || create_info.presets.enable_present_wait) && KVK_TMP_HAS_EXT(available_extensions, VK_KHR_PRESENT_ID_EXTENSION_NAME);
+    if (present_id_enabled) {
+        enabled_extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        vk_present_id_features_khr.pNext = vk_pnext;
+        vk_pnext = &vk_present_id_features_khr;
+    }
+
+    if (create_info.presets.enable_present_wait && present_id_enabled && KVK_TMP_HAS_EXT(available_extensions, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        enabled_extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        vk_present_wait_features_khr.pNext = vk_pnext;
+        vk_pnext = &vk_present_wait_features_khr;
+    }
+
+    if (create_info.presets.enable_timeline_semaphore) {
+        /* core since 1.2, but the feature still has to be enabled */
+        if (KVK_TMP_HAS_EXT(available_extensions, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+            enabled_extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        }
+
+        vk_timeline_semaphore_features_khr.pNext = vk_pnext;
+        vk_pnext = &vk_timeline_semaphore_features_khr;
+    }
+
+    if (create_info.presets.enable_synchronization2) {
+        enabled_extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        vk_synchronization2_features_khr.pNext = vk_pnext;
+        vk_pnext = &vk_synchronization2_features_khr;
+    }
+
+    if (create_info.presets.enable_push_descriptor && KVK_TMP_HAS_EXT(available_extensions, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)) {
+        enabled_extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
+
+    if (create_info.presets.enable_descriptor_buffer) {
+        enabled_extensions.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+        vk_descriptor_buffer_features_ext.pNext = vk_pnext;
+        vk_pnext = &vk_descriptor_buffer_features_ext;
+
+        /* core since 1.2 */
+        if (KVK_TMP_HAS_EXT(available_extensions, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME)) {
+            enabled_extensions.push_back(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+        }
+
+        vk_buffer_device_address_features.pNext = vk_pnext;
+        vk_pnext = &vk_buffer_device_address_features;
+    }
+
+    if (create_info.presets.enable_descriptor_indexing) {
+        /* core since 1.2; the query fills in whatever the device supports, which is then enabled as is */
+        if (KVK_TMP_HAS_EXT(available_extensions, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+            enabled_extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        }
+
+        VkPhysicalDeviceFeatures2 vk_physical_device_features2 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &vk_descriptor_indexing_features,
+        };
+
+        vkGetPhysicalDeviceFeatures2(vk_physical_device, &vk_physical_device_features2);
+        vk_descriptor_indexing_features.pNext = vk_pnext;
+        vk_pnext = &vk_descriptor_indexing_features;
+    }
+
     #undef KVK_TMP_HAS_EXT
 
     VkDeviceCreateInfo vk_device_create_info = {
@@ -666,6 +832,86 @@ VkResult create_device(VkInstance vk_instance, DeviceCreateInfo const& create_in
     return vk_result;
 }
 
+static uint32_t clamp_image_count(VkSurfaceCapabilitiesKHR const& vk_surface_capabilities, uint32_t image_count) {
+    image_count = std::max(image_count, vk_surface_capabilities.minImageCount);
+    if (vk_surface_capabilities.maxImageCount != 0) {
+        image_count = std::min(image_count, vk_surface_capabilities.maxImageCount);
+    }
+
+    return image_count;
+}
+
+static void apply_swapchain_policy(SwapchainPolicy policy, uint32_t max_queued_images, VkSurfaceCapabilitiesKHR const& vk_surface_capabilities, std::vector<VkPresentModeKHR> const& vk_present_modes, uint32_t& image_count, VkPresentModeKHR& vk_present_mode, std::string& reason) {
+    auto has_mode = [&vk_present_modes](VkPresentModeKHR mode) -> bool {
+        return std::find(vk_present_modes.begin(), vk_present_modes.end(), mode) != vk_present_modes.end();
+    };
+
+    /* FIFO is the only mode every surface is required to support */
+    switch (policy) {
+        case SwapchainPolicy::LOWEST_LATENCY:
+            if (has_mode(VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+                vk_present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+                image_count = clamp_image_count(vk_surface_capabilities, 2);
+                reason = std::format("lowest latency: IMMEDIATE presents without waiting for vblank (may tear); {} images is the shortest queue the surface allows", image_count);
+            } else if (has_mode(VK_PRESENT_MODE_MAILBOX_KHR)) {
+                vk_present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+                image_count = clamp_image_count(vk_surface_capabilities, 3);
+                reason = std::format("lowest latency: IMMEDIATE unsupported; MAILBOX replaces the queued image so at most one frame waits for vblank; {} images keep rendering unblocked", image_count);
+            } else if (has_mode(VK_PRESENT_MODE_FIFO_RELAXED_KHR)) {
+                vk_present_mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+                image_count = clamp_image_count(vk_surface_capabilities, 2);
+                reason = std::format("lowest latency: IMMEDIATE and MAILBOX unsupported; FIFO_RELAXED presents late frames immediately; {} images minimise queued frames", image_count);
+            } else {
+                vk_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+                image_count = clamp_image_count(vk_surface_capabilities, 2);
+                reason = std::format("lowest latency: only FIFO supported; {} images minimise queued frames", image_count);
+            }
+            break;
+        case SwapchainPolicy::LOWEST_POWER:
+            vk_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+            image_count = clamp_image_count(vk_surface_capabilities, 2);
+            reason = std::format("lowest power: FIFO caps the frame rate at the refresh rate so the GPU idles between frames; {} images avoid rendering ahead", image_count);
+            break;
+        case SwapchainPolicy::NO_TEARING_BOUNDED: {
+            uint32_t bound = std::max(max_queued_images, 1u);
+            if (has_mode(VK_PRESENT_MODE_MAILBOX_KHR) && clamp_image_count(vk_surface_capabilities, 3) >= 3) {
+                vk_present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+                image_count = clamp_image_count(vk_surface_capabilities, 3);
+                reason = std::format("no tearing: MAILBOX never tears and never queues more than one image (bound {}); {} images", bound, image_count);
+            } else {
+                vk_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+                image_count = clamp_image_count(vk_surface_capabilities, bound + 1);
+                if (image_count > bound + 1) {
+                    reason = std::format("no tearing: FIFO with {} images; the surface minimum exceeds the requested bound of {} queued images", image_count, bound);
+                } else {
+                    reason = std::format("no tearing: FIFO with {} images queues at most {} frames", image_count, image_count - 1);
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/* optimal tiling features an image format needs for a single usage bit; swapchain images are always optimally tiled */
+static VkFormatFeatureFlags format_features_for_usage(VkImageUsageFlagBits vk_usage) {
+    switch (vk_usage) {
+        case VK_IMAGE_USAGE_TRANSFER_SRC_BIT:
+            return VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
+        case VK_IMAGE_USAGE_TRANSFER_DST_BIT:
+            return VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+        case VK_IMAGE_USAGE_SAMPLED_BIT:
+            return VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+        case VK_IMAGE_USAGE_STORAGE_BIT:
+            return VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+        case VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT:
+            return VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT;
+        default:
+            return 0;
+    }
+}
+
 VkResult create_swapchain(VkDevice vk_device, SwapchainCreateInfo const& create_info, SwapchainReturns& returns) {
     VkSurfaceCapabilitiesKHR vk_surface_capabilities;
     VkResult vk_result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(create_info.vk_physical_device, create_info.vk_surface, &vk_surface_capabilities);
@@ -727,10 +973,31 @@ VkResult create_swapchain(VkDevice vk_device, SwapchainCreateInfo const& create_
         return vk_result;
     }
 
-    uint32_t chosen_preference = std::numeric_limits<uint32_t>::max();
+    if ((create_info.vk_image_usage & ~vk_surface_capabilities.supportedUsageFlags) != 0) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Requested swapchain image usage {:#x} is not supported by the surface (supported {:#x})", create_info.vk_image_usage, vk_surface_capabilities.supportedUsageFlags);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    std::vector<uint32_t> preference_order;
+    preference_order.reserve(create_info.preferences.size() + 1);
+    if (create_info.preference_override.has_value()) {
+        if (create_info.preference_override.value() < create_info.preferences.size()) {
+            preference_order.push_back(create_info.preference_override.value());
+        } else {
+            KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Swapchain preference override {} is out of range ({} preferences); ignoring", create_info.preference_override.value(), create_info.preferences.size());
+        }
+    }
+
     for (uint32_t i = 0; i < create_info.preferences.size(); ++i) {
+        preference_order.push_back(i);
+    }
+
+    bool policy_driven = create_info.policy != SwapchainPolicy::PREFERENCES;
+
+    uint32_t chosen_preference = std::numeric_limits<uint32_t>::max();
+    for (uint32_t i : preference_order) {
         SwapchainPreference const& p = create_info.preferences[i];
-        if (p.image_count < vk_surface_capabilities.minImageCount) {
+        if (!policy_driven && p.image_count < vk_surface_capabilities.minImageCount) {
             KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Swapchain preference at index {} requests image count {} which is less than the surface's minimum supported image count {}", i, p.image_count, vk_surface_capabilities.minImageCount);
             continue;
         }
@@ -745,7 +1012,7 @@ VkResult create_swapchain(VkDevice vk_device, SwapchainCreateInfo const& create_
             continue;
         }
 
-        if (std::find(vk_present_modes.begin(), vk_present_modes.end(), p.vk_present_mode) == vk_present_modes.end()) {
+        if (!policy_driven && std::find(vk_present_modes.begin(), vk_present_modes.end(), p.vk_present_mode) == vk_present_modes.end()) {
             KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Swapchain preference at index {} requests unsupported present mode {}", i, p.vk_present_mode);
             continue;
         }
@@ -762,23 +1029,57 @@ VkResult create_swapchain(VkDevice vk_device, SwapchainCreateInfo const& create_
 
     SwapchainPreference const& preference = create_info.preferences[chosen_preference];
 
+    uint32_t image_count = preference.image_count;
+    VkPresentModeKHR vk_present_mode = preference.vk_present_mode;
+    std::string choice_reason = std::format("preference {} is the first supported entry", chosen_preference);
+    if (policy_driven) {
+        apply_swapchain_policy(create_info.policy, create_info.policy_max_queued_images, vk_surface_capabilities, vk_present_modes, image_count, vk_present_mode, choice_reason);
+        KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Swapchain policy chose present mode {} with {} images: {}", vk_present_mode, image_count, choice_reason);
+    }
+
+    VkImageUsageFlags vk_image_usage = create_info.vk_image_usage;
+    if (create_info.vk_optional_image_usage != 0) {
+        VkFormatProperties vk_format_properties;
+        vkGetPhysicalDeviceFormatProperties(create_info.vk_physical_device, preference.vk_surface_format.format, &vk_format_properties);
+
+        for (uint32_t bit = 0; bit < 32; ++bit) {
+            VkImageUsageFlagBits vk_usage = static_cast<VkImageUsageFlagBits>(1u << bit);
+            if ((create_info.vk_optional_image_usage & vk_usage) == 0) {
+                continue;
+            }
+
+            if ((vk_surface_capabilities.supportedUsageFlags & vk_usage) == 0) {
+                KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Optional swapchain image usage {:#x} is not supported by the surface; leaving it out", static_cast<uint32_t>(vk_usage));
+                continue;
+            }
+
+            VkFormatFeatureFlags vk_required_features = format_features_for_usage(vk_usage);
+            if ((vk_format_properties.optimalTilingFeatures & vk_required_features) != vk_required_features) {
+                KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Optional swapchain image usage {:#x} is not supported by format {}; leaving it out", static_cast<uint32_t>(vk_usage), preference.vk_surface_format.format);
+                continue;
+            }
+
+            vk_image_usage |= vk_usage;
+        }
+    }
+
     VkSwapchainCreateInfoKHR vk_swapchain_create_info = {
         .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
         .pNext = create_info.vk_pnext,
         .flags = create_info.vk_flags,
         .surface = create_info.vk_surface,
-        .minImageCount = preference.image_count,
+        .minImageCount = image_count,
         .imageFormat = preference.vk_surface_format.format,
         .imageColorSpace = preference.vk_surface_format.colorSpace,
         .imageExtent = vk_swapchain_extent,
         .imageArrayLayers = preference.layer_count,
-        .imageUsage = create_info.vk_image_usage,
+        .imageUsage = vk_image_usage,
         .imageSharingMode = create_info.vk_image_sharing_mode,
         .queueFamilyIndexCount = static_cast<uint32_t>(create_info.vk_queue_family_indices.size()),
         .pQueueFamilyIndices = create_info.vk_queue_family_indices.size() == 0 ? nullptr : create_info.vk_queue_family_indices.data(),
         .preTransform = create_info.vk_pre_transform,
         .compositeAlpha = create_info.vk_composite_alpha,
-        .presentMode = preference.vk_present_mode,
+        .presentMode = vk_present_mode,
         .clipped = create_info.vk_clipped,
         .oldSwapchain = create_info.vk_old_swapchain,
     };
@@ -816,6 +1117,11 @@ VkResult create_swapchain(VkDevice vk_device, SwapchainCreateInfo const& create_
     returns.vk_swapchain = vk_swapchain;
     returns.chosen_preference = chosen_preference;
     returns.vk_current_extent = vk_swapchain_extent;
+    returns.image_count = image_count;
+    returns.vk_surface_format = preference.vk_surface_format;
+    returns.vk_present_mode = vk_present_mode;
+    returns.vk_image_usage = vk_image_usage;
+    returns.choice_reason = std::move(choice_reason);
 
     return VK_SUCCESS;
 }
@@ -878,8 +1184,14 @@ VkResult mono_alloc_for_residents(VkDevice vk_device, MonoAllocationCreateInfo c
         return VK_ERROR_MEMORY_MAP_FAILED;
     }
 
+    VkMemoryAllocateFlagsInfo vk_memory_allocate_flags_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+        .flags = create_info.vk_memory_allocate_flags,
+    };
+
     VkMemoryAllocateInfo vk_memory_allocate_info = {
         .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = create_info.vk_memory_allocate_flags == 0 ? nullptr : &vk_memory_allocate_flags_info,
         .allocationSize = total_size,
         .memoryTypeIndex = memory_type_index,
     };
@@ -893,6 +1205,7 @@ VkResult mono_alloc_for_residents(VkDevice vk_device, MonoAllocationCreateInfo c
 
     heap.vk_heap_memory = vk_heap_memory;
     heap.vk_heap_size = total_size;
+    heap.memory_type_index = memory_type_index;
     heap.residents = {};
 
     for (size_t i = 0; i < create_info.residents.size(); ++i) {
@@ -934,6 +1247,65 @@ VkResult mono_bind_residents(VkDevice vk_device, MonoAllocationHeap& heap) {
     return VK_SUCCESS;
 }
 
+VkResult mono_place_resident(VkDevice vk_device, MonoAllocationHeap& heap, MonoAllocationResidentID id) {
+    VkMemoryRequirements vk_memory_requirements;
+    if (id.is_image) {
+        vkGetImageMemoryRequirements(vk_device, id.vk_image, &vk_memory_requirements);
+    } else {
+        vkGetBufferMemoryRequirements(vk_device, id.vk_buffer, &vk_memory_requirements);
+    }
+
+    if ((vk_memory_requirements.memoryTypeBits & (1u << heap.memory_type_index)) == 0) {
+        KVK_ERR(VK_ERROR_MEMORY_MAP_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Resident can't live in the heap's memory type {}", heap.memory_type_index);
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+
+    std::vector<MonoAllocationResident const*> occupied;
+    for (auto const& p : heap.residents) {
+        occupied.push_back(&p.second);
+    }
+
+    std::sort(occupied.begin(), occupied.end(), [](MonoAllocationResident const* a, MonoAllocationResident const* b) -> bool {
+        return a->vk_heap_offset < b->vk_heap_offset;
+    });
+
+    /* gaps between residents in offset order, then the tail */
+    VkDeviceSize offset = 0;
+    for (size_t i = 0; i <= occupied.size(); ++i) {
+        VkDeviceSize r = offset % vk_memory_requirements.alignment;
+        offset += r == 0 ? 0 : vk_memory_requirements.alignment - r;
+
+        VkDeviceSize gap_end = i < occupied.size() ? occupied[i]->vk_heap_offset : heap.vk_heap_size;
+        if (offset + vk_memory_requirements.size <= gap_end) {
+            heap.residents[id] = {
+                .id = id,
+                .vk_heap_offset = offset,
+                .vk_alignment = vk_memory_requirements.alignment,
+                .vk_size = vk_memory_requirements.size,
+            };
+
+            return VK_SUCCESS;
+        }
+
+        if (i < occupied.size()) {
+            offset = std::max(offset, occupied[i]->vk_heap_offset + occupied[i]->vk_size);
+        }
+    }
+
+    KVK_ERR(VK_ERROR_OUT_OF_DEVICE_MEMORY, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "No free range of {} bytes in mono heap of {} bytes", vk_memory_requirements.size, heap.vk_heap_size);
+    return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+}
+
+void mono_release_resident(VkDevice vk_device, MonoAllocationHeap& heap, MonoAllocationResidentID id) {
+    if (id.is_image) {
+        vkDestroyImage(vk_device, id.vk_image, nullptr);
+    } else {
+        vkDestroyBuffer(vk_device, id.vk_buffer, nullptr);
+    }
+
+    heap.residents.erase(id);
+}
+
 void mono_free_heap(VkDevice vk_device, MonoAllocationHeap& heap) {
     if (heap.vk_heap_memory != VK_NULL_HANDLE) {
         for (auto& p : heap.residents) {
@@ -955,22 +1327,4 @@ void mono_free_heap(VkDevice vk_device, MonoAllocationHeap& heap) {
 
 }
 
-namespace shader {
-
-#ifdef KVK_USE_DXC
-
-namespace hlsl {
-
-/* adapted from https://github.com/krisvers/vulkan-sandbox/blob/e3a6738e790bcab9647da5218fe49cd728bf0ade/main.odin#L342 */
-VkResult compile(VkDevice vk_device, std::string const& source, std::string const& entry, VkShaderStageFlags vk_shader_stage_flags, VkShaderModule& vk_shader_module) {
-    /* TODO: implement */
-    return VK_ERROR_FEATURE_NOT_PRESENT;
-}
-
-}
-
-#endif
-
-}
-
 }
@@ -0,0 +1,248 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <cstring>
+
+#ifdef KVK_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace kvk {
+
+namespace shader {
+
+static constexpr uint32_t ARCHIVE_MAGIC = 0x414b564b; /* "KVKA" */
+static constexpr uint32_t ARCHIVE_VERSION = 1;
+static constexpr uint64_t ARCHIVE_ALIGNMENT = 16;
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+VkResult write_archive(std::string const& path, std::vector<ArchiveModule> const& modules) {
+    ArchiveHeader header = {
+        .magic = ARCHIVE_MAGIC,
+        .version = ARCHIVE_VERSION,
+        .entry_count = static_cast<uint32_t>(modules.size()),
+        .names_size = 0,
+    };
+
+    std::string names;
+    std::vector<ArchiveEntry> entries(modules.size());
+    for (uint32_t i = 0; i < modules.size(); ++i) {
+        entries[i].name_offset = static_cast<uint32_t>(names.size());
+        entries[i].name_size = static_cast<uint32_t>(modules[i].name.size());
+        names += modules[i].name;
+    }
+
+    header.names_size = static_cast<uint32_t>(names.size());
+
+    uint64_t offset = align_up(sizeof(header) + entries.size() * sizeof(ArchiveEntry) + names.size(), ARCHIVE_ALIGNMENT);
+    for (uint32_t i = 0; i < modules.size(); ++i) {
+        entries[i].offset = offset;
+        entries[i].size = modules[i].spirv.size() * sizeof(uint32_t);
+        offset = align_up(offset + entries[i].size, ARCHIVE_ALIGNMENT);
+    }
+
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp";
+
+    {
+        std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        out.write(reinterpret_cast<char const*>(entries.data()), entries.size() * sizeof(ArchiveEntry));
+        out.write(names.data(), names.size());
+
+        char const padding[ARCHIVE_ALIGNMENT] = {};
+        for (uint32_t i = 0; i < modules.size(); ++i) {
+            out.write(padding, entries[i].offset - static_cast<uint64_t>(out.tellp()));
+            out.write(reinterpret_cast<char const*>(modules[i].spirv.data()), entries[i].size);
+        }
+
+        if (!out) {
+            KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to write shader archive \"{}\"", temporary_path.string());
+            out.close();
+            std::error_code error;
+            std::filesystem::remove(temporary_path, error);
+            return VK_ERROR_UNKNOWN;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to replace shader archive \"{}\": {}", path, error.message());
+        std::filesystem::remove(temporary_path, error);
+        return VK_ERROR_UNKNOWN;
+    }
+
+    return VK_SUCCESS;
+}
+
+static bool map_file(std::string const& path, Archive& archive) {
+#ifdef KVK_WINDOWS
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    void const* data = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        }
+    }
+
+    if (data == nullptr) {
+        if (mapping != nullptr) {
+            CloseHandle(mapping);
+        }
+
+        CloseHandle(file);
+        return false;
+    }
+
+    archive.data = reinterpret_cast<uint8_t const*>(data);
+    archive.size = static_cast<size_t>(size.QuadPart);
+    archive.file = file;
+    archive.mapping = mapping;
+    return true;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+
+    struct stat status;
+    void* data = MAP_FAILED;
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    }
+
+    /* the mapping keeps the file alive on its own */
+    close(file);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    archive.data = reinterpret_cast<uint8_t const*>(data);
+    archive.size = static_cast<size_t>(status.st_size);
+    archive.file = nullptr;
+    archive.mapping = nullptr;
+    return true;
+#endif
+}
+
+static void unmap_file(Archive& archive) {
+#ifdef KVK_WINDOWS
+    UnmapViewOfFile(archive.data);
+    CloseHandle(reinterpret_cast<HANDLE>(archive.mapping));
+    CloseHandle(reinterpret_cast<HANDLE>(archive.file));
+#else
+    munmap(const_cast<uint8_t*>(archive.data), archive.size);
+#endif
+
+    archive.data = nullptr;
+    archive.size = 0;
+    archive.file = nullptr;
+    archive.mapping = nullptr;
+}
+
+VkResult open_archive(std::string const& path, Archive& archive) {
+    archive.index.clear();
+    if (!map_file(path, archive)) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to map shader archive \"{}\"", path);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    ArchiveHeader header;
+    bool valid = archive.size >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, archive.data, sizeof(header));
+        valid = header.magic == ARCHIVE_MAGIC && header.version == ARCHIVE_VERSION && sizeof(header) + static_cast<uint64_t>(header.entry_count) * sizeof(ArchiveEntry) + header.names_size <= archive.size;
+    }
+
+    if (!valid) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "\"{}\" is not a shader archive, or is truncated", path);
+        unmap_file(archive);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    ArchiveEntry const* entries = reinterpret_cast<ArchiveEntry const*>(archive.data + sizeof(header));
+    char const* names = reinterpret_cast<char const*>(entries + header.entry_count);
+    for (uint32_t i = 0; i < header.entry_count; ++i) {
+        ArchiveEntry const& entry = entries[i];
+        if (static_cast<uint64_t>(entry.name_offset) + entry.name_size > header.names_size || entry.offset % sizeof(uint32_t) != 0 || entry.size % sizeof(uint32_t) != 0 || entry.offset > archive.size || entry.size > archive.size - entry.offset) {
+            KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Shader archive \"{}\" has a corrupt entry {}", path, i);
+            unmap_file(archive);
+            archive.index.clear();
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        archive.index.emplace(std::string(names + entry.name_offset, entry.name_size), i);
+    }
+
+    return VK_SUCCESS;
+}
+
+void close_archive(Archive& archive) {
+    if (archive.data != nullptr) {
+        unmap_file(archive);
+    }
+
+    archive.index.clear();
+}
+
+bool find(Archive const& archive, std::string const& name, uint32_t const*& code, size_t& size) {
+    auto it = archive.index.find(name);
+    if (it == archive.index.end()) {
+        return false;
+    }
+
+    ArchiveEntry const& entry = reinterpret_cast<ArchiveEntry const*>(archive.data + sizeof(ArchiveHeader))[it->second];
+    code = reinterpret_cast<uint32_t const*>(archive.data + entry.offset);
+    size = static_cast<size_t>(entry.size);
+    return true;
+}
+
+VkResult create_module(VkDevice vk_device, Archive const& archive, std::string const& name, VkShaderModule& vk_shader_module) {
+    uint32_t const* code;
+    size_t size;
+    if (!find(archive, name, code, size)) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Shader archive has no module \"{}\"", name);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkShaderModuleCreateInfo vk_shader_module_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = size,
+        .pCode = code,
+    };
+
+    VkResult vk_result = vkCreateShaderModule(vk_device, &vk_shader_module_create_info, nullptr, &vk_shader_module);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create shader module \"{}\" from archive", name);
+        return vk_result;
+    }
+
+    return VK_SUCCESS;
+}
+
+}
+
+}
@@ -0,0 +1,249 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <algorithm>
+
+namespace kvk {
+
+namespace bindless {
+
+static constexpr uint32_t DEFAULT_CAPACITY_CAP = 65536;
+
+static uint32_t resolve_capacity(uint32_t requested, uint32_t device_limit) {
+    if (requested == 0) {
+        return std::min(device_limit, DEFAULT_CAPACITY_CAP);
+    }
+
+    return std::min(requested, device_limit);
+}
+
+VkResult create_bindless_heap(VkDevice vk_device, BindlessHeapCreateInfo const& create_info, BindlessHeap& heap) {
+    VkPhysicalDeviceDescriptorIndexingProperties vk_descriptor_indexing_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES,
+    };
+
+    VkPhysicalDeviceProperties2 vk_physical_device_properties2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &vk_descriptor_indexing_properties,
+    };
+
+    vkGetPhysicalDeviceProperties2(create_info.vk_physical_device, &vk_physical_device_properties2);
+
+    VkPhysicalDeviceDescriptorIndexingFeatures vk_descriptor_indexing_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+    };
+
+    VkPhysicalDeviceFeatures2 vk_physical_device_features2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &vk_descriptor_indexing_features,
+    };
+
+    vkGetPhysicalDeviceFeatures2(create_info.vk_physical_device, &vk_physical_device_features2);
+    if (!vk_descriptor_indexing_features.descriptorBindingPartiallyBound || !vk_descriptor_indexing_features.descriptorBindingStorageBufferUpdateAfterBind || !vk_descriptor_indexing_features.descriptorBindingStorageImageUpdateAfterBind || !vk_descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind) {
+        KVK_ERR(VK_ERROR_FEATURE_NOT_PRESENT, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Physical device lacks the partially bound and update-after-bind descriptor indexing features a bindless heap needs");
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+
+    /* every binding is visible to each of vk_stages, so the per-stage limits apply on top of the per-set ones */
+    VkPhysicalDeviceDescriptorIndexingProperties const& limits = vk_descriptor_indexing_properties;
+    uint32_t capacities[static_cast<uint32_t>(BindlessType::COUNT)] = {
+        resolve_capacity(create_info.max_storage_buffers, std::min(limits.maxDescriptorSetUpdateAfterBindStorageBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers)),
+        resolve_capacity(create_info.max_storage_images, std::min(limits.maxDescriptorSetUpdateAfterBindStorageImages, limits.maxPerStageDescriptorUpdateAfterBindStorageImages)),
+        resolve_capacity(create_info.max_sampled_images, std::min(limits.maxDescriptorSetUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSampledImages)),
+    };
+
+    /* the arrays also share one per-stage resource budget; scale them down together when they'd exceed it */
+    uint64_t total = 0;
+    for (uint32_t capacity : capacities) {
+        total += capacity;
+    }
+
+    if (total > limits.maxPerStageUpdateAfterBindResources) {
+        KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Bindless arrays total {} descriptors, more than the {} update-after-bind resources a stage may access; shrinking them", total, limits.maxPerStageUpdateAfterBindResources);
+        for (uint32_t& capacity : capacities) {
+            capacity = static_cast<uint32_t>(static_cast<uint64_t>(capacity) * limits.maxPerStageUpdateAfterBindResources / total);
+        }
+    }
+
+    VkDescriptorType vk_descriptor_types[static_cast<uint32_t>(BindlessType::COUNT)] = {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+    };
+
+    VkDescriptorSetLayoutBinding vk_bindings[static_cast<uint32_t>(BindlessType::COUNT)];
+    VkDescriptorBindingFlags vk_binding_flags[static_cast<uint32_t>(BindlessType::COUNT)];
+    VkDescriptorPoolSize vk_pool_sizes[static_cast<uint32_t>(BindlessType::COUNT)];
+    for (uint32_t i = 0; i < static_cast<uint32_t>(BindlessType::COUNT); ++i) {
+        vk_bindings[i] = {
+            .binding = i,
+            .descriptorType = vk_descriptor_types[i],
+            .descriptorCount = capacities[i],
+            .stageFlags = create_info.vk_stages,
+        };
+
+        vk_binding_flags[i] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+        if (vk_descriptor_indexing_features.descriptorBindingUpdateUnusedWhilePending) {
+            vk_binding_flags[i] |= VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+        }
+
+        vk_pool_sizes[i] = {
+            .type = vk_descriptor_types[i],
+            .descriptorCount = capacities[i],
+        };
+
+        heap.arrays[i] = {
+            .capacity = capacities[i],
+            .next = 0,
+        };
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo vk_descriptor_set_layout_binding_flags_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(BindlessType::COUNT),
+        .pBindingFlags = &vk_binding_flags[0],
+    };
+
+    VkDescriptorSetLayoutCreateInfo vk_descriptor_set_layout_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &vk_descriptor_set_layout_binding_flags_create_info,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = static_cast<uint32_t>(BindlessType::COUNT),
+        .pBindings = &vk_bindings[0],
+    };
+
+    VkResult vk_result = vkCreateDescriptorSetLayout(vk_device, &vk_descriptor_set_layout_create_info, nullptr, &heap.vk_descriptor_set_layout);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create bindless descriptor set layout; was the device created with DevicePresets::enable_descriptor_indexing?");
+        return vk_result;
+    }
+
+    VkDescriptorPoolCreateInfo vk_descriptor_pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = 1,
+        .poolSizeCount = static_cast<uint32_t>(BindlessType::COUNT),
+        .pPoolSizes = &vk_pool_sizes[0],
+    };
+
+    vk_result = vkCreateDescriptorPool(vk_device, &vk_descriptor_pool_create_info, nullptr, &heap.vk_descriptor_pool);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create bindless descriptor pool");
+        vkDestroyDescriptorSetLayout(vk_device, heap.vk_descriptor_set_layout, nullptr);
+        return vk_result;
+    }
+
+    VkDescriptorSetAllocateInfo vk_descriptor_set_allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = heap.vk_descriptor_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &heap.vk_descriptor_set_layout,
+    };
+
+    vk_result = vkAllocateDescriptorSets(vk_device, &vk_descriptor_set_allocate_info, &heap.vk_descriptor_set);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to allocate bindless descriptor set");
+        vkDestroyDescriptorPool(vk_device, heap.vk_descriptor_pool, nullptr);
+        vkDestroyDescriptorSetLayout(vk_device, heap.vk_descriptor_set_layout, nullptr);
+        return vk_result;
+    }
+
+    KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Created bindless heap with {} storage buffers, {} storage images and {} sampled images", capacities[0], capacities[1], capacities[2]);
+    return VK_SUCCESS;
+}
+
+void destroy_bindless_heap(VkDevice vk_device, BindlessHeap& heap) {
+    vkDestroyDescriptorPool(vk_device, heap.vk_descriptor_pool, nullptr);
+    vkDestroyDescriptorSetLayout(vk_device, heap.vk_descriptor_set_layout, nullptr);
+    heap.vk_descriptor_pool = VK_NULL_HANDLE;
+    heap.vk_descriptor_set_layout = VK_NULL_HANDLE;
+    heap.vk_descriptor_set = VK_NULL_HANDLE;
+}
+
+/* recycled indices first so the live range stays dense */
+static uint32_t take_index(BindlessHeap& heap, BindlessType type) {
+    BindlessArray& array = heap.arrays[static_cast<uint32_t>(type)];
+    if (!array.free_indices.empty()) {
+        uint32_t index = array.free_indices.back();
+        array.free_indices.pop_back();
+        return index;
+    }
+
+    if (array.next >= array.capacity) {
+        KVK_ERR(VK_ERROR_OUT_OF_POOL_MEMORY, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Bindless array {} is full at {} descriptors", static_cast<uint32_t>(type), array.capacity);
+        return INVALID_INDEX;
+    }
+
+    return array.next++;
+}
+
+static uint32_t write_descriptor(VkDevice vk_device, BindlessHeap& heap, BindlessType type, VkDescriptorType vk_descriptor_type, VkDescriptorBufferInfo const* vk_buffer_info, VkDescriptorImageInfo const* vk_image_info) {
+    std::lock_guard<std::mutex> lock(heap.mutex);
+    uint32_t index = take_index(heap, type);
+    if (index == INVALID_INDEX) {
+        return INVALID_INDEX;
+    }
+
+    VkWriteDescriptorSet vk_write_descriptor_set = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = heap.vk_descriptor_set,
+        .dstBinding = static_cast<uint32_t>(type),
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = vk_descriptor_type,
+        .pImageInfo = vk_image_info,
+        .pBufferInfo = vk_buffer_info,
+    };
+
+    vkUpdateDescriptorSets(vk_device, 1, &vk_write_descriptor_set, 0, nullptr);
+    return index;
+}
+
+uint32_t add_storage_buffer(VkDevice vk_device, BindlessHeap& heap, VkDescriptorBufferInfo const& vk_descriptor_buffer_info) {
+    return write_descriptor(vk_device, heap, BindlessType::STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &vk_descriptor_buffer_info, nullptr);
+}
+
+uint32_t add_storage_image(VkDevice vk_device, BindlessHeap& heap, VkImageView vk_image_view, VkImageLayout vk_image_layout) {
+    VkDescriptorImageInfo vk_descriptor_image_info = {
+        .imageView = vk_image_view,
+        .imageLayout = vk_image_layout,
+    };
+
+    return write_descriptor(vk_device, heap, BindlessType::STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, nullptr, &vk_descriptor_image_info);
+}
+
+uint32_t add_sampled_image(VkDevice vk_device, BindlessHeap& heap, VkImageView vk_image_view, VkImageLayout vk_image_layout) {
+    VkDescriptorImageInfo vk_descriptor_image_info = {
+        .imageView = vk_image_view,
+        .imageLayout = vk_image_layout,
+    };
+
+    return write_descriptor(vk_device, heap, BindlessType::SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, nullptr, &vk_descriptor_image_info);
+}
+
+void release(BindlessHeap& heap, BindlessType type, uint32_t index) {
+    if (index == INVALID_INDEX) {
+        return;
+    }
+
+    /* partially bound, so the stale descriptor can stay until the index is written again */
+    std::lock_guard<std::mutex> lock(heap.mutex);
+    heap.arrays[static_cast<uint32_t>(type)].free_indices.push_back(index);
+}
+
+void defer_release(deletion::DeletionQueue& queue, scheduler::WorkHandle after, BindlessHeap& heap, BindlessType type, uint32_t index) {
+    deletion::defer(queue, after, [](VkDevice, uint64_t handle, void* pdata) {
+        release(*reinterpret_cast<BindlessHeap*>(pdata), static_cast<BindlessType>(handle >> 32), static_cast<uint32_t>(handle));
+    }, (static_cast<uint64_t>(type) << 32) | index, &heap);
+}
+
+void cmd_bind(VkCommandBuffer vk_command_buffer, BindlessHeap const& heap, VkPipelineBindPoint vk_pipeline_bind_point, VkPipelineLayout vk_pipeline_layout, uint32_t set_index) {
+    vkCmdBindDescriptorSets(vk_command_buffer, vk_pipeline_bind_point, vk_pipeline_layout, set_index, 1, &heap.vk_descriptor_set, 0, nullptr);
+}
+
+}
+
+}
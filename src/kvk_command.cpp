@@ -0,0 +1,217 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <algorithm>
+
+namespace kvk {
+
+namespace command {
+
+VkResult create_recycler(VkDevice vk_device, RecyclerCreateInfo const& create_info, Recycler& recycler) {
+    if (create_info.thread_count == 0 || create_info.frames_in_flight == 0) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Command recycler requires at least one thread and one frame in flight (got {} threads, {} frames)", create_info.thread_count, create_info.frames_in_flight);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkCommandPoolCreateInfo vk_command_pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = create_info.vk_flags | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = create_info.queue_family_index,
+    };
+
+    recycler.frame_index = 0;
+    recycler.allocation_batch_size = std::max(create_info.allocation_batch_size, 1u);
+    recycler.threads.assign(create_info.thread_count, {});
+
+    for (uint32_t t = 0; t < create_info.thread_count; ++t) {
+        recycler.threads[t].frames.assign(create_info.frames_in_flight, {});
+        for (uint32_t f = 0; f < create_info.frames_in_flight; ++f) {
+            VkResult vk_result = vkCreateCommandPool(vk_device, &vk_command_pool_create_info, nullptr, &recycler.threads[t].frames[f].vk_command_pool);
+            if (vk_result != VK_SUCCESS) {
+                KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create command pool for recycler thread {} frame {}", t, f);
+                destroy_recycler(vk_device, recycler);
+                return vk_result;
+            }
+        }
+    }
+
+    return VK_SUCCESS;
+}
+
+void destroy_recycler(VkDevice vk_device, Recycler& recycler) {
+    /* destroying a pool frees every buffer allocated from it */
+    for (RecyclerThread& thread : recycler.threads) {
+        for (RecyclerPool& pool : thread.frames) {
+            if (pool.vk_command_pool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(vk_device, pool.vk_command_pool, nullptr);
+            }
+        }
+    }
+
+    recycler.threads.clear();
+    recycler.frame_index = 0;
+}
+
+VkResult begin_frame(VkDevice vk_device, Recycler& recycler, uint32_t frame_index) {
+    if (recycler.threads.empty() || frame_index >= recycler.threads[0].frames.size()) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Command recycler frame index {} is out of range", frame_index);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    for (uint32_t t = 0; t < recycler.threads.size(); ++t) {
+        RecyclerPool& pool = recycler.threads[t].frames[frame_index];
+        if (pool.primaries_used == 0 && pool.secondaries_used == 0) {
+            continue;
+        }
+
+        VkResult vk_result = vkResetCommandPool(vk_device, pool.vk_command_pool, 0);
+        if (vk_result != VK_SUCCESS) {
+            KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to reset command pool for recycler thread {} frame {}", t, frame_index);
+            return vk_result;
+        }
+
+        pool.primaries_used = 0;
+        pool.secondaries_used = 0;
+    }
+
+    recycler.frame_index = frame_index;
+    return VK_SUCCESS;
+}
+
+VkResult acquire_command_buffer(VkDevice vk_device, Recycler& recycler, uint32_t thread_index, VkCommandBufferLevel vk_level, VkCommandBuffer& vk_command_buffer) {
+    if (thread_index >= recycler.threads.size()) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Command recycler thread index {} is out of range ({} threads)", thread_index, recycler.threads.size());
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    RecyclerThread& thread = recycler.threads[thread_index];
+    if (!thread.owned) {
+        thread.owner = std::this_thread::get_id();
+        thread.owned = true;
+    } else if (thread.owner != std::this_thread::get_id()) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Command recycler thread index {} used from a thread other than its owner; command pools must not be shared across threads", thread_index);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    RecyclerPool& pool = thread.frames[recycler.frame_index];
+    bool primary = vk_level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    std::vector<VkCommandBuffer>& free_list = primary ? pool.vk_primaries : pool.vk_secondaries;
+    uint32_t& used = primary ? pool.primaries_used : pool.secondaries_used;
+
+    if (used == free_list.size()) {
+        VkCommandBufferAllocateInfo vk_command_buffer_allocate_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = pool.vk_command_pool,
+            .level = vk_level,
+            .commandBufferCount = recycler.allocation_batch_size,
+        };
+
+        free_list.resize(used + recycler.allocation_batch_size);
+        VkResult vk_result = vkAllocateCommandBuffers(vk_device, &vk_command_buffer_allocate_info, &free_list[used]);
+        if (vk_result != VK_SUCCESS) {
+            free_list.resize(used);
+            KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to allocate {} command buffers for recycler thread {} frame {}", recycler.allocation_batch_size, thread_index, recycler.frame_index);
+            return vk_result;
+        }
+    }
+
+    vk_command_buffer = free_list[used++];
+    return VK_SUCCESS;
+}
+
+struct ParallelRecordBatches {
+    VkDevice vk_device;
+    Recycler* recycler;
+    ParallelRecordInfo const* record_info;
+    VkCommandBufferBeginInfo const* vk_begin_info;
+    uint32_t items_per_batch;
+
+    std::vector<VkCommandBuffer> vk_secondaries;
+    std::vector<VkResult> vk_results;
+};
+
+static void record_batch(uint32_t begin, uint32_t end, uint32_t worker_index, void* pdata) {
+    ParallelRecordBatches& batches = *reinterpret_cast<ParallelRecordBatches*>(pdata);
+
+    /* parallel_for() hands out one batch per job, so the batch index doubles as the stitching slot */
+    for (uint32_t batch = begin; batch < end; ++batch) {
+        VkCommandBuffer vk_secondary;
+        VkResult vk_result = acquire_command_buffer(batches.vk_device, *batches.recycler, worker_index, VK_COMMAND_BUFFER_LEVEL_SECONDARY, vk_secondary);
+        if (vk_result != VK_SUCCESS) {
+            batches.vk_results[batch] = vk_result;
+            continue;
+        }
+
+        vk_result = vkBeginCommandBuffer(vk_secondary, batches.vk_begin_info);
+        if (vk_result != VK_SUCCESS) {
+            batches.vk_results[batch] = vk_result;
+            continue;
+        }
+
+        uint32_t item_begin = batch * batches.items_per_batch;
+        uint32_t item_end = std::min(item_begin + batches.items_per_batch, batches.record_info->item_count);
+        batches.record_info->record(vk_secondary, item_begin, item_end, batches.record_info->pdata);
+
+        batches.vk_results[batch] = vkEndCommandBuffer(vk_secondary);
+        batches.vk_secondaries[batch] = vk_secondary;
+    }
+}
+
+VkResult record_parallel(VkDevice vk_device, job::JobSystem& jobs, Recycler& recycler, ParallelRecordInfo const& record_info) {
+    uint32_t workers = job::worker_count(jobs);
+    if (recycler.threads.size() < workers) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Parallel recording on {} workers needs a recycler with at least as many threads (has {})", workers, recycler.threads.size());
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    if (record_info.item_count == 0) {
+        return VK_SUCCESS;
+    }
+
+    uint32_t items_per_batch = record_info.items_per_batch;
+    if (items_per_batch == 0) {
+        items_per_batch = (record_info.item_count + workers - 1) / workers;
+    }
+
+    VkCommandBufferInheritanceInfo vk_default_inheritance_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+    };
+
+    VkCommandBufferBeginInfo vk_begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = record_info.vk_usage_flags,
+        .pInheritanceInfo = record_info.vk_inheritance_info != nullptr ? record_info.vk_inheritance_info : &vk_default_inheritance_info,
+    };
+
+    uint32_t batch_count = (record_info.item_count + items_per_batch - 1) / items_per_batch;
+    ParallelRecordBatches batches = {
+        .vk_device = vk_device,
+        .recycler = &recycler,
+        .record_info = &record_info,
+        .vk_begin_info = &vk_begin_info,
+        .items_per_batch = items_per_batch,
+        .vk_secondaries = std::vector<VkCommandBuffer>(batch_count, VK_NULL_HANDLE),
+        .vk_results = std::vector<VkResult>(batch_count, VK_SUCCESS),
+    };
+
+    job::Counter counter;
+    job::parallel_for(jobs, batch_count, 1, record_batch, &batches, counter);
+    job::wait(jobs, counter);
+
+    for (uint32_t batch = 0; batch < batch_count; ++batch) {
+        if (batches.vk_results[batch] != VK_SUCCESS) {
+            KVK_ERR(batches.vk_results[batch], VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to record secondary command buffer for batch {} of {}", batch, batch_count);
+            return batches.vk_results[batch];
+        }
+    }
+
+    vkCmdExecuteCommands(record_info.vk_primary, batch_count, batches.vk_secondaries.data());
+    return VK_SUCCESS;
+}
+
+}
+
+}
@@ -0,0 +1,137 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <limits>
+
+namespace kvk {
+
+namespace deletion {
+
+void defer(DeletionQueue& queue, scheduler::WorkHandle after, DestroyFunction destroy, uint64_t handle, void* pdata) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.pending.push_back({
+        .after = after,
+        .destroy = destroy,
+        .handle = handle,
+        .pdata = pdata,
+    });
+}
+
+void defer_buffer(DeletionQueue& queue, scheduler::WorkHandle after, VkBuffer vk_buffer) {
+    defer(queue, after, [](VkDevice vk_device, uint64_t handle, void*) {
+        vkDestroyBuffer(vk_device, u64_to_handle<VkBuffer>(handle), nullptr);
+    }, handle_to_u64(vk_buffer), nullptr);
+}
+
+void defer_image(DeletionQueue& queue, scheduler::WorkHandle after, VkImage vk_image) {
+    defer(queue, after, [](VkDevice vk_device, uint64_t handle, void*) {
+        vkDestroyImage(vk_device, u64_to_handle<VkImage>(handle), nullptr);
+    }, handle_to_u64(vk_image), nullptr);
+}
+
+void defer_image_view(DeletionQueue& queue, scheduler::WorkHandle after, VkImageView vk_image_view) {
+    defer(queue, after, [](VkDevice vk_device, uint64_t handle, void*) {
+        vkDestroyImageView(vk_device, u64_to_handle<VkImageView>(handle), nullptr);
+    }, handle_to_u64(vk_image_view), nullptr);
+}
+
+void defer_pipeline(DeletionQueue& queue, scheduler::WorkHandle after, VkPipeline vk_pipeline) {
+    defer(queue, after, [](VkDevice vk_device, uint64_t handle, void*) {
+        vkDestroyPipeline(vk_device, u64_to_handle<VkPipeline>(handle), nullptr);
+    }, handle_to_u64(vk_pipeline), nullptr);
+}
+
+void defer_shader_module(DeletionQueue& queue, scheduler::WorkHandle after, VkShaderModule vk_shader_module) {
+    defer(queue, after, [](VkDevice vk_device, uint64_t handle, void*) {
+        vkDestroyShaderModule(vk_device, u64_to_handle<VkShaderModule>(handle), nullptr);
+    }, handle_to_u64(vk_shader_module), nullptr);
+}
+
+void defer_descriptor_pool(DeletionQueue& queue, scheduler::WorkHandle after, VkDescriptorPool vk_descriptor_pool) {
+    defer(queue, after, [](VkDevice vk_device, uint64_t handle, void*) {
+        vkDestroyDescriptorPool(vk_device, u64_to_handle<VkDescriptorPool>(handle), nullptr);
+    }, handle_to_u64(vk_descriptor_pool), nullptr);
+}
+
+void defer_resident(DeletionQueue& queue, scheduler::WorkHandle after, resource::MonoAllocationHeap& heap, resource::MonoAllocationResidentID id) {
+    if (id.is_image) {
+        defer(queue, after, [](VkDevice vk_device, uint64_t handle, void* pdata) {
+            resource::MonoAllocationResidentID id = {};
+            id.is_image = true;
+            id.vk_image = u64_to_handle<VkImage>(handle);
+            resource::mono_release_resident(vk_device, *reinterpret_cast<resource::MonoAllocationHeap*>(pdata), id);
+        }, handle_to_u64(id.vk_image), &heap);
+    } else {
+        defer(queue, after, [](VkDevice vk_device, uint64_t handle, void* pdata) {
+            resource::MonoAllocationResidentID id = {};
+            id.is_image = false;
+            id.vk_buffer = u64_to_handle<VkBuffer>(handle);
+            resource::mono_release_resident(vk_device, *reinterpret_cast<resource::MonoAllocationHeap*>(pdata), id);
+        }, handle_to_u64(id.vk_buffer), &heap);
+    }
+}
+
+uint32_t collect(VkDevice vk_device, scheduler::Scheduler const& scheduler, DeletionQueue& queue) {
+    /* one counter read per timeline rather than per deletion */
+    std::vector<uint64_t> completed(scheduler.queues.size(), 0);
+    for (uint32_t i = 0; i < scheduler.queues.size(); ++i) {
+        if (vkGetSemaphoreCounterValue(vk_device, scheduler.queues[i].vk_timeline, &completed[i]) != VK_SUCCESS) {
+            completed[i] = 0;
+        }
+    }
+
+    std::vector<Deletion> ready;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (size_t i = 0; i < queue.pending.size();) {
+            Deletion const& d = queue.pending[i];
+            if (completed[d.after.queue] < d.after.value) {
+                ++i;
+                continue;
+            }
+
+            ready.push_back(d);
+            queue.pending[i] = queue.pending.back();
+            queue.pending.pop_back();
+        }
+    }
+
+    /* destroyed outside the lock so destroy functions may defer more */
+    for (Deletion const& d : ready) {
+        d.destroy(vk_device, d.handle, d.pdata);
+    }
+
+    return static_cast<uint32_t>(ready.size());
+}
+
+VkResult drain(VkDevice vk_device, scheduler::Scheduler const& scheduler, DeletionQueue& queue) {
+    std::vector<uint64_t> latest(scheduler.queues.size(), 0);
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (Deletion const& d : queue.pending) {
+            latest[d.after.queue] = std::max(latest[d.after.queue], d.after.value);
+        }
+    }
+
+    for (uint32_t i = 0; i < latest.size(); ++i) {
+        if (latest[i] == 0) {
+            continue;
+        }
+
+        VkResult vk_result = scheduler::wait(vk_device, scheduler, { .queue = i, .value = latest[i] }, std::numeric_limits<uint64_t>::max());
+        if (vk_result != VK_SUCCESS) {
+            KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to wait on queue {} timeline value {} while draining deletions", i, latest[i]);
+            return vk_result;
+        }
+    }
+
+    collect(vk_device, scheduler, queue);
+    return VK_SUCCESS;
+}
+
+}
+
+}
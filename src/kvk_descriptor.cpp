@@ -0,0 +1,197 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <cmath>
+#include <algorithm>
+
+namespace kvk {
+
+namespace descriptor {
+
+VkResult create_descriptor_allocator(DescriptorAllocatorCreateInfo const& create_info, DescriptorAllocator& allocator) {
+    if (create_info.frames_in_flight == 0) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Descriptor allocator needs at least one frame in flight");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    allocator.frame_index = 0;
+    allocator.max_sets_per_pool = create_info.max_sets_per_pool == 0 ? 4096 : create_info.max_sets_per_pool;
+    allocator.sets_per_pool = std::min(create_info.initial_sets_per_pool == 0 ? 64 : create_info.initial_sets_per_pool, allocator.max_sets_per_pool);
+    allocator.vk_flags = create_info.vk_flags;
+    allocator.initial_sizes = create_info.initial_sizes;
+    allocator.layout_sizes.clear();
+    allocator.observed_descriptors.clear();
+    allocator.observed_sets = 0;
+    allocator.frames = std::vector<DescriptorAllocatorFrame>(create_info.frames_in_flight);
+    return VK_SUCCESS;
+}
+
+void destroy_descriptor_allocator(VkDevice vk_device, DescriptorAllocator& allocator) {
+    for (DescriptorAllocatorFrame& frame : allocator.frames) {
+        for (VkDescriptorPool vk_pool : frame.vk_ready_pools) {
+            vkDestroyDescriptorPool(vk_device, vk_pool, nullptr);
+        }
+
+        for (VkDescriptorPool vk_pool : frame.vk_full_pools) {
+            vkDestroyDescriptorPool(vk_device, vk_pool, nullptr);
+        }
+    }
+
+    allocator.frames.clear();
+    allocator.layout_sizes.clear();
+}
+
+void register_layout(DescriptorAllocator& allocator, VkDescriptorSetLayout vk_descriptor_set_layout, VkDescriptorSetLayoutCreateInfo const& vk_descriptor_set_layout_create_info) {
+    std::vector<VkDescriptorPoolSize> sizes;
+    for (uint32_t i = 0; i < vk_descriptor_set_layout_create_info.bindingCount; ++i) {
+        VkDescriptorSetLayoutBinding const& binding = vk_descriptor_set_layout_create_info.pBindings[i];
+        auto it = std::find_if(sizes.begin(), sizes.end(), [&binding](VkDescriptorPoolSize const& size) -> bool {
+            return size.type == binding.descriptorType;
+        });
+
+        if (it == sizes.end()) {
+            sizes.push_back({ .type = binding.descriptorType, .descriptorCount = binding.descriptorCount });
+        } else {
+            it->descriptorCount += binding.descriptorCount;
+        }
+    }
+
+    register_layout(allocator, vk_descriptor_set_layout, std::move(sizes));
+}
+
+void register_layout(DescriptorAllocator& allocator, VkDescriptorSetLayout vk_descriptor_set_layout, std::vector<VkDescriptorPoolSize> sizes) {
+    std::lock_guard<std::mutex> lock(allocator.mutex);
+    allocator.layout_sizes[vk_descriptor_set_layout] = std::move(sizes);
+}
+
+VkResult begin_frame(VkDevice vk_device, DescriptorAllocator& allocator, uint32_t frame_index) {
+    std::lock_guard<std::mutex> lock(allocator.mutex);
+    allocator.frame_index = frame_index % static_cast<uint32_t>(allocator.frames.size());
+
+    DescriptorAllocatorFrame& frame = allocator.frames[allocator.frame_index];
+    for (VkDescriptorPool vk_pool : frame.vk_ready_pools) {
+        vkResetDescriptorPool(vk_device, vk_pool, 0);
+    }
+
+    for (VkDescriptorPool vk_pool : frame.vk_full_pools) {
+        vkResetDescriptorPool(vk_device, vk_pool, 0);
+        frame.vk_ready_pools.push_back(vk_pool);
+    }
+
+    frame.vk_full_pools.clear();
+    return VK_SUCCESS;
+}
+
+/* sized from the average set seen so far, each new pool holding more sets than the last; the initial sizes stay a floor so sets from
+   unregistered layouts keep fitting */
+static VkResult create_pool(VkDevice vk_device, DescriptorAllocator& allocator, VkDescriptorPool& vk_pool) {
+    std::vector<VkDescriptorPoolSize> vk_pool_sizes;
+    for (VkDescriptorPoolSize const& size : allocator.initial_sizes) {
+        vk_pool_sizes.push_back({ .type = size.type, .descriptorCount = std::max(size.descriptorCount, 1u) * allocator.sets_per_pool });
+    }
+
+    if (allocator.observed_sets != 0) {
+        for (auto const& p : allocator.observed_descriptors) {
+            double per_set = static_cast<double>(p.second) / static_cast<double>(allocator.observed_sets);
+            uint32_t count = std::max(static_cast<uint32_t>(std::ceil(per_set * allocator.sets_per_pool)), 1u);
+
+            auto it = std::find_if(vk_pool_sizes.begin(), vk_pool_sizes.end(), [&p](VkDescriptorPoolSize const& size) -> bool {
+                return size.type == p.first;
+            });
+
+            if (it != vk_pool_sizes.end()) {
+                it->descriptorCount = std::max(it->descriptorCount, count);
+            } else {
+                vk_pool_sizes.push_back({ .type = p.first, .descriptorCount = count });
+            }
+        }
+    }
+
+    VkDescriptorPoolCreateInfo vk_descriptor_pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = allocator.vk_flags,
+        .maxSets = allocator.sets_per_pool,
+        .poolSizeCount = static_cast<uint32_t>(vk_pool_sizes.size()),
+        .pPoolSizes = vk_pool_sizes.empty() ? nullptr : vk_pool_sizes.data(),
+    };
+
+    VkResult vk_result = vkCreateDescriptorPool(vk_device, &vk_descriptor_pool_create_info, nullptr, &vk_pool);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create descriptor pool for {} sets", allocator.sets_per_pool);
+        return vk_result;
+    }
+
+    KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Created descriptor pool for {} sets with {} descriptor types", allocator.sets_per_pool, vk_pool_sizes.size());
+    allocator.sets_per_pool = std::min(allocator.sets_per_pool + allocator.sets_per_pool / 2, allocator.max_sets_per_pool);
+    return VK_SUCCESS;
+}
+
+static VkResult take_pool(VkDevice vk_device, DescriptorAllocator& allocator, VkDescriptorPool& vk_pool, bool& fresh) {
+    DescriptorAllocatorFrame& frame = allocator.frames[allocator.frame_index];
+    fresh = frame.vk_ready_pools.empty();
+    if (!fresh) {
+        vk_pool = frame.vk_ready_pools.back();
+        return VK_SUCCESS;
+    }
+
+    VkResult vk_result = create_pool(vk_device, allocator, vk_pool);
+    if (vk_result != VK_SUCCESS) {
+        return vk_result;
+    }
+
+    frame.vk_ready_pools.push_back(vk_pool);
+    return VK_SUCCESS;
+}
+
+VkResult allocate(VkDevice vk_device, DescriptorAllocator& allocator, VkDescriptorSetLayout vk_descriptor_set_layout, VkDescriptorSet& vk_descriptor_set, void const* vk_pnext) {
+    std::lock_guard<std::mutex> lock(allocator.mutex);
+
+    /* observed before picking a pool so a fresh one accounts for this layout's types */
+    auto it = allocator.layout_sizes.find(vk_descriptor_set_layout);
+    if (it != allocator.layout_sizes.end()) {
+        for (VkDescriptorPoolSize const& size : it->second) {
+            allocator.observed_descriptors[size.type] += size.descriptorCount;
+        }
+
+        ++allocator.observed_sets;
+    }
+
+    DescriptorAllocatorFrame& frame = allocator.frames[allocator.frame_index];
+    while (true) {
+        VkDescriptorPool vk_pool;
+        bool fresh;
+        VkResult vk_result = take_pool(vk_device, allocator, vk_pool, fresh);
+        if (vk_result != VK_SUCCESS) {
+            return vk_result;
+        }
+
+        VkDescriptorSetAllocateInfo vk_descriptor_set_allocate_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = vk_pnext,
+            .descriptorPool = vk_pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &vk_descriptor_set_layout,
+        };
+
+        vk_result = vkAllocateDescriptorSets(vk_device, &vk_descriptor_set_allocate_info, &vk_descriptor_set);
+        if (vk_result == VK_SUCCESS) {
+            return VK_SUCCESS;
+        }
+
+        if ((vk_result != VK_ERROR_OUT_OF_POOL_MEMORY && vk_result != VK_ERROR_FRAGMENTED_POOL) || fresh) {
+            KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to allocate descriptor set{}", fresh ? " from a fresh pool" : "");
+            return vk_result;
+        }
+
+        /* the pool is done for this frame; move on to the next, creating one if none are left */
+        frame.vk_ready_pools.pop_back();
+        frame.vk_full_pools.push_back(vk_pool);
+    }
+}
+
+}
+
+}
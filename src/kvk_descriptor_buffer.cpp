@@ -0,0 +1,269 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <algorithm>
+
+namespace kvk {
+
+namespace descriptor_buffer {
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+    return alignment <= 1 ? value : (value + alignment - 1) / alignment * alignment;
+}
+
+static VkResult load_functions(VkDevice vk_device, DescriptorBufferFunctions& functions) {
+    functions = {
+        .vk_get_descriptor_set_layout_size_ext = reinterpret_cast<PFN_vkGetDescriptorSetLayoutSizeEXT>(vkGetDeviceProcAddr(vk_device, "vkGetDescriptorSetLayoutSizeEXT")),
+        .vk_get_descriptor_set_layout_binding_offset_ext = reinterpret_cast<PFN_vkGetDescriptorSetLayoutBindingOffsetEXT>(vkGetDeviceProcAddr(vk_device, "vkGetDescriptorSetLayoutBindingOffsetEXT")),
+        .vk_get_descriptor_ext = reinterpret_cast<PFN_vkGetDescriptorEXT>(vkGetDeviceProcAddr(vk_device, "vkGetDescriptorEXT")),
+        .vk_cmd_bind_descriptor_buffers_ext = reinterpret_cast<PFN_vkCmdBindDescriptorBuffersEXT>(vkGetDeviceProcAddr(vk_device, "vkCmdBindDescriptorBuffersEXT")),
+        .vk_cmd_set_descriptor_buffer_offsets_ext = reinterpret_cast<PFN_vkCmdSetDescriptorBufferOffsetsEXT>(vkGetDeviceProcAddr(vk_device, "vkCmdSetDescriptorBufferOffsetsEXT")),
+    };
+
+    if (functions.vk_get_descriptor_set_layout_size_ext == nullptr || functions.vk_get_descriptor_set_layout_binding_offset_ext == nullptr || functions.vk_get_descriptor_ext == nullptr || functions.vk_cmd_bind_descriptor_buffers_ext == nullptr || functions.vk_cmd_set_descriptor_buffer_offsets_ext == nullptr) {
+        KVK_ERR(VK_ERROR_EXTENSION_NOT_PRESENT, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to load VK_EXT_descriptor_buffer functions; was the device created with DevicePresets::enable_descriptor_buffer?");
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    return VK_SUCCESS;
+}
+
+VkResult create_descriptor_buffer_heap(VkDevice vk_device, DescriptorBufferHeapCreateInfo const& create_info, DescriptorBufferHeap& heap) {
+    VkResult vk_result = load_functions(vk_device, heap.functions);
+    if (vk_result != VK_SUCCESS) {
+        return vk_result;
+    }
+
+    heap.vk_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT,
+    };
+
+    VkPhysicalDeviceProperties2 vk_physical_device_properties2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &heap.vk_properties,
+    };
+
+    vkGetPhysicalDeviceProperties2(create_info.vk_physical_device, &vk_physical_device_properties2);
+    heap.vk_properties.pNext = nullptr;
+
+    uint32_t frames_in_flight = create_info.frames_in_flight == 0 ? 1 : create_info.frames_in_flight;
+    VkDeviceSize vk_size_per_frame = align_up(create_info.vk_size_per_frame, heap.vk_properties.descriptorBufferOffsetAlignment);
+    heap.vk_buffer_usage = (create_info.samplers ? VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT : VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT) | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+    VkBufferCreateInfo vk_buffer_create_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = vk_size_per_frame * frames_in_flight,
+        .usage = heap.vk_buffer_usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    vk_result = vkCreateBuffer(vk_device, &vk_buffer_create_info, nullptr, &heap.vk_buffer);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create {} byte descriptor buffer", vk_buffer_create_info.size);
+        return vk_result;
+    }
+
+    resource::MonoAllocationResidentID resident = {};
+    resident.is_image = false;
+    resident.vk_buffer = heap.vk_buffer;
+
+    vk_result = resource::mono_alloc_for_residents(vk_device, {
+        .vk_physical_device = create_info.vk_physical_device,
+        .vk_memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        .residents = { resident },
+        .vk_memory_allocate_flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
+    }, heap.heap);
+
+    if (vk_result == VK_SUCCESS) {
+        vk_result = resource::mono_bind_residents(vk_device, heap.heap);
+    }
+
+    if (vk_result == VK_SUCCESS) {
+        vk_result = vkMapMemory(vk_device, heap.heap.vk_heap_memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&heap.mapped));
+    }
+
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to back descriptor buffer with mapped memory");
+        vkDestroyBuffer(vk_device, heap.vk_buffer, nullptr);
+        resource::mono_free_heap(vk_device, heap.heap);
+        return vk_result;
+    }
+
+    heap.vk_address = buffer_address(vk_device, heap.vk_buffer);
+    heap.frame_index = 0;
+    heap.regions.resize(frames_in_flight);
+    for (uint32_t i = 0; i < frames_in_flight; ++i) {
+        heap.regions[i] = {
+            .vk_begin = vk_size_per_frame * i,
+            .vk_end = vk_size_per_frame * (i + 1),
+            .vk_head = vk_size_per_frame * i,
+        };
+    }
+
+    return VK_SUCCESS;
+}
+
+void destroy_descriptor_buffer_heap(VkDevice vk_device, DescriptorBufferHeap& heap) {
+    if (heap.mapped != nullptr) {
+        vkUnmapMemory(vk_device, heap.heap.vk_heap_memory);
+        heap.mapped = nullptr;
+    }
+
+    vkDestroyBuffer(vk_device, heap.vk_buffer, nullptr);
+    heap.vk_buffer = VK_NULL_HANDLE;
+    resource::mono_free_heap(vk_device, heap.heap);
+    heap.regions.clear();
+}
+
+VkResult get_layout(VkDevice vk_device, DescriptorBufferHeap const& heap, VkDescriptorSetLayout vk_descriptor_set_layout, std::vector<uint32_t> const& bindings, DescriptorBufferLayout& layout) {
+    layout.vk_descriptor_set_layout = vk_descriptor_set_layout;
+    heap.functions.vk_get_descriptor_set_layout_size_ext(vk_device, vk_descriptor_set_layout, &layout.vk_size);
+    layout.vk_size = align_up(layout.vk_size, heap.vk_properties.descriptorBufferOffsetAlignment);
+
+    /* only binding numbers the layout has may be queried, and they needn't be contiguous */
+    uint32_t binding_end = 0;
+    for (uint32_t binding : bindings) {
+        binding_end = std::max(binding_end, binding + 1);
+    }
+
+    layout.vk_binding_offsets.assign(binding_end, VK_WHOLE_SIZE);
+    for (uint32_t binding : bindings) {
+        heap.functions.vk_get_descriptor_set_layout_binding_offset_ext(vk_device, vk_descriptor_set_layout, binding, &layout.vk_binding_offsets[binding]);
+    }
+
+    return VK_SUCCESS;
+}
+
+void begin_frame(DescriptorBufferHeap& heap, uint32_t frame_index) {
+    heap.frame_index = frame_index % static_cast<uint32_t>(heap.regions.size());
+    heap.regions[heap.frame_index].vk_head = heap.regions[heap.frame_index].vk_begin;
+}
+
+VkResult allocate(DescriptorBufferHeap& heap, DescriptorBufferLayout const& layout, DescriptorBufferSet& set) {
+    DescriptorBufferRegion& region = heap.regions[heap.frame_index];
+    VkDeviceSize vk_offset = align_up(region.vk_head, heap.vk_properties.descriptorBufferOffsetAlignment);
+    if (vk_offset + layout.vk_size > region.vk_end) {
+        KVK_ERR(VK_ERROR_OUT_OF_POOL_MEMORY, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Descriptor buffer region for frame {} is full ({} of {} bytes used)", heap.frame_index, region.vk_head - region.vk_begin, region.vk_end - region.vk_begin);
+        return VK_ERROR_OUT_OF_POOL_MEMORY;
+    }
+
+    region.vk_head = vk_offset + layout.vk_size;
+    set = {
+        .vk_offset = vk_offset,
+        .mapped = heap.mapped + vk_offset,
+    };
+
+    return VK_SUCCESS;
+}
+
+VkDeviceAddress buffer_address(VkDevice vk_device, VkBuffer vk_buffer) {
+    VkBufferDeviceAddressInfo vk_buffer_device_address_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+        .buffer = vk_buffer,
+    };
+
+    return vkGetBufferDeviceAddress(vk_device, &vk_buffer_device_address_info);
+}
+
+static size_t descriptor_size(VkPhysicalDeviceDescriptorBufferPropertiesEXT const& vk_properties, VkDescriptorType vk_descriptor_type) {
+    switch (vk_descriptor_type) {
+        case VK_DESCRIPTOR_TYPE_SAMPLER: return vk_properties.samplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: return vk_properties.combinedImageSamplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: return vk_properties.sampledImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: return vk_properties.storageImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER: return vk_properties.uniformTexelBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: return vk_properties.storageTexelBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: return vk_properties.uniformBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: return vk_properties.storageBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: return vk_properties.inputAttachmentDescriptorSize;
+        default: return 0;
+    }
+}
+
+/* vkGetDescriptorEXT writes straight into the mapped set */
+static void write_descriptor(VkDevice vk_device, DescriptorBufferHeap const& heap, DescriptorBufferLayout const& layout, DescriptorBufferSet const& set, uint32_t binding, uint32_t array_element, VkDescriptorGetInfoEXT const& vk_descriptor_get_info) {
+    size_t size = descriptor_size(heap.vk_properties, vk_descriptor_get_info.type);
+    if (size == 0 || binding >= layout.vk_binding_offsets.size() || layout.vk_binding_offsets[binding] == VK_WHOLE_SIZE) {
+        KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Can't write descriptor type {} at binding {} into a descriptor buffer", static_cast<int32_t>(vk_descriptor_get_info.type), binding);
+        return;
+    }
+
+    heap.functions.vk_get_descriptor_ext(vk_device, &vk_descriptor_get_info, size, set.mapped + layout.vk_binding_offsets[binding] + size * array_element);
+}
+
+void write_buffer(VkDevice vk_device, DescriptorBufferHeap const& heap, DescriptorBufferLayout const& layout, DescriptorBufferSet const& set, uint32_t binding, uint32_t array_element, VkDescriptorType vk_descriptor_type, VkDeviceAddress vk_address, VkDeviceSize vk_range) {
+    VkDescriptorAddressInfoEXT vk_descriptor_address_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
+        .address = vk_address,
+        .range = vk_range,
+        .format = VK_FORMAT_UNDEFINED,
+    };
+
+    VkDescriptorGetInfoEXT vk_descriptor_get_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+        .type = vk_descriptor_type,
+    };
+
+    switch (vk_descriptor_type) {
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: vk_descriptor_get_info.data.pUniformBuffer = &vk_descriptor_address_info; break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: vk_descriptor_get_info.data.pStorageBuffer = &vk_descriptor_address_info; break;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER: vk_descriptor_get_info.data.pUniformTexelBuffer = &vk_descriptor_address_info; break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: vk_descriptor_get_info.data.pStorageTexelBuffer = &vk_descriptor_address_info; break;
+        default:
+            KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Descriptor type {} is not a buffer descriptor", static_cast<int32_t>(vk_descriptor_type));
+            return;
+    }
+
+    write_descriptor(vk_device, heap, layout, set, binding, array_element, vk_descriptor_get_info);
+}
+
+void write_image(VkDevice vk_device, DescriptorBufferHeap const& heap, DescriptorBufferLayout const& layout, DescriptorBufferSet const& set, uint32_t binding, uint32_t array_element, VkDescriptorType vk_descriptor_type, VkDescriptorImageInfo const& vk_descriptor_image_info) {
+    VkDescriptorGetInfoEXT vk_descriptor_get_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+        .type = vk_descriptor_type,
+    };
+
+    switch (vk_descriptor_type) {
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: vk_descriptor_get_info.data.pSampledImage = &vk_descriptor_image_info; break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: vk_descriptor_get_info.data.pStorageImage = &vk_descriptor_image_info; break;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: vk_descriptor_get_info.data.pCombinedImageSampler = &vk_descriptor_image_info; break;
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: vk_descriptor_get_info.data.pInputAttachmentImage = &vk_descriptor_image_info; break;
+        default:
+            KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Descriptor type {} is not an image descriptor", static_cast<int32_t>(vk_descriptor_type));
+            return;
+    }
+
+    write_descriptor(vk_device, heap, layout, set, binding, array_element, vk_descriptor_get_info);
+}
+
+void write_sampler(VkDevice vk_device, DescriptorBufferHeap const& heap, DescriptorBufferLayout const& layout, DescriptorBufferSet const& set, uint32_t binding, uint32_t array_element, VkSampler vk_sampler) {
+    VkDescriptorGetInfoEXT vk_descriptor_get_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+        .type = VK_DESCRIPTOR_TYPE_SAMPLER,
+    };
+
+    vk_descriptor_get_info.data.pSampler = &vk_sampler;
+    write_descriptor(vk_device, heap, layout, set, binding, array_element, vk_descriptor_get_info);
+}
+
+void cmd_bind(VkCommandBuffer vk_command_buffer, DescriptorBufferHeap const& heap) {
+    VkDescriptorBufferBindingInfoEXT vk_descriptor_buffer_binding_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
+        .address = heap.vk_address,
+        .usage = heap.vk_buffer_usage,
+    };
+
+    heap.functions.vk_cmd_bind_descriptor_buffers_ext(vk_command_buffer, 1, &vk_descriptor_buffer_binding_info);
+}
+
+void cmd_set_set(VkCommandBuffer vk_command_buffer, DescriptorBufferHeap const& heap, VkPipelineBindPoint vk_pipeline_bind_point, VkPipelineLayout vk_pipeline_layout, uint32_t set_index, DescriptorBufferSet const& set) {
+    uint32_t buffer_index = 0;
+    heap.functions.vk_cmd_set_descriptor_buffer_offsets_ext(vk_command_buffer, vk_pipeline_bind_point, vk_pipeline_layout, set_index, 1, &buffer_index, &set.vk_offset);
+}
+
+}
+
+}
@@ -0,0 +1,614 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <limits>
+#include <algorithm>
+
+namespace kvk {
+
+namespace graph {
+
+static constexpr VkAccessFlags2 WRITE_ACCESS =
+    VK_ACCESS_2_SHADER_WRITE_BIT |
+    VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+    VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_TRANSFER_WRITE_BIT |
+    VK_ACCESS_2_HOST_WRITE_BIT |
+    VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+/* hazards still pending on a resource at some point of the compiled pass order */
+struct TrackedState {
+    VkImageLayout vk_layout;
+
+    /* last write (a layout transition counts as one without access); every later access must wait for it */
+    VkPipelineStageFlags2 vk_write_stages;
+    VkAccessFlags2 vk_write_access;
+
+    /* reads since then, which the next write must wait for */
+    VkPipelineStageFlags2 vk_read_stages;
+
+    /* what the last write has already been made visible to */
+    VkPipelineStageFlags2 vk_visible_stages;
+    VkAccessFlags2 vk_visible_access;
+
+    bool used;
+};
+
+static TrackedState initial_tracked_state(GraphResource const& resource) {
+    if (!resource.imported) {
+        return {
+            .vk_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+    }
+
+    ResourceState const& state = resource.initial_state;
+    if ((state.vk_access & WRITE_ACCESS) != 0) {
+        return {
+            .vk_layout = state.vk_layout,
+            .vk_write_stages = state.vk_stages,
+            .vk_write_access = state.vk_access & WRITE_ACCESS,
+        };
+    }
+
+    return {
+        .vk_layout = state.vk_layout,
+        .vk_read_stages = state.vk_stages,
+    };
+}
+
+static ResourceID add_resource(Graph& graph, GraphResource resource) {
+    graph.resources.push_back(std::move(resource));
+    return static_cast<ResourceID>(graph.resources.size() - 1);
+}
+
+ResourceID import_buffer(Graph& graph, VkBuffer vk_buffer, ResourceState const& initial_state, std::optional<ResourceState> final_state) {
+    return add_resource(graph, {
+        .is_image = false,
+        .imported = true,
+        .vk_buffer = vk_buffer,
+        .initial_state = initial_state,
+        .final_state = final_state,
+    });
+}
+
+ResourceID import_image(Graph& graph, VkImage vk_image, VkImageSubresourceRange const& vk_subresource_range, ResourceState const& initial_state, std::optional<ResourceState> final_state) {
+    return add_resource(graph, {
+        .is_image = true,
+        .imported = true,
+        .vk_image = vk_image,
+        .vk_subresource_range = vk_subresource_range,
+        .initial_state = initial_state,
+        .final_state = final_state,
+    });
+}
+
+ResourceID create_transient_buffer(Graph& graph, VkBufferCreateInfo const& vk_buffer_create_info) {
+    return add_resource(graph, {
+        .is_image = false,
+        .imported = false,
+        .vk_buffer_create_info = vk_buffer_create_info,
+    });
+}
+
+ResourceID create_transient_image(Graph& graph, VkImageCreateInfo const& vk_image_create_info) {
+    VkImageAspectFlags vk_aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    if ((vk_image_create_info.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0) {
+        vk_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    }
+
+    return add_resource(graph, {
+        .is_image = true,
+        .imported = false,
+        .vk_subresource_range = {
+            .aspectMask = vk_aspect,
+            .baseMipLevel = 0,
+            .levelCount = vk_image_create_info.mipLevels,
+            .baseArrayLayer = 0,
+            .layerCount = vk_image_create_info.arrayLayers,
+        },
+        .vk_image_create_info = vk_image_create_info,
+    });
+}
+
+void set_buffer(Graph& graph, ResourceID resource, VkBuffer vk_buffer) {
+    graph.resources[resource].vk_buffer = vk_buffer;
+}
+
+void set_image(Graph& graph, ResourceID resource, VkImage vk_image) {
+    graph.resources[resource].vk_image = vk_image;
+}
+
+void add_pass(Graph& graph, PassInfo pass) {
+    graph.passes.push_back(std::move(pass));
+}
+
+/* walks backwards from imported outputs and side effects; everything else contributes nothing */
+static std::vector<uint32_t> cull_passes(Graph const& graph) {
+    std::vector<bool> needed(graph.resources.size(), false);
+    std::vector<uint32_t> live;
+
+    for (uint32_t p = static_cast<uint32_t>(graph.passes.size()); p > 0; --p) {
+        PassInfo const& pass = graph.passes[p - 1];
+        bool keep = pass.side_effects;
+        for (ResourceUse const& use : pass.writes) {
+            keep = keep || graph.resources[use.resource].imported || needed[use.resource];
+        }
+
+        if (!keep) {
+            KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Culling graph pass \"{}\"; nothing reads what it writes", pass.name != nullptr ? pass.name : "");
+            continue;
+        }
+
+        for (ResourceUse const& use : pass.reads) {
+            needed[use.resource] = true;
+        }
+
+        for (ResourceUse const& use : pass.writes) {
+            if ((use.vk_access & ~WRITE_ACCESS) != 0) {
+                needed[use.resource] = true;
+            }
+        }
+
+        live.push_back(p - 1);
+    }
+
+    std::reverse(live.begin(), live.end());
+    return live;
+}
+
+struct TransientPlacement {
+    ResourceID resource;
+    VkMemoryRequirements vk_memory_requirements;
+    uint32_t first;
+    uint32_t last;
+    VkDeviceSize offset;
+};
+
+static bool ranges_overlap(VkDeviceSize a_begin, VkDeviceSize a_size, VkDeviceSize b_begin, VkDeviceSize b_size) {
+    return a_begin < b_begin + b_size && b_begin < a_begin + a_size;
+}
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static VkResult create_transients(VkDevice vk_device, VkPhysicalDevice vk_physical_device, Graph& graph, std::vector<uint32_t> const& live) {
+    std::vector<TransientPlacement> placements;
+    for (ResourceID r = 0; r < graph.resources.size(); ++r) {
+        GraphResource& resource = graph.resources[r];
+        if (resource.imported) {
+            continue;
+        }
+
+        resource.aliased_predecessors.clear();
+
+        uint32_t first = std::numeric_limits<uint32_t>::max();
+        uint32_t last = 0;
+        for (uint32_t i = 0; i < live.size(); ++i) {
+            PassInfo const& pass = graph.passes[live[i]];
+            auto touches = [r](ResourceUse const& use) -> bool {
+                return use.resource == r;
+            };
+
+            if (std::any_of(pass.reads.begin(), pass.reads.end(), touches) || std::any_of(pass.writes.begin(), pass.writes.end(), touches)) {
+                first = std::min(first, i);
+                last = std::max(last, i);
+            }
+        }
+
+        if (first == std::numeric_limits<uint32_t>::max()) {
+            continue;
+        }
+
+        VkMemoryRequirements vk_memory_requirements;
+        VkResult vk_result;
+        if (resource.is_image) {
+            vk_result = vkCreateImage(vk_device, &resource.vk_image_create_info, nullptr, &resource.vk_image);
+            if (vk_result != VK_SUCCESS) {
+                KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create transient graph image {}", r);
+                return vk_result;
+            }
+
+            vkGetImageMemoryRequirements(vk_device, resource.vk_image, &vk_memory_requirements);
+        } else {
+            vk_result = vkCreateBuffer(vk_device, &resource.vk_buffer_create_info, nullptr, &resource.vk_buffer);
+            if (vk_result != VK_SUCCESS) {
+                KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create transient graph buffer {}", r);
+                return vk_result;
+            }
+
+            vkGetBufferMemoryRequirements(vk_device, resource.vk_buffer, &vk_memory_requirements);
+        }
+
+        placements.push_back({
+            .resource = r,
+            .vk_memory_requirements = vk_memory_requirements,
+            .first = first,
+            .last = last,
+        });
+    }
+
+    if (placements.empty()) {
+        return VK_SUCCESS;
+    }
+
+    VkPhysicalDeviceProperties vk_physical_device_properties;
+    vkGetPhysicalDeviceProperties(vk_physical_device, &vk_physical_device_properties);
+
+    /* buffers and optimally tiled images may share memory, so keep everything apart by at least the granularity */
+    VkDeviceSize vk_granularity = vk_physical_device_properties.limits.bufferImageGranularity;
+
+    std::sort(placements.begin(), placements.end(), [](TransientPlacement const& a, TransientPlacement const& b) -> bool {
+        return a.vk_memory_requirements.size > b.vk_memory_requirements.size;
+    });
+
+    /* largest first, each at the lowest offset not in use by anything alive at the same time */
+    VkDeviceSize heap_size = 0;
+    for (size_t i = 0; i < placements.size(); ++i) {
+        TransientPlacement& t = placements[i];
+        VkDeviceSize alignment = std::max(t.vk_memory_requirements.alignment, vk_granularity);
+
+        std::vector<VkDeviceSize> candidates = { 0 };
+        for (size_t j = 0; j < i; ++j) {
+            candidates.push_back(align_up(placements[j].offset + placements[j].vk_memory_requirements.size, alignment));
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+        for (VkDeviceSize candidate : candidates) {
+            bool fits = true;
+            for (size_t j = 0; j < i; ++j) {
+                TransientPlacement const& p = placements[j];
+                bool alive_together = t.first <= p.last && p.first <= t.last;
+                if (alive_together && ranges_overlap(candidate, t.vk_memory_requirements.size, p.offset, p.vk_memory_requirements.size)) {
+                    fits = false;
+                    break;
+                }
+            }
+
+            if (fits) {
+                t.offset = candidate;
+                break;
+            }
+        }
+
+        heap_size = std::max(heap_size, t.offset + t.vk_memory_requirements.size);
+    }
+
+    std::vector<VkMemoryRequirements> vk_memory_requirementses;
+    VkDeviceSize unaliased_size = 0;
+    for (TransientPlacement const& t : placements) {
+        vk_memory_requirementses.push_back(t.vk_memory_requirements);
+        unaliased_size += t.vk_memory_requirements.size;
+
+        /* whoever used the memory last has to finish before the next user overwrites it */
+        for (TransientPlacement const& p : placements) {
+            if (p.resource != t.resource && p.last < t.first && ranges_overlap(t.offset, t.vk_memory_requirements.size, p.offset, p.vk_memory_requirements.size)) {
+                graph.resources[t.resource].aliased_predecessors.push_back(p.resource);
+            }
+        }
+    }
+
+    uint32_t memory_type_index = resource::find_memory_type_index(vk_physical_device, vk_memory_requirementses, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (memory_type_index == VK_MAX_MEMORY_TYPES) {
+        KVK_ERR(VK_ERROR_MEMORY_MAP_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to find a memory type every graph transient can live in");
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+
+    VkMemoryAllocateInfo vk_memory_allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = heap_size,
+        .memoryTypeIndex = memory_type_index,
+    };
+
+    VkResult vk_result = vkAllocateMemory(vk_device, &vk_memory_allocate_info, nullptr, &graph.transient_heap.vk_heap_memory);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to allocate {} bytes for graph transients", heap_size);
+        return vk_result;
+    }
+
+    graph.transient_heap.vk_heap_size = heap_size;
+    graph.transient_heap.memory_type_index = memory_type_index;
+    graph.transient_heap.residents = {};
+    for (TransientPlacement const& t : placements) {
+        GraphResource const& resource = graph.resources[t.resource];
+        resource::MonoAllocationResidentID id = {};
+        id.is_image = resource.is_image;
+        if (resource.is_image) {
+            id.vk_image = resource.vk_image;
+        } else {
+            id.vk_buffer = resource.vk_buffer;
+        }
+
+        graph.transient_heap.residents[id] = {
+            .id = id,
+            .vk_heap_offset = t.offset,
+            .vk_alignment = t.vk_memory_requirements.alignment,
+            .vk_size = t.vk_memory_requirements.size,
+        };
+    }
+
+    graph.statistics.transient_bytes = heap_size;
+    graph.statistics.transient_bytes_unaliased = unaliased_size;
+    return resource::mono_bind_residents(vk_device, graph.transient_heap);
+}
+
+static bool barriers_empty(CompiledBarriers const& barriers) {
+    return barriers.vk_memory_barrier.srcStageMask == 0 && barriers.vk_memory_barrier.dstStageMask == 0 && barriers.image_barriers.empty();
+}
+
+/* adds whatever the use needs to barriers and advances the tracked state past it */
+static void synchronize_use(Graph& graph, std::vector<TrackedState>& tracked, ResourceUse const& use, CompiledBarriers& barriers) {
+    GraphResource const& resource = graph.resources[use.resource];
+    TrackedState& state = tracked[use.resource];
+
+    VkPipelineStageFlags2 vk_src_stages = 0;
+    VkAccessFlags2 vk_src_access = 0;
+    if (!state.used) {
+        for (ResourceID predecessor : resource.aliased_predecessors) {
+            vk_src_stages |= tracked[predecessor].vk_write_stages | tracked[predecessor].vk_read_stages;
+            vk_src_access |= tracked[predecessor].vk_write_access;
+        }
+    }
+
+    bool writes = (use.vk_access & WRITE_ACCESS) != 0;
+    bool layout_change = resource.is_image && use.vk_layout != state.vk_layout;
+    bool hazard = vk_src_stages != 0;
+    if (layout_change || writes) {
+        /* WAW and layout transitions need prior writes available, WAR only needs the reads done */
+        vk_src_stages |= state.vk_write_stages | state.vk_read_stages;
+        vk_src_access |= state.vk_write_access;
+        hazard = hazard || layout_change || vk_src_stages != 0;
+    } else if (state.vk_write_stages != 0 && ((use.vk_stages & ~state.vk_visible_stages) != 0 || (use.vk_access & ~state.vk_visible_access) != 0)) {
+        vk_src_stages |= state.vk_write_stages;
+        vk_src_access |= state.vk_write_access;
+        hazard = true;
+    } else if (state.vk_write_access != 0) {
+        /* the write is already visible to this read; a naive per-use barrier would have waited on it again */
+        ++graph.statistics.dropped_transitions;
+    }
+
+    if (hazard) {
+        if (layout_change) {
+            barriers.image_barriers.push_back({
+                .resource = use.resource,
+                .vk_src_stages = vk_src_stages,
+                .vk_src_access = vk_src_access,
+                .vk_dst_stages = use.vk_stages,
+                .vk_dst_access = use.vk_access,
+                .vk_old_layout = state.used || resource.imported ? state.vk_layout : VK_IMAGE_LAYOUT_UNDEFINED,
+                .vk_new_layout = use.vk_layout,
+            });
+        } else {
+            barriers.vk_memory_barrier.srcStageMask |= vk_src_stages;
+            barriers.vk_memory_barrier.srcAccessMask |= vk_src_access;
+            barriers.vk_memory_barrier.dstStageMask |= use.vk_stages;
+            barriers.vk_memory_barrier.dstAccessMask |= use.vk_access;
+        }
+    }
+
+    if (writes) {
+        state.vk_write_stages = use.vk_stages;
+        state.vk_write_access = use.vk_access & WRITE_ACCESS;
+        state.vk_read_stages = 0;
+        state.vk_visible_stages = 0;
+        state.vk_visible_access = 0;
+    } else if (layout_change) {
+        state.vk_write_stages = use.vk_stages;
+        state.vk_write_access = 0;
+        state.vk_read_stages = use.vk_stages;
+        state.vk_visible_stages = use.vk_stages;
+        state.vk_visible_access = use.vk_access;
+    } else {
+        if (hazard) {
+            state.vk_visible_stages |= use.vk_stages;
+            state.vk_visible_access |= use.vk_access;
+        }
+
+        state.vk_read_stages |= use.vk_stages;
+    }
+
+    state.vk_layout = resource.is_image ? use.vk_layout : state.vk_layout;
+    state.used = true;
+}
+
+/* appends a compiled pass with its barriers for each live pass, advancing tracked past them */
+static void compile_passes(Graph& graph, std::vector<uint32_t> const& live, std::vector<TrackedState>& tracked) {
+    for (uint32_t p : live) {
+        CompiledPass compiled = {
+            .pass = p,
+            .barriers = {
+                .vk_memory_barrier = {
+                    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                },
+            },
+        };
+
+        for (ResourceUse const& use : graph.passes[p].reads) {
+            synchronize_use(graph, tracked, use, compiled.barriers);
+        }
+
+        for (ResourceUse const& use : graph.passes[p].writes) {
+            synchronize_use(graph, tracked, use, compiled.barriers);
+        }
+
+        if (!barriers_empty(compiled.barriers)) {
+            ++graph.statistics.pipeline_barriers;
+            graph.statistics.image_barriers += static_cast<uint32_t>(compiled.barriers.image_barriers.size());
+        }
+
+        graph.compiled.push_back(std::move(compiled));
+    }
+}
+
+static bool aliases(GraphResource const& resource, ResourceID other) {
+    return std::find(resource.aliased_predecessors.begin(), resource.aliased_predecessors.end(), other) != resource.aliased_predecessors.end();
+}
+
+/* what the previous execute() left pending on a transient's memory: its own last uses and those of every transient sharing that memory */
+static TrackedState wrapped_transient_state(Graph const& graph, std::vector<TrackedState> const& end_tracked, ResourceID r) {
+    TrackedState state = {
+        .vk_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    for (ResourceID other = 0; other < graph.resources.size(); ++other) {
+        GraphResource const& resource = graph.resources[other];
+        if (resource.imported || !end_tracked[other].used) {
+            continue;
+        }
+
+        if (other == r || aliases(graph.resources[r], other) || aliases(resource, r)) {
+            state.vk_write_stages |= end_tracked[other].vk_write_stages;
+            state.vk_write_access |= end_tracked[other].vk_write_access;
+            state.vk_read_stages |= end_tracked[other].vk_read_stages;
+        }
+    }
+
+    return state;
+}
+
+VkResult compile(VkDevice vk_device, VkPhysicalDevice vk_physical_device, Graph& graph) {
+    graph.vk_cmd_pipeline_barrier2_khr = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(vk_device, "vkCmdPipelineBarrier2KHR"));
+    if (graph.vk_cmd_pipeline_barrier2_khr == nullptr) {
+        KVK_ERR(VK_ERROR_EXTENSION_NOT_PRESENT, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to load vkCmdPipelineBarrier2KHR; was the device created with DevicePresets::enable_synchronization2?");
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    /* a recompile places every transient anew, so whatever the last compile() created goes first */
+    destroy_graph(vk_device, graph);
+
+    graph.statistics = {};
+
+    std::vector<uint32_t> live = cull_passes(graph);
+    graph.statistics.culled_passes = static_cast<uint32_t>(graph.passes.size() - live.size());
+
+    VkResult vk_result = create_transients(vk_device, vk_physical_device, graph, live);
+    if (vk_result != VK_SUCCESS) {
+        destroy_graph(vk_device, graph);
+        return vk_result;
+    }
+
+    std::vector<TrackedState> tracked(graph.resources.size());
+    for (ResourceID r = 0; r < graph.resources.size(); ++r) {
+        tracked[r] = initial_tracked_state(graph.resources[r]);
+    }
+
+    /* the next execute() reuses the transients' memory right after this one, so compile the graph as a loop: a first run finds what
+       each transient is left with at the end, and the real run starts from that instead of from nothing */
+    GraphStatistics statistics = graph.statistics;
+    compile_passes(graph, live, tracked);
+    graph.compiled.clear();
+    graph.statistics = statistics;
+
+    std::vector<TrackedState> end_tracked = std::move(tracked);
+    tracked.assign(graph.resources.size(), {});
+    for (ResourceID r = 0; r < graph.resources.size(); ++r) {
+        GraphResource const& resource = graph.resources[r];
+        tracked[r] = resource.imported ? initial_tracked_state(resource) : wrapped_transient_state(graph, end_tracked, r);
+    }
+
+    compile_passes(graph, live, tracked);
+
+    /* hand imported resources over in the state the caller expects them in */
+    graph.final_barriers.vk_memory_barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+    };
+
+    for (ResourceID r = 0; r < graph.resources.size(); ++r) {
+        GraphResource const& resource = graph.resources[r];
+        if (!resource.imported || !resource.final_state.has_value() || !tracked[r].used) {
+            continue;
+        }
+
+        synchronize_use(graph, tracked, {
+            .resource = r,
+            .vk_stages = resource.final_state->vk_stages,
+            .vk_access = resource.final_state->vk_access,
+            .vk_layout = resource.final_state->vk_layout,
+        }, graph.final_barriers);
+    }
+
+    if (!barriers_empty(graph.final_barriers)) {
+        ++graph.statistics.pipeline_barriers;
+        graph.statistics.image_barriers += static_cast<uint32_t>(graph.final_barriers.image_barriers.size());
+    }
+
+    KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Compiled graph: {} passes ({} culled), {} pipeline barriers with {} image barriers, {} redundant barriers dropped, {} transient bytes ({} without aliasing)", live.size(), graph.statistics.culled_passes, graph.statistics.pipeline_barriers, graph.statistics.image_barriers, graph.statistics.dropped_transitions, graph.statistics.transient_bytes, graph.statistics.transient_bytes_unaliased);
+    return VK_SUCCESS;
+}
+
+static void record_barriers(Graph const& graph, VkCommandBuffer vk_command_buffer, CompiledBarriers const& barriers) {
+    if (barriers_empty(barriers)) {
+        return;
+    }
+
+    std::vector<VkImageMemoryBarrier2> vk_image_barriers;
+    vk_image_barriers.reserve(barriers.image_barriers.size());
+    for (CompiledImageBarrier const& b : barriers.image_barriers) {
+        GraphResource const& resource = graph.resources[b.resource];
+        vk_image_barriers.push_back({
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = b.vk_src_stages,
+            .srcAccessMask = b.vk_src_access,
+            .dstStageMask = b.vk_dst_stages,
+            .dstAccessMask = b.vk_dst_access,
+            .oldLayout = b.vk_old_layout,
+            .newLayout = b.vk_new_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = resource.vk_image,
+            .subresourceRange = resource.vk_subresource_range,
+        });
+    }
+
+    bool has_memory_barrier = barriers.vk_memory_barrier.srcStageMask != 0 || barriers.vk_memory_barrier.dstStageMask != 0;
+    VkDependencyInfoKHR vk_dependency_info = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = has_memory_barrier ? 1u : 0u,
+        .pMemoryBarriers = has_memory_barrier ? &barriers.vk_memory_barrier : nullptr,
+        .imageMemoryBarrierCount = static_cast<uint32_t>(vk_image_barriers.size()),
+        .pImageMemoryBarriers = vk_image_barriers.empty() ? nullptr : vk_image_barriers.data(),
+    };
+
+    graph.vk_cmd_pipeline_barrier2_khr(vk_command_buffer, &vk_dependency_info);
+}
+
+void execute(Graph const& graph, VkCommandBuffer vk_command_buffer) {
+    for (CompiledPass const& compiled : graph.compiled) {
+        record_barriers(graph, vk_command_buffer, compiled.barriers);
+
+        PassInfo const& pass = graph.passes[compiled.pass];
+        if (pass.record != nullptr) {
+            pass.record(vk_command_buffer, pass.pdata);
+        }
+    }
+
+    record_barriers(graph, vk_command_buffer, graph.final_barriers);
+}
+
+void destroy_graph(VkDevice vk_device, Graph& graph) {
+    for (GraphResource& resource : graph.resources) {
+        if (resource.imported) {
+            continue;
+        }
+
+        if (resource.is_image && resource.vk_image != VK_NULL_HANDLE) {
+            vkDestroyImage(vk_device, resource.vk_image, nullptr);
+            resource.vk_image = VK_NULL_HANDLE;
+        } else if (!resource.is_image && resource.vk_buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(vk_device, resource.vk_buffer, nullptr);
+            resource.vk_buffer = VK_NULL_HANDLE;
+        }
+    }
+
+    resource::mono_free_heap(vk_device, graph.transient_heap);
+    graph.compiled.clear();
+    graph.final_barriers = {};
+}
+
+}
+
+}
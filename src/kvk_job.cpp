@@ -0,0 +1,176 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <algorithm>
+
+namespace kvk {
+
+namespace job {
+
+/* the job system a worker thread was spawned by and its index in it; any other thread is worker 0 of every system */
+static thread_local JobSystem const* t_job_system = nullptr;
+static thread_local uint32_t t_worker_index = 0;
+
+static uint32_t calling_worker_index(JobSystem const& jobs) {
+    return t_job_system == &jobs ? t_worker_index : 0;
+}
+
+static bool pop_or_steal(JobSystem& jobs, uint32_t worker_index, Job& job) {
+    {
+        WorkerQueue& own = *jobs.queues[worker_index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            jobs.queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    uint32_t count = static_cast<uint32_t>(jobs.queues.size());
+    for (uint32_t i = 1; i < count; ++i) {
+        WorkerQueue& victim = *jobs.queues[(worker_index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            jobs.queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void wake_workers(JobSystem& jobs) {
+    /* taking the lock orders the queued increment (or counter decrement) before any sleeper re-checks it */
+    {
+        std::lock_guard<std::mutex> lock(jobs.sleep_mutex);
+    }
+
+    jobs.wake.notify_all();
+}
+
+static void run(JobSystem& jobs, Job const& job, uint32_t worker_index) {
+    job.function(job.begin, job.end, worker_index, job.pdata);
+    if (job.counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        /* someone may be blocked in wait() on this counter */
+        wake_workers(jobs);
+    }
+}
+
+static void worker_main(JobSystem& jobs, uint32_t worker_index) {
+    t_job_system = &jobs;
+    t_worker_index = worker_index;
+
+    Job job;
+    while (jobs.running.load(std::memory_order_acquire)) {
+        if (pop_or_steal(jobs, worker_index, job)) {
+            run(jobs, job, worker_index);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(jobs.sleep_mutex);
+        jobs.wake.wait(lock, [&jobs]() {
+            return jobs.queued.load(std::memory_order_relaxed) > 0 || !jobs.running.load(std::memory_order_relaxed);
+        });
+    }
+}
+
+static void push(JobSystem& jobs, Job const& job) {
+    WorkerQueue& own = *jobs.queues[calling_worker_index(jobs)];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    own.jobs.push_back(job);
+    jobs.queued.fetch_add(1, std::memory_order_relaxed);
+}
+
+void create_job_system(JobSystemCreateInfo const& create_info, JobSystem& jobs) {
+    uint32_t thread_count = create_info.worker_thread_count;
+    if (thread_count == 0) {
+        thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    jobs.running.store(true, std::memory_order_release);
+    jobs.queued.store(0, std::memory_order_relaxed);
+    jobs.queues.clear();
+    for (uint32_t i = 0; i < thread_count + 1; ++i) {
+        jobs.queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    jobs.threads.clear();
+    jobs.threads.reserve(thread_count);
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        jobs.threads.emplace_back(worker_main, std::ref(jobs), i + 1);
+    }
+
+    KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Created job system with {} worker threads", thread_count);
+}
+
+void destroy_job_system(JobSystem& jobs) {
+    jobs.running.store(false, std::memory_order_release);
+    wake_workers(jobs);
+
+    for (std::thread& thread : jobs.threads) {
+        thread.join();
+    }
+
+    jobs.threads.clear();
+    jobs.queues.clear();
+}
+
+uint32_t worker_count(JobSystem const& jobs) {
+    return static_cast<uint32_t>(jobs.queues.size());
+}
+
+void submit(JobSystem& jobs, Job const& job) {
+    job.counter->pending.fetch_add(1, std::memory_order_relaxed);
+    push(jobs, job);
+    wake_workers(jobs);
+}
+
+void parallel_for(JobSystem& jobs, uint32_t count, uint32_t batch_size, JobFunction function, void* pdata, Counter& counter) {
+    batch_size = std::max(batch_size, 1u);
+    uint32_t batch_count = (count + batch_size - 1) / batch_size;
+    counter.pending.fetch_add(batch_count, std::memory_order_relaxed);
+
+    /* pushed back to front so the owner pops batch 0 first while thieves take the tail */
+    for (uint32_t b = batch_count; b > 0; --b) {
+        uint32_t begin = (b - 1) * batch_size;
+        push(jobs, {
+            .function = function,
+            .pdata = pdata,
+            .begin = begin,
+            .end = std::min(begin + batch_size, count),
+            .counter = &counter,
+        });
+    }
+
+    if (batch_count > 0) {
+        wake_workers(jobs);
+    }
+}
+
+void wait(JobSystem& jobs, Counter& counter) {
+    uint32_t worker_index = calling_worker_index(jobs);
+
+    Job job;
+    while (counter.pending.load(std::memory_order_acquire) != 0) {
+        if (pop_or_steal(jobs, worker_index, job)) {
+            run(jobs, job, worker_index);
+            continue;
+        }
+
+        /* the remaining jobs are running elsewhere; sleep until one finishes the counter or queues more work to help with */
+        std::unique_lock<std::mutex> lock(jobs.sleep_mutex);
+        jobs.wake.wait(lock, [&jobs, &counter]() {
+            return jobs.queued.load(std::memory_order_relaxed) > 0 || counter.pending.load(std::memory_order_acquire) == 0;
+        });
+    }
+}
+
+}
+
+}
@@ -0,0 +1,264 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <algorithm>
+
+namespace kvk {
+
+namespace layout {
+
+/* not published yet; the caller swaps it in once filled */
+static LayoutCacheTable* create_table(LayoutCacheMap& map, uint32_t capacity) {
+    std::unique_ptr<LayoutCacheTable> table = std::make_unique<LayoutCacheTable>();
+    table->capacity = 1;
+    while (table->capacity < capacity) {
+        table->capacity <<= 1;
+    }
+
+    table->entries = std::make_unique<LayoutCacheEntry[]>(table->capacity);
+    table->count = 0;
+
+    map.tables.push_back(std::move(table));
+    return map.tables.back().get();
+}
+
+VkResult create_layout_cache(LayoutCacheCreateInfo const& create_info, LayoutCache& cache) {
+    uint32_t capacity = create_info.capacity == 0 ? 1024 : create_info.capacity;
+    for (LayoutCacheMap* map : { &cache.descriptor_set_layouts, &cache.pipeline_layouts }) {
+        map->tables.clear();
+        map->current.store(create_table(*map, capacity), std::memory_order_release);
+    }
+
+    cache.hits = 0;
+    cache.misses = 0;
+    return VK_SUCCESS;
+}
+
+void destroy_layout_cache(VkDevice vk_device, LayoutCache& cache) {
+    std::lock_guard<std::mutex> lock(cache.write_mutex);
+
+    /* the current tables hold every entry; pipeline layouts go first, they reference the set layouts */
+    LayoutCacheTable const* pipeline_layouts = cache.pipeline_layouts.current.load(std::memory_order_acquire);
+    LayoutCacheTable const* descriptor_set_layouts = cache.descriptor_set_layouts.current.load(std::memory_order_acquire);
+    if (pipeline_layouts == nullptr || descriptor_set_layouts == nullptr) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < pipeline_layouts->capacity; ++i) {
+        if (pipeline_layouts->entries[i].hash.load(std::memory_order_acquire) != 0) {
+            vkDestroyPipelineLayout(vk_device, u64_to_handle<VkPipelineLayout>(pipeline_layouts->entries[i].handle), nullptr);
+        }
+    }
+
+    for (uint32_t i = 0; i < descriptor_set_layouts->capacity; ++i) {
+        if (descriptor_set_layouts->entries[i].hash.load(std::memory_order_acquire) != 0) {
+            vkDestroyDescriptorSetLayout(vk_device, u64_to_handle<VkDescriptorSetLayout>(descriptor_set_layouts->entries[i].handle), nullptr);
+        }
+    }
+
+    KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Layout cache held {} set layouts and {} pipeline layouts ({} hits, {} misses)", descriptor_set_layouts->count, pipeline_layouts->count, cache.hits.load(), cache.misses.load());
+    for (LayoutCacheMap* map : { &cache.descriptor_set_layouts, &cache.pipeline_layouts }) {
+        map->current.store(nullptr, std::memory_order_release);
+        map->tables.clear();
+    }
+}
+
+/* 0 marks an empty slot */
+static uint64_t hash_key(std::vector<uint64_t> const& key) {
+    uint64_t hash = hash_bytes(key.data(), key.size() * sizeof(uint64_t));
+    return hash == 0 ? 1 : hash;
+}
+
+static bool find(LayoutCacheMap const& map, uint64_t hash, std::vector<uint64_t> const& key, uint64_t& handle) {
+    LayoutCacheTable const& table = *map.current.load(std::memory_order_acquire);
+    uint32_t mask = table.capacity - 1;
+    for (uint32_t probe = 0; probe < table.capacity; ++probe) {
+        LayoutCacheEntry const& entry = table.entries[(hash + probe) & mask];
+        uint64_t entry_hash = entry.hash.load(std::memory_order_acquire);
+        if (entry_hash == 0) {
+            return false;
+        }
+
+        if (entry_hash == hash && entry.key == key) {
+            handle = entry.handle;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* the table is kept under 3/4 full, so there always is a free slot */
+static void place(LayoutCacheTable& table, uint64_t hash, std::vector<uint64_t>&& key, uint64_t handle) {
+    uint32_t mask = table.capacity - 1;
+    for (uint32_t probe = 0; probe < table.capacity; ++probe) {
+        LayoutCacheEntry& entry = table.entries[(hash + probe) & mask];
+        if (entry.hash.load(std::memory_order_relaxed) != 0) {
+            continue;
+        }
+
+        entry.key = std::move(key);
+        entry.handle = handle;
+        entry.hash.store(hash, std::memory_order_release);
+        ++table.count;
+        return;
+    }
+}
+
+/* caller holds write_mutex and has checked the key isn't present */
+static void insert(LayoutCacheMap& map, uint64_t hash, std::vector<uint64_t>&& key, uint64_t handle) {
+    LayoutCacheTable* table = map.current.load(std::memory_order_relaxed);
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        LayoutCacheTable* grown = create_table(map, table->capacity * 2);
+        for (uint32_t i = 0; i < table->capacity; ++i) {
+            LayoutCacheEntry const& entry = table->entries[i];
+            uint64_t entry_hash = entry.hash.load(std::memory_order_relaxed);
+            if (entry_hash != 0) {
+                place(*grown, entry_hash, std::vector<uint64_t>(entry.key), entry.handle);
+            }
+        }
+
+        KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Layout cache table grew to {} entries", grown->capacity);
+        map.current.store(grown, std::memory_order_release);
+        table = grown;
+    }
+
+    place(*table, hash, std::move(key), handle);
+}
+
+/* bindings sorted by number so declaration order doesn't matter */
+static VkResult descriptor_set_layout_key(VkDescriptorSetLayoutCreateInfo const& vk_descriptor_set_layout_create_info, std::vector<uint64_t>& key) {
+    VkDescriptorBindingFlags const* vk_binding_flags = nullptr;
+    for (VkBaseInStructure const* next = reinterpret_cast<VkBaseInStructure const*>(vk_descriptor_set_layout_create_info.pNext); next != nullptr; next = next->pNext) {
+        if (next->sType != VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO) {
+            KVK_ERR(VK_ERROR_FEATURE_NOT_PRESENT, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Layout cache can't key descriptor set layouts chaining structure type {}", static_cast<int32_t>(next->sType));
+            return VK_ERROR_FEATURE_NOT_PRESENT;
+        }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo const* flags_create_info = reinterpret_cast<VkDescriptorSetLayoutBindingFlagsCreateInfo const*>(next);
+        vk_binding_flags = flags_create_info->bindingCount == 0 ? nullptr : flags_create_info->pBindingFlags;
+    }
+
+    std::vector<uint32_t> order(vk_descriptor_set_layout_create_info.bindingCount);
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&vk_descriptor_set_layout_create_info](uint32_t a, uint32_t b) -> bool {
+        return vk_descriptor_set_layout_create_info.pBindings[a].binding < vk_descriptor_set_layout_create_info.pBindings[b].binding;
+    });
+
+    key.clear();
+    key.push_back(vk_descriptor_set_layout_create_info.flags);
+    for (uint32_t i : order) {
+        VkDescriptorSetLayoutBinding const& binding = vk_descriptor_set_layout_create_info.pBindings[i];
+        key.push_back((static_cast<uint64_t>(binding.binding) << 32) | static_cast<uint32_t>(binding.descriptorType));
+        key.push_back((static_cast<uint64_t>(binding.descriptorCount) << 32) | binding.stageFlags);
+        key.push_back(vk_binding_flags == nullptr ? 0 : vk_binding_flags[i]);
+        if (binding.pImmutableSamplers != nullptr) {
+            for (uint32_t s = 0; s < binding.descriptorCount; ++s) {
+                key.push_back(handle_to_u64(binding.pImmutableSamplers[s]));
+            }
+        }
+    }
+
+    return VK_SUCCESS;
+}
+
+static void pipeline_layout_key(VkPipelineLayoutCreateInfo const& vk_pipeline_layout_create_info, std::vector<uint64_t>& key) {
+    key.clear();
+    key.push_back(vk_pipeline_layout_create_info.flags);
+    key.push_back(vk_pipeline_layout_create_info.setLayoutCount);
+    for (uint32_t i = 0; i < vk_pipeline_layout_create_info.setLayoutCount; ++i) {
+        key.push_back(handle_to_u64(vk_pipeline_layout_create_info.pSetLayouts[i]));
+    }
+
+    std::vector<VkPushConstantRange> ranges(vk_pipeline_layout_create_info.pPushConstantRanges, vk_pipeline_layout_create_info.pPushConstantRanges + vk_pipeline_layout_create_info.pushConstantRangeCount);
+    std::sort(ranges.begin(), ranges.end(), [](VkPushConstantRange const& a, VkPushConstantRange const& b) -> bool {
+        return a.offset != b.offset ? a.offset < b.offset : a.stageFlags < b.stageFlags;
+    });
+
+    for (VkPushConstantRange const& range : ranges) {
+        key.push_back((static_cast<uint64_t>(range.offset) << 32) | range.size);
+        key.push_back(range.stageFlags);
+    }
+}
+
+VkResult get_descriptor_set_layout(VkDevice vk_device, LayoutCache& cache, VkDescriptorSetLayoutCreateInfo const& vk_descriptor_set_layout_create_info, VkDescriptorSetLayout& vk_descriptor_set_layout) {
+    std::vector<uint64_t> key;
+    VkResult vk_result = descriptor_set_layout_key(vk_descriptor_set_layout_create_info, key);
+    if (vk_result != VK_SUCCESS) {
+        return vk_result;
+    }
+
+    uint64_t hash = hash_key(key);
+    uint64_t handle;
+    if (find(cache.descriptor_set_layouts, hash, key, handle)) {
+        cache.hits.fetch_add(1, std::memory_order_relaxed);
+        vk_descriptor_set_layout = u64_to_handle<VkDescriptorSetLayout>(handle);
+        return VK_SUCCESS;
+    }
+
+    std::lock_guard<std::mutex> lock(cache.write_mutex);
+
+    /* someone may have inserted it between the lookup and taking the lock */
+    if (find(cache.descriptor_set_layouts, hash, key, handle)) {
+        cache.hits.fetch_add(1, std::memory_order_relaxed);
+        vk_descriptor_set_layout = u64_to_handle<VkDescriptorSetLayout>(handle);
+        return VK_SUCCESS;
+    }
+
+    vk_result = vkCreateDescriptorSetLayout(vk_device, &vk_descriptor_set_layout_create_info, nullptr, &vk_descriptor_set_layout);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create descriptor set layout for the layout cache");
+        return vk_result;
+    }
+
+    insert(cache.descriptor_set_layouts, hash, std::move(key), handle_to_u64(vk_descriptor_set_layout));
+
+    cache.misses.fetch_add(1, std::memory_order_relaxed);
+    return VK_SUCCESS;
+}
+
+VkResult get_pipeline_layout(VkDevice vk_device, LayoutCache& cache, VkPipelineLayoutCreateInfo const& vk_pipeline_layout_create_info, VkPipelineLayout& vk_pipeline_layout) {
+    if (vk_pipeline_layout_create_info.pNext != nullptr) {
+        KVK_ERR(VK_ERROR_FEATURE_NOT_PRESENT, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Layout cache can't key pipeline layouts with a pNext chain");
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+
+    std::vector<uint64_t> key;
+    pipeline_layout_key(vk_pipeline_layout_create_info, key);
+
+    uint64_t hash = hash_key(key);
+    uint64_t handle;
+    if (find(cache.pipeline_layouts, hash, key, handle)) {
+        cache.hits.fetch_add(1, std::memory_order_relaxed);
+        vk_pipeline_layout = u64_to_handle<VkPipelineLayout>(handle);
+        return VK_SUCCESS;
+    }
+
+    std::lock_guard<std::mutex> lock(cache.write_mutex);
+    if (find(cache.pipeline_layouts, hash, key, handle)) {
+        cache.hits.fetch_add(1, std::memory_order_relaxed);
+        vk_pipeline_layout = u64_to_handle<VkPipelineLayout>(handle);
+        return VK_SUCCESS;
+    }
+
+    VkResult vk_result = vkCreatePipelineLayout(vk_device, &vk_pipeline_layout_create_info, nullptr, &vk_pipeline_layout);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create pipeline layout for the layout cache");
+        return vk_result;
+    }
+
+    insert(cache.pipeline_layouts, hash, std::move(key), handle_to_u64(vk_pipeline_layout));
+
+    cache.misses.fetch_add(1, std::memory_order_relaxed);
+    return VK_SUCCESS;
+}
+
+}
+
+}
@@ -0,0 +1,291 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <cstring>
+
+namespace kvk {
+
+namespace pipeline {
+
+/* prepended to the driver blob; drivers are not required to survive truncated or corrupted data, so it is checked before they see it */
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t data_size;
+    uint64_t data_hash;
+};
+
+static constexpr uint32_t FILE_MAGIC = 0x504b564b; /* "KVKP" */
+static constexpr uint32_t FILE_VERSION = 1;
+
+static bool read_file(PipelineCache const& cache, std::vector<uint8_t>& data) {
+    std::ifstream in(cache.path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(in.tellg());
+    FileHeader header = {};
+    if (size < sizeof(header)) {
+        KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Ignoring truncated pipeline cache \"{}\"", cache.path);
+        return false;
+    }
+
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.data_size != size - sizeof(header)) {
+        KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Ignoring pipeline cache \"{}\" with a bad or truncated header", cache.path);
+        return false;
+    }
+
+    data.resize(header.data_size);
+    in.read(reinterpret_cast<char*>(data.data()), data.size());
+    if (!in || hash_bytes(data.data(), data.size()) != header.data_hash) {
+        KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Ignoring corrupt pipeline cache \"{}\"", cache.path);
+        return false;
+    }
+
+    /* the driver's own header says which driver build and device produced the blob */
+    VkPipelineCacheHeaderVersionOne vk_header = {};
+    if (data.size() < sizeof(vk_header)) {
+        return false;
+    }
+
+    std::memcpy(&vk_header, data.data(), sizeof(vk_header));
+    if (vk_header.headerSize < sizeof(vk_header) || vk_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+        KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Ignoring pipeline cache \"{}\" with unknown header version {}", cache.path, static_cast<uint32_t>(vk_header.headerVersion));
+        return false;
+    }
+
+    if (vk_header.vendorID != cache.vendor_id || vk_header.deviceID != cache.device_id || std::memcmp(vk_header.pipelineCacheUUID, cache.pipeline_cache_uuid, VK_UUID_SIZE) != 0) {
+        KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT, "Ignoring pipeline cache \"{}\" from another device or driver ({:04x}:{:04x})", cache.path, vk_header.vendorID, vk_header.deviceID);
+        return false;
+    }
+
+    return true;
+}
+
+VkResult create_pipeline_cache(VkDevice vk_device, PipelineCacheCreateInfo const& create_info, PipelineCache& cache) {
+    VkPhysicalDeviceProperties vk_physical_device_properties;
+    vkGetPhysicalDeviceProperties(create_info.vk_physical_device, &vk_physical_device_properties);
+
+    cache.path = create_info.path;
+    cache.vendor_id = vk_physical_device_properties.vendorID;
+    cache.device_id = vk_physical_device_properties.deviceID;
+    std::memcpy(cache.pipeline_cache_uuid, vk_physical_device_properties.pipelineCacheUUID, VK_UUID_SIZE);
+    cache.save_interval = create_info.save_interval;
+    cache.last_save = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> data;
+    cache.loaded = !cache.path.empty() && read_file(cache, data);
+    if (!cache.loaded) {
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo vk_pipeline_cache_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.empty() ? nullptr : data.data(),
+    };
+
+    VkResult vk_result = vkCreatePipelineCache(vk_device, &vk_pipeline_cache_create_info, nullptr, &cache.vk_pipeline_cache);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create pipeline cache");
+        return vk_result;
+    }
+
+    uint32_t thread_count = create_info.thread_count == 0 ? 1 : create_info.thread_count;
+    cache.vk_thread_pipeline_caches.assign(thread_count, VK_NULL_HANDLE);
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        vk_result = vkCreatePipelineCache(vk_device, &vk_pipeline_cache_create_info, nullptr, &cache.vk_thread_pipeline_caches[i]);
+        if (vk_result != VK_SUCCESS) {
+            KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create pipeline cache for worker {}", i);
+            destroy_pipeline_cache(vk_device, cache);
+            return vk_result;
+        }
+    }
+
+    return VK_SUCCESS;
+}
+
+void destroy_pipeline_cache(VkDevice vk_device, PipelineCache& cache) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for (VkPipelineCache vk_thread_pipeline_cache : cache.vk_thread_pipeline_caches) {
+        vkDestroyPipelineCache(vk_device, vk_thread_pipeline_cache, nullptr);
+    }
+
+    cache.vk_thread_pipeline_caches.clear();
+    vkDestroyPipelineCache(vk_device, cache.vk_pipeline_cache, nullptr);
+    cache.vk_pipeline_cache = VK_NULL_HANDLE;
+}
+
+VkPipelineCache thread_cache(PipelineCache const& cache, uint32_t worker_index) {
+    return cache.vk_thread_pipeline_caches[worker_index % cache.vk_thread_pipeline_caches.size()];
+}
+
+VkResult save(VkDevice vk_device, PipelineCache& cache) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.last_save = std::chrono::steady_clock::now();
+
+    /* only the destination is externally synchronized, workers may keep using their caches */
+    VkResult vk_result = vkMergePipelineCaches(vk_device, cache.vk_pipeline_cache, static_cast<uint32_t>(cache.vk_thread_pipeline_caches.size()), cache.vk_thread_pipeline_caches.data());
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to merge {} worker pipeline caches", cache.vk_thread_pipeline_caches.size());
+        return vk_result;
+    }
+
+    if (cache.path.empty()) {
+        return VK_SUCCESS;
+    }
+
+    size_t size = 0;
+    vk_result = vkGetPipelineCacheData(vk_device, cache.vk_pipeline_cache, &size, nullptr);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to get pipeline cache size");
+        return vk_result;
+    }
+
+    std::vector<uint8_t> data(size);
+    vk_result = vkGetPipelineCacheData(vk_device, cache.vk_pipeline_cache, &size, data.data());
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to get pipeline cache data");
+        return vk_result;
+    }
+
+    data.resize(size);
+
+    FileHeader header = {
+        .magic = FILE_MAGIC,
+        .version = FILE_VERSION,
+        .data_size = data.size(),
+        .data_hash = hash_bytes(data.data(), data.size()),
+    };
+
+    /* a crash mid-write leaves the previous file intact */
+    std::filesystem::path path = cache.path;
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp";
+
+    {
+        std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        out.write(reinterpret_cast<char const*>(data.data()), data.size());
+        if (!out) {
+            KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to write pipeline cache \"{}\"", temporary_path.string());
+            out.close();
+            std::error_code error;
+            std::filesystem::remove(temporary_path, error);
+            return VK_ERROR_UNKNOWN;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to replace pipeline cache \"{}\": {}", cache.path, error.message());
+        std::filesystem::remove(temporary_path, error);
+        return VK_ERROR_UNKNOWN;
+    }
+
+    return VK_SUCCESS;
+}
+
+VkResult save_if_due(VkDevice vk_device, PipelineCache& cache) {
+    if (cache.save_interval.count() == 0 || std::chrono::steady_clock::now() - cache.last_save < cache.save_interval) {
+        return VK_SUCCESS;
+    }
+
+    return save(vk_device, cache);
+}
+
+static void build_job(uint32_t begin, uint32_t end, uint32_t worker_index, void* pdata) {
+    PipelineBatch& batch = *reinterpret_cast<PipelineBatch*>(pdata);
+    VkPipelineCache vk_pipeline_cache = thread_cache(*batch.cache, worker_index);
+    uint32_t compute_count = static_cast<uint32_t>(batch.vk_compute_create_infos.size());
+
+    for (uint32_t i = begin; i < end; ++i) {
+        VkPipeline vk_pipeline = VK_NULL_HANDLE;
+        VkResult vk_result;
+        if (i < compute_count) {
+            vk_result = vkCreateComputePipelines(batch.vk_device, vk_pipeline_cache, 1, &batch.vk_compute_create_infos[i], nullptr, &vk_pipeline);
+        } else {
+            vk_result = vkCreateGraphicsPipelines(batch.vk_device, vk_pipeline_cache, 1, &batch.vk_graphics_create_infos[i - compute_count], nullptr, &vk_pipeline);
+        }
+
+        if (vk_result != VK_SUCCESS) {
+            KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to build {} pipeline {} of batch", i < compute_count ? "compute" : "graphics", i);
+            vk_pipeline = VK_NULL_HANDLE;
+        }
+
+        PipelineSlot& slot = batch.slots[i];
+        slot.vk_pipeline.store(handle_to_u64(vk_pipeline), std::memory_order_relaxed);
+        slot.vk_result.store(vk_result, std::memory_order_relaxed);
+        slot.ready.store(true, std::memory_order_release);
+    }
+}
+
+void build(VkDevice vk_device, job::JobSystem& jobs, PipelineCache& cache, PipelineBatchCreateInfo const& create_info, PipelineBatch& batch) {
+    batch.vk_device = vk_device;
+    batch.cache = &cache;
+    batch.vk_compute_create_infos = create_info.vk_compute_create_infos;
+    batch.vk_graphics_create_infos = create_info.vk_graphics_create_infos;
+    batch.count = static_cast<uint32_t>(batch.vk_compute_create_infos.size() + batch.vk_graphics_create_infos.size());
+    batch.slots = std::make_unique<PipelineSlot[]>(batch.count);
+
+    for (uint32_t i = 0; i < batch.count; ++i) {
+        batch.slots[i].ready.store(false, std::memory_order_relaxed);
+        batch.slots[i].vk_result.store(VK_NOT_READY, std::memory_order_relaxed);
+        batch.slots[i].vk_pipeline.store(0, std::memory_order_relaxed);
+        batch.slots[i].vk_placeholder = i < create_info.vk_placeholders.size() ? create_info.vk_placeholders[i] : VK_NULL_HANDLE;
+    }
+
+    /* one pipeline per job; backend compiles vary wildly in cost, so finer jobs balance better across stealing workers */
+    job::parallel_for(jobs, batch.count, 1, build_job, &batch, batch.counter);
+}
+
+bool ready(PipelineBatch const& batch, uint32_t index) {
+    return batch.slots[index].ready.load(std::memory_order_acquire);
+}
+
+VkPipeline get(PipelineBatch const& batch, uint32_t index) {
+    PipelineSlot const& slot = batch.slots[index];
+    if (!slot.ready.load(std::memory_order_acquire) || slot.vk_result.load(std::memory_order_relaxed) != VK_SUCCESS) {
+        return slot.vk_placeholder;
+    }
+
+    return u64_to_handle<VkPipeline>(slot.vk_pipeline.load(std::memory_order_relaxed));
+}
+
+VkResult wait(job::JobSystem& jobs, PipelineBatch& batch) {
+    job::wait(jobs, batch.counter);
+    for (uint32_t i = 0; i < batch.count; ++i) {
+        VkResult vk_result = static_cast<VkResult>(batch.slots[i].vk_result.load(std::memory_order_acquire));
+        if (vk_result != VK_SUCCESS) {
+            return vk_result;
+        }
+    }
+
+    return VK_SUCCESS;
+}
+
+void destroy_batch(job::JobSystem& jobs, PipelineBatch& batch) {
+    job::wait(jobs, batch.counter);
+    for (uint32_t i = 0; i < batch.count; ++i) {
+        vkDestroyPipeline(batch.vk_device, u64_to_handle<VkPipeline>(batch.slots[i].vk_pipeline.load(std::memory_order_acquire)), nullptr);
+    }
+
+    batch.slots.reset();
+    batch.count = 0;
+    batch.vk_compute_create_infos.clear();
+    batch.vk_graphics_create_infos.clear();
+}
+
+}
+
+}
@@ -0,0 +1,311 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+
+namespace kvk {
+
+namespace present {
+
+static uint64_t nanoseconds_since(std::chrono::steady_clock::time_point epoch) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+static LatencyPercentiles compute_percentiles(std::vector<uint64_t>& values) {
+    if (values.empty()) {
+        return {};
+    }
+
+    std::sort(values.begin(), values.end());
+    auto at = [&values](uint32_t percent) -> uint64_t {
+        size_t index = (values.size() - 1) * percent / 100;
+        return values[index];
+    };
+
+    return {
+        .p50_ns = at(50),
+        .p90_ns = at(90),
+        .p99_ns = at(99),
+        .max_ns = values.back(),
+    };
+}
+
+static uint64_t end_to_end_ns(FrameTiming const& timing) {
+    if (timing.displayed_ns != 0) {
+        return timing.displayed_ns - timing.acquire_ns;
+    }
+
+    return timing.present_ns - timing.acquire_ns;
+}
+
+static void record_sample(LatencyTelemetry& telemetry, FrameTiming const& timing) {
+    if (telemetry.samples.empty()) {
+        return;
+    }
+
+    telemetry.samples[telemetry.sample_head] = timing;
+    telemetry.sample_head = (telemetry.sample_head + 1) % static_cast<uint32_t>(telemetry.samples.size());
+    telemetry.sample_count = std::min(telemetry.sample_count + 1, static_cast<uint32_t>(telemetry.samples.size()));
+
+    if (timing.preference < telemetry.preferences.size()) {
+        std::deque<uint64_t>& history = telemetry.preferences[timing.preference].end_to_end_ns;
+        history.push_back(end_to_end_ns(timing));
+        if (history.size() > telemetry.samples.size()) {
+            history.pop_front();
+        }
+    }
+}
+
+static bool has_device_extension(VkPhysicalDevice vk_physical_device, char const* name) {
+    uint32_t extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(vk_physical_device, nullptr, &extension_count, nullptr);
+    std::vector<VkExtensionProperties> extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(vk_physical_device, nullptr, &extension_count, extensions.data());
+
+    return std::find_if(extensions.begin(), extensions.end(), [name](VkExtensionProperties const& p) -> bool { return std::strcmp(p.extensionName, name) == 0; }) != extensions.end();
+}
+
+bool present_id_supported(VkPhysicalDevice vk_physical_device) {
+    return has_device_extension(vk_physical_device, VK_KHR_PRESENT_ID_EXTENSION_NAME);
+}
+
+bool present_wait_supported(VkPhysicalDevice vk_physical_device) {
+    return present_id_supported(vk_physical_device) && has_device_extension(vk_physical_device, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+}
+
+VkResult create_latency_telemetry(VkDevice vk_device, LatencyTelemetryCreateInfo const& create_info, LatencyTelemetry& telemetry) {
+    if (create_info.sample_capacity == 0) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Latency telemetry requires a non-zero sample capacity");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    /* present wait waits on present ids */
+    if (create_info.use_present_wait && !create_info.use_present_id) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Latency telemetry can only use present wait together with present ids");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    PFN_vkWaitForPresentKHR vk_wait_for_present_khr = nullptr;
+    if (create_info.use_present_wait) {
+        vk_wait_for_present_khr = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(vk_device, "vkWaitForPresentKHR"));
+        if (vk_wait_for_present_khr == nullptr) {
+            KVK_ERR(VK_ERROR_EXTENSION_NOT_PRESENT, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to load vkWaitForPresentKHR; was the device created with DevicePresets::enable_present_wait?");
+            return VK_ERROR_EXTENSION_NOT_PRESENT;
+        }
+    }
+
+    telemetry.vk_device = vk_device;
+    telemetry.vk_swapchain = create_info.vk_swapchain;
+    telemetry.vk_wait_for_present_khr = vk_wait_for_present_khr;
+    telemetry.preference = create_info.preference;
+    telemetry.use_present_id = create_info.use_present_id;
+    telemetry.next_present_id = 1;
+    telemetry.epoch = std::chrono::steady_clock::now();
+    telemetry.recording = {};
+    telemetry.awaiting_display.clear();
+    telemetry.samples.assign(create_info.sample_capacity, {});
+    telemetry.sample_head = 0;
+    telemetry.sample_count = 0;
+    telemetry.preferences.assign(create_info.preference_count, {});
+
+    return VK_SUCCESS;
+}
+
+void rebind_swapchain(LatencyTelemetry& telemetry, VkSwapchainKHR vk_swapchain, std::optional<uint32_t> requested, uint32_t chosen_preference) {
+    if (requested.has_value() && requested.value() != chosen_preference && requested.value() < telemetry.preferences.size()) {
+        KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Swapchain preference {} was requested but not supported; excluding it from latency exploration", requested.value());
+        telemetry.preferences[requested.value()].unsupported = true;
+    }
+
+    /* present ids are per swapchain, so anything in flight on the old one can no longer be waited on */
+    telemetry.vk_swapchain = vk_swapchain;
+    telemetry.preference = chosen_preference;
+    telemetry.next_present_id = 1;
+    telemetry.recording = {};
+    telemetry.awaiting_display.clear();
+}
+
+void mark_acquired(LatencyTelemetry& telemetry) {
+    telemetry.recording = {
+        .preference = telemetry.preference,
+        .acquire_ns = nanoseconds_since(telemetry.epoch),
+    };
+}
+
+void mark_submitted(LatencyTelemetry& telemetry) {
+    telemetry.recording.submit_ns = nanoseconds_since(telemetry.epoch);
+}
+
+VkResult queue_present(LatencyTelemetry& telemetry, VkQueue vk_queue, VkPresentInfoKHR const& vk_present_info) {
+    uint32_t swapchain_index = std::numeric_limits<uint32_t>::max();
+    for (uint32_t i = 0; i < vk_present_info.swapchainCount; ++i) {
+        if (vk_present_info.pSwapchains[i] == telemetry.vk_swapchain) {
+            swapchain_index = i;
+            break;
+        }
+    }
+
+    if (swapchain_index == std::numeric_limits<uint32_t>::max()) {
+        return vkQueuePresentKHR(vk_queue, &vk_present_info);
+    }
+
+    std::vector<uint64_t> present_ids(vk_present_info.swapchainCount, 0);
+    present_ids[swapchain_index] = telemetry.next_present_id;
+
+    VkPresentIdKHR vk_present_id_khr = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+        .pNext = vk_present_info.pNext,
+        .swapchainCount = vk_present_info.swapchainCount,
+        .pPresentIds = present_ids.data(),
+    };
+
+    VkPresentInfoKHR vk_tagged_present_info = vk_present_info;
+    if (telemetry.use_present_id) {
+        vk_tagged_present_info.pNext = &vk_present_id_khr;
+    }
+
+    VkResult vk_result = vkQueuePresentKHR(vk_queue, &vk_tagged_present_info);
+    if (vk_result != VK_SUCCESS && vk_result != VK_SUBOPTIMAL_KHR) {
+        return vk_result;
+    }
+
+    FrameTiming timing = telemetry.recording;
+    timing.present_id = telemetry.next_present_id++;
+    timing.present_ns = nanoseconds_since(telemetry.epoch);
+    if (timing.submit_ns == 0) {
+        timing.submit_ns = timing.present_ns;
+    }
+
+    if (telemetry.vk_wait_for_present_khr != nullptr) {
+        telemetry.awaiting_display.push_back(timing);
+    } else {
+        record_sample(telemetry, timing);
+    }
+
+    return vk_result;
+}
+
+VkResult poll_displayed(LatencyTelemetry& telemetry, uint64_t timeout_ns) {
+    if (telemetry.vk_wait_for_present_khr == nullptr) {
+        return VK_SUCCESS;
+    }
+
+    while (!telemetry.awaiting_display.empty()) {
+        FrameTiming& timing = telemetry.awaiting_display.front();
+        VkResult vk_result = telemetry.vk_wait_for_present_khr(telemetry.vk_device, telemetry.vk_swapchain, timing.present_id, timeout_ns);
+        if (vk_result == VK_TIMEOUT) {
+            return VK_SUCCESS;
+        }
+
+        if (vk_result != VK_SUCCESS && vk_result != VK_SUBOPTIMAL_KHR) {
+            KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "vkWaitForPresentKHR failed for present id {}; dropping {} pending latency samples", timing.present_id, telemetry.awaiting_display.size());
+            telemetry.awaiting_display.clear();
+            return vk_result;
+        }
+
+        timing.displayed_ns = nanoseconds_since(telemetry.epoch);
+        record_sample(telemetry, timing);
+        telemetry.awaiting_display.pop_front();
+
+        /* only the oldest present is allowed to block */
+        timeout_ns = 0;
+    }
+
+    return VK_SUCCESS;
+}
+
+void get_latency_report(LatencyTelemetry const& telemetry, LatencyReport& report) {
+    std::vector<uint64_t> acquire_to_submit, submit_to_present, present_to_displayed, end_to_end;
+    acquire_to_submit.reserve(telemetry.sample_count);
+    submit_to_present.reserve(telemetry.sample_count);
+    present_to_displayed.reserve(telemetry.sample_count);
+    end_to_end.reserve(telemetry.sample_count);
+
+    for (uint32_t i = 0; i < telemetry.sample_count; ++i) {
+        FrameTiming const& timing = telemetry.samples[i];
+        acquire_to_submit.push_back(timing.submit_ns - timing.acquire_ns);
+        submit_to_present.push_back(timing.present_ns - timing.submit_ns);
+        if (timing.displayed_ns != 0) {
+            present_to_displayed.push_back(timing.displayed_ns - timing.present_ns);
+        }
+
+        end_to_end.push_back(end_to_end_ns(timing));
+    }
+
+    report.sample_count = telemetry.sample_count;
+    report.acquire_to_submit = compute_percentiles(acquire_to_submit);
+    report.submit_to_present = compute_percentiles(submit_to_present);
+    report.present_to_displayed = compute_percentiles(present_to_displayed);
+    report.end_to_end = compute_percentiles(end_to_end);
+}
+
+std::optional<uint32_t> suggest_preference(LatencyTelemetry const& telemetry, uint32_t samples_per_preference) {
+    /* keep measuring the current preference until it has enough samples */
+    if (telemetry.preference < telemetry.preferences.size() && telemetry.preferences[telemetry.preference].end_to_end_ns.size() < samples_per_preference) {
+        return std::nullopt;
+    }
+
+    for (uint32_t i = 0; i < telemetry.preferences.size(); ++i) {
+        if (!telemetry.preferences[i].unsupported && telemetry.preferences[i].end_to_end_ns.size() < samples_per_preference) {
+            return i;
+        }
+    }
+
+    uint32_t best = telemetry.preference;
+    uint64_t best_p90 = std::numeric_limits<uint64_t>::max();
+    for (uint32_t i = 0; i < telemetry.preferences.size(); ++i) {
+        if (telemetry.preferences[i].unsupported || telemetry.preferences[i].end_to_end_ns.empty()) {
+            continue;
+        }
+
+        std::vector<uint64_t> values(telemetry.preferences[i].end_to_end_ns.begin(), telemetry.preferences[i].end_to_end_ns.end());
+        uint64_t p90 = compute_percentiles(values).p90_ns;
+        if (p90 < best_p90) {
+            best_p90 = p90;
+            best = i;
+        }
+    }
+
+    if (best == telemetry.preference) {
+        return std::nullopt;
+    }
+
+    KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "Swapchain preference {} has the lowest measured p90 latency ({} ns)", best, best_p90);
+    return best;
+}
+
+void cmd_blit_to_backbuffer(VkCommandBuffer vk_command_buffer, BackbufferBlitInfo const& blit_info) {
+    VkImageBlit vk_image_blit = {
+        .srcSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .srcOffsets = {
+            { 0, 0, 0 },
+            { static_cast<int32_t>(blit_info.vk_source_extent.width), static_cast<int32_t>(blit_info.vk_source_extent.height), 1 },
+        },
+        .dstSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .dstOffsets = {
+            { 0, 0, 0 },
+            { static_cast<int32_t>(blit_info.vk_backbuffer_extent.width), static_cast<int32_t>(blit_info.vk_backbuffer_extent.height), 1 },
+        },
+    };
+
+    vkCmdBlitImage(vk_command_buffer, blit_info.vk_source_image, blit_info.vk_source_layout, blit_info.vk_backbuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &vk_image_blit, blit_info.vk_filter);
+}
+
+}
+
+}
@@ -0,0 +1,559 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <algorithm>
+
+namespace kvk {
+
+namespace shader {
+
+/* the subset of the SPIR-V grammar reflection needs */
+namespace spv {
+
+static constexpr uint32_t MAGIC = 0x07230203;
+static constexpr uint32_t HEADER_WORDS = 5;
+
+enum Op : uint32_t {
+    OP_ENTRY_POINT = 15,
+    OP_EXECUTION_MODE = 16,
+    OP_TYPE_INT = 21,
+    OP_TYPE_FLOAT = 22,
+    OP_TYPE_VECTOR = 23,
+    OP_TYPE_MATRIX = 24,
+    OP_TYPE_IMAGE = 25,
+    OP_TYPE_SAMPLER = 26,
+    OP_TYPE_SAMPLED_IMAGE = 27,
+    OP_TYPE_ARRAY = 28,
+    OP_TYPE_RUNTIME_ARRAY = 29,
+    OP_TYPE_STRUCT = 30,
+    OP_TYPE_POINTER = 32,
+    OP_CONSTANT = 43,
+    OP_CONSTANT_COMPOSITE = 44,
+    OP_SPEC_CONSTANT = 50,
+    OP_SPEC_CONSTANT_COMPOSITE = 51,
+    OP_VARIABLE = 59,
+    OP_DECORATE = 71,
+    OP_MEMBER_DECORATE = 72,
+    OP_EXECUTION_MODE_ID = 331,
+};
+
+enum Decoration : uint32_t {
+    DECORATION_SPEC_ID = 1,
+    DECORATION_BLOCK = 2,
+    DECORATION_BUFFER_BLOCK = 3,
+    DECORATION_ARRAY_STRIDE = 6,
+    DECORATION_MATRIX_STRIDE = 7,
+    DECORATION_BUILT_IN = 11,
+    DECORATION_BINDING = 33,
+    DECORATION_DESCRIPTOR_SET = 34,
+    DECORATION_OFFSET = 35,
+};
+
+enum StorageClass : uint32_t {
+    STORAGE_CLASS_UNIFORM_CONSTANT = 0,
+    STORAGE_CLASS_UNIFORM = 2,
+    STORAGE_CLASS_PUSH_CONSTANT = 9,
+    STORAGE_CLASS_STORAGE_BUFFER = 12,
+};
+
+static constexpr uint32_t EXECUTION_MODE_LOCAL_SIZE = 17;
+static constexpr uint32_t EXECUTION_MODE_LOCAL_SIZE_ID = 38;
+static constexpr uint32_t BUILT_IN_WORKGROUP_SIZE = 25;
+static constexpr uint32_t DIM_BUFFER = 5;
+static constexpr uint32_t DIM_SUBPASS_DATA = 6;
+static constexpr uint32_t IMAGE_SAMPLED_STORAGE = 2;
+
+}
+
+/* what the parse pass remembers about each result id */
+struct IdInfo {
+    uint32_t opcode = 0;
+    uint32_t word = 0; /* first word of the defining instruction */
+    uint32_t set = UINT32_MAX;
+    uint32_t binding = UINT32_MAX;
+    uint32_t spec_id = NO_SPEC_ID;
+    uint32_t built_in = UINT32_MAX;
+    uint32_t array_stride = 0;
+    bool block = false;
+    bool buffer_block = false;
+};
+
+struct Module {
+    std::vector<uint32_t> const& words;
+    std::vector<IdInfo> ids;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> member_offsets;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> member_matrix_strides;
+};
+
+static VkShaderStageFlags execution_model_stage(uint32_t execution_model) {
+    switch (execution_model) {
+        case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+        case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+        default: return 0;
+    }
+}
+
+static uint32_t constant_value(Module const& module, uint32_t id) {
+    IdInfo const& info = module.ids[id];
+    if (info.opcode != spv::OP_CONSTANT && info.opcode != spv::OP_SPEC_CONSTANT) {
+        return 0;
+    }
+
+    return module.words[info.word + 3];
+}
+
+/* byte size as laid out in a block, following Offset/ArrayStride/MatrixStride decorations */
+static uint32_t type_size(Module const& module, uint32_t id) {
+    IdInfo const& info = module.ids[id];
+    uint32_t const* instruction = &module.words[info.word];
+    switch (info.opcode) {
+        case spv::OP_TYPE_INT:
+        case spv::OP_TYPE_FLOAT:
+            return instruction[2] / 8;
+        case spv::OP_TYPE_VECTOR:
+            return type_size(module, instruction[2]) * instruction[3];
+        case spv::OP_TYPE_MATRIX:
+            return type_size(module, instruction[2]) * instruction[3];
+        case spv::OP_TYPE_ARRAY: {
+            uint32_t length = constant_value(module, instruction[3]);
+            uint32_t stride = info.array_stride != 0 ? info.array_stride : type_size(module, instruction[2]);
+            return stride * length;
+        }
+        case spv::OP_TYPE_STRUCT: {
+            uint32_t member_count = (instruction[0] >> 16) - 2;
+            auto offsets = module.member_offsets.find(id);
+            auto matrix_strides = module.member_matrix_strides.find(id);
+            uint32_t size = 0;
+            uint32_t offset = 0;
+            for (uint32_t i = 0; i < member_count; ++i) {
+                if (offsets != module.member_offsets.end() && i < offsets->second.size()) {
+                    offset = offsets->second[i];
+                }
+
+                uint32_t member = instruction[2 + i];
+                uint32_t member_size = type_size(module, member);
+                if (module.ids[member].opcode == spv::OP_TYPE_MATRIX && matrix_strides != module.member_matrix_strides.end() && i < matrix_strides->second.size() && matrix_strides->second[i] != 0) {
+                    member_size = matrix_strides->second[i] * module.words[module.ids[member].word + 3];
+                }
+
+                size = std::max(size, offset + member_size);
+                offset += member_size;
+            }
+
+            return size;
+        }
+        default:
+            return 0;
+    }
+}
+
+/* strips arrays off a descriptor variable's type, then maps what's left to a descriptor type */
+static VkResult descriptor_type(Module const& module, uint32_t storage_class, uint32_t type, VkDescriptorType& vk_descriptor_type, uint32_t& count) {
+    count = 1;
+    while (module.ids[type].opcode == spv::OP_TYPE_ARRAY || module.ids[type].opcode == spv::OP_TYPE_RUNTIME_ARRAY) {
+        IdInfo const& info = module.ids[type];
+        count = info.opcode == spv::OP_TYPE_ARRAY ? count * constant_value(module, module.words[info.word + 3]) : 0;
+        type = module.words[info.word + 2];
+    }
+
+    IdInfo const& info = module.ids[type];
+    if (storage_class == spv::STORAGE_CLASS_STORAGE_BUFFER) {
+        vk_descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        return VK_SUCCESS;
+    }
+
+    if (storage_class == spv::STORAGE_CLASS_UNIFORM) {
+        /* BufferBlock is how pre-1.3 SPIR-V (and dxc by default) spells a storage buffer */
+        vk_descriptor_type = info.buffer_block ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        return VK_SUCCESS;
+    }
+
+    switch (info.opcode) {
+        case spv::OP_TYPE_SAMPLER:
+            vk_descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLER;
+            return VK_SUCCESS;
+        case spv::OP_TYPE_SAMPLED_IMAGE:
+            vk_descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            return VK_SUCCESS;
+        case spv::OP_TYPE_IMAGE: {
+            uint32_t dim = module.words[info.word + 3];
+            bool storage = module.words[info.word + 7] == spv::IMAGE_SAMPLED_STORAGE;
+            if (dim == spv::DIM_BUFFER) {
+                vk_descriptor_type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            } else if (dim == spv::DIM_SUBPASS_DATA) {
+                vk_descriptor_type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            } else {
+                vk_descriptor_type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+
+            return VK_SUCCESS;
+        }
+        default:
+            return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+}
+
+VkResult reflect(std::vector<uint32_t> const& spirv, Reflection& reflection) {
+    if (spirv.size() < spv::HEADER_WORDS || spirv[0] != spv::MAGIC) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Not a SPIR-V module ({} words)", spirv.size());
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    Module module = {
+        .words = spirv,
+        .ids = std::vector<IdInfo>(spirv[3]),
+    };
+
+    reflection = {};
+    for (uint32_t i = 0; i < 3; ++i) {
+        reflection.workgroup_size[i] = 1;
+        reflection.workgroup_size_spec_ids[i] = NO_SPEC_ID;
+    }
+
+    uint32_t entry_point = UINT32_MAX;
+    uint32_t local_size_ids[3] = { 0, 0, 0 };
+    std::vector<uint32_t> variables;
+
+    /* one pass collects ids, decorations and execution modes; resolving waits until every id is known */
+    for (uint32_t word = spv::HEADER_WORDS; word < spirv.size();) {
+        uint32_t word_count = spirv[word] >> 16;
+        uint32_t opcode = spirv[word] & 0xffff;
+        if (word_count == 0 || word + word_count > spirv.size()) {
+            KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Malformed SPIR-V instruction at word {}", word);
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        uint32_t const* instruction = &spirv[word];
+        auto define = [&](uint32_t id) {
+            if (id < module.ids.size()) {
+                module.ids[id].opcode = opcode;
+                module.ids[id].word = word;
+            }
+        };
+
+        switch (opcode) {
+            case spv::OP_ENTRY_POINT:
+                if (entry_point == UINT32_MAX) {
+                    entry_point = instruction[2];
+                    reflection.vk_shader_stage_flags = execution_model_stage(instruction[1]);
+                    reflection.entry = reinterpret_cast<char const*>(&instruction[3]);
+                }
+
+                break;
+            case spv::OP_EXECUTION_MODE:
+            case spv::OP_EXECUTION_MODE_ID:
+                if (instruction[1] == entry_point && word_count >= 6) {
+                    for (uint32_t i = 0; i < 3; ++i) {
+                        if (instruction[2] == spv::EXECUTION_MODE_LOCAL_SIZE) {
+                            reflection.workgroup_size[i] = instruction[3 + i];
+                        } else if (instruction[2] == spv::EXECUTION_MODE_LOCAL_SIZE_ID) {
+                            local_size_ids[i] = instruction[3 + i];
+                        }
+                    }
+                }
+
+                break;
+            case spv::OP_TYPE_INT:
+            case spv::OP_TYPE_FLOAT:
+            case spv::OP_TYPE_VECTOR:
+            case spv::OP_TYPE_MATRIX:
+            case spv::OP_TYPE_IMAGE:
+            case spv::OP_TYPE_SAMPLER:
+            case spv::OP_TYPE_SAMPLED_IMAGE:
+            case spv::OP_TYPE_ARRAY:
+            case spv::OP_TYPE_RUNTIME_ARRAY:
+            case spv::OP_TYPE_STRUCT:
+            case spv::OP_TYPE_POINTER:
+                define(instruction[1]);
+                break;
+            case spv::OP_CONSTANT:
+            case spv::OP_CONSTANT_COMPOSITE:
+            case spv::OP_SPEC_CONSTANT:
+            case spv::OP_SPEC_CONSTANT_COMPOSITE:
+                define(instruction[2]);
+                break;
+            case spv::OP_VARIABLE:
+                define(instruction[2]);
+                variables.push_back(instruction[2]);
+                break;
+            case spv::OP_DECORATE: {
+                if (instruction[1] >= module.ids.size()) {
+                    break;
+                }
+
+                IdInfo& info = module.ids[instruction[1]];
+                switch (instruction[2]) {
+                    case spv::DECORATION_SPEC_ID: info.spec_id = instruction[3]; break;
+                    case spv::DECORATION_BLOCK: info.block = true; break;
+                    case spv::DECORATION_BUFFER_BLOCK: info.buffer_block = true; break;
+                    case spv::DECORATION_ARRAY_STRIDE: info.array_stride = instruction[3]; break;
+                    case spv::DECORATION_BUILT_IN: info.built_in = instruction[3]; break;
+                    case spv::DECORATION_BINDING: info.binding = instruction[3]; break;
+                    case spv::DECORATION_DESCRIPTOR_SET: info.set = instruction[3]; break;
+                    default: break;
+                }
+
+                break;
+            }
+            case spv::OP_MEMBER_DECORATE:
+                if (instruction[3] == spv::DECORATION_OFFSET || instruction[3] == spv::DECORATION_MATRIX_STRIDE) {
+                    std::vector<uint32_t>& values = instruction[3] == spv::DECORATION_OFFSET ? module.member_offsets[instruction[1]] : module.member_matrix_strides[instruction[1]];
+                    if (values.size() <= instruction[2]) {
+                        values.resize(instruction[2] + 1, 0);
+                    }
+
+                    values[instruction[2]] = instruction[4];
+                }
+
+                break;
+            default:
+                break;
+        }
+
+        word += word_count;
+    }
+
+    if (entry_point == UINT32_MAX) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "SPIR-V module has no entry point");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    /* LocalSizeId, then a WorkgroupSize built-in, override the literal LocalSize */
+    for (uint32_t i = 0; i < 3; ++i) {
+        if (local_size_ids[i] != 0 && local_size_ids[i] < module.ids.size()) {
+            reflection.workgroup_size[i] = constant_value(module, local_size_ids[i]);
+            reflection.workgroup_size_spec_ids[i] = module.ids[local_size_ids[i]].spec_id;
+        }
+    }
+
+    for (uint32_t id = 0; id < module.ids.size(); ++id) {
+        IdInfo const& info = module.ids[id];
+        if (info.built_in != spv::BUILT_IN_WORKGROUP_SIZE || (info.opcode != spv::OP_CONSTANT_COMPOSITE && info.opcode != spv::OP_SPEC_CONSTANT_COMPOSITE)) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < 3; ++i) {
+            uint32_t component = spirv[info.word + 3 + i];
+            reflection.workgroup_size[i] = constant_value(module, component);
+            reflection.workgroup_size_spec_ids[i] = module.ids[component].spec_id;
+        }
+    }
+
+    for (uint32_t variable : variables) {
+        uint32_t const* instruction = &spirv[module.ids[variable].word];
+        uint32_t storage_class = instruction[3];
+        IdInfo const& pointer = module.ids[instruction[1]];
+        if (pointer.opcode != spv::OP_TYPE_POINTER) {
+            continue;
+        }
+
+        uint32_t type = spirv[pointer.word + 3];
+        if (storage_class == spv::STORAGE_CLASS_PUSH_CONSTANT) {
+            reflection.vk_push_constant_ranges.push_back({
+                .stageFlags = reflection.vk_shader_stage_flags,
+                .offset = 0,
+                .size = type_size(module, type),
+            });
+
+            continue;
+        }
+
+        if (storage_class != spv::STORAGE_CLASS_UNIFORM_CONSTANT && storage_class != spv::STORAGE_CLASS_UNIFORM && storage_class != spv::STORAGE_CLASS_STORAGE_BUFFER) {
+            continue;
+        }
+
+        IdInfo const& info = module.ids[variable];
+        if (info.set == UINT32_MAX || info.binding == UINT32_MAX) {
+            continue;
+        }
+
+        ReflectedBinding binding = {
+            .set = info.set,
+            .binding = info.binding,
+            .vk_shader_stage_flags = reflection.vk_shader_stage_flags,
+        };
+
+        if (descriptor_type(module, storage_class, type, binding.vk_descriptor_type, binding.count) != VK_SUCCESS) {
+            KVK_ERR(VK_ERROR_FORMAT_NOT_SUPPORTED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Unsupported descriptor at set {} binding {}", info.set, info.binding);
+            return VK_ERROR_FORMAT_NOT_SUPPORTED;
+        }
+
+        reflection.bindings.push_back(binding);
+    }
+
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](ReflectedBinding const& a, ReflectedBinding const& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    return VK_SUCCESS;
+}
+
+VkResult merge_reflections(std::vector<Reflection> const& stages, Reflection& merged) {
+    merged = {};
+    for (uint32_t i = 0; i < 3; ++i) {
+        merged.workgroup_size[i] = 1;
+        merged.workgroup_size_spec_ids[i] = NO_SPEC_ID;
+    }
+
+    for (Reflection const& stage : stages) {
+        merged.vk_shader_stage_flags |= stage.vk_shader_stage_flags;
+        if (stage.vk_shader_stage_flags & VK_SHADER_STAGE_COMPUTE_BIT) {
+            merged.entry = stage.entry;
+            std::copy(std::begin(stage.workgroup_size), std::end(stage.workgroup_size), merged.workgroup_size);
+            std::copy(std::begin(stage.workgroup_size_spec_ids), std::end(stage.workgroup_size_spec_ids), merged.workgroup_size_spec_ids);
+        }
+
+        for (ReflectedBinding const& binding : stage.bindings) {
+            auto it = std::find_if(merged.bindings.begin(), merged.bindings.end(), [&binding](ReflectedBinding const& existing) {
+                return existing.set == binding.set && existing.binding == binding.binding;
+            });
+
+            if (it == merged.bindings.end()) {
+                merged.bindings.push_back(binding);
+                continue;
+            }
+
+            if (it->vk_descriptor_type != binding.vk_descriptor_type || it->count != binding.count) {
+                KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Stages disagree on set {} binding {}: descriptor type {} x{} vs {} x{}", binding.set, binding.binding, static_cast<int32_t>(it->vk_descriptor_type), it->count, static_cast<int32_t>(binding.vk_descriptor_type), binding.count);
+                return VK_ERROR_INITIALIZATION_FAILED;
+            }
+
+            it->vk_shader_stage_flags |= binding.vk_shader_stage_flags;
+        }
+
+        /* identical blocks share one range, otherwise every stage keeps its own */
+        for (VkPushConstantRange const& vk_range : stage.vk_push_constant_ranges) {
+            auto it = std::find_if(merged.vk_push_constant_ranges.begin(), merged.vk_push_constant_ranges.end(), [&vk_range](VkPushConstantRange const& existing) {
+                return existing.offset == vk_range.offset && existing.size == vk_range.size;
+            });
+
+            if (it == merged.vk_push_constant_ranges.end()) {
+                merged.vk_push_constant_ranges.push_back(vk_range);
+            } else {
+                it->stageFlags |= vk_range.stageFlags;
+            }
+        }
+    }
+
+    std::sort(merged.bindings.begin(), merged.bindings.end(), [](ReflectedBinding const& a, ReflectedBinding const& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    return VK_SUCCESS;
+}
+
+std::vector<VkDescriptorPoolSize> pool_sizes(Reflection const& reflection, uint32_t set) {
+    std::vector<VkDescriptorPoolSize> vk_descriptor_pool_sizes;
+    for (ReflectedBinding const& binding : reflection.bindings) {
+        if (binding.set != set) {
+            continue;
+        }
+
+        auto it = std::find_if(vk_descriptor_pool_sizes.begin(), vk_descriptor_pool_sizes.end(), [&binding](VkDescriptorPoolSize const& size) {
+            return size.type == binding.vk_descriptor_type;
+        });
+
+        if (it == vk_descriptor_pool_sizes.end()) {
+            vk_descriptor_pool_sizes.push_back({ .type = binding.vk_descriptor_type, .descriptorCount = binding.count });
+        } else {
+            it->descriptorCount += binding.count;
+        }
+    }
+
+    return vk_descriptor_pool_sizes;
+}
+
+VkResult create_layouts(VkDevice vk_device, layout::LayoutCache& cache, ReflectedLayoutCreateInfo const& create_info, ReflectedLayouts& layouts) {
+    Reflection const& reflection = create_info.reflection;
+    uint32_t set_count = reflection.bindings.empty() ? 0 : reflection.bindings.back().set + 1;
+    layouts.vk_descriptor_set_layouts.assign(set_count, VK_NULL_HANDLE);
+
+    std::vector<VkDescriptorSetLayoutBinding> vk_bindings;
+    for (uint32_t set = 0; set < set_count; ++set) {
+        vk_bindings.clear();
+        for (ReflectedBinding const& binding : reflection.bindings) {
+            if (binding.set != set) {
+                continue;
+            }
+
+            if (binding.count == 0) {
+                KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Set {} binding {} is runtime sized; use a bindless heap for it instead", binding.set, binding.binding);
+                return VK_ERROR_INITIALIZATION_FAILED;
+            }
+
+            vk_bindings.push_back({
+                .binding = binding.binding,
+                .descriptorType = binding.vk_descriptor_type,
+                .descriptorCount = binding.count,
+                .stageFlags = binding.vk_shader_stage_flags,
+            });
+        }
+
+        VkDescriptorSetLayoutCreateInfo vk_descriptor_set_layout_create_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .flags = set < create_info.vk_set_flags.size() ? create_info.vk_set_flags[set] : 0,
+            .bindingCount = static_cast<uint32_t>(vk_bindings.size()),
+            .pBindings = vk_bindings.data(),
+        };
+
+        VkResult vk_result = layout::get_descriptor_set_layout(vk_device, cache, vk_descriptor_set_layout_create_info, layouts.vk_descriptor_set_layouts[set]);
+        if (vk_result != VK_SUCCESS) {
+            return vk_result;
+        }
+    }
+
+    VkPipelineLayoutCreateInfo vk_pipeline_layout_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = set_count,
+        .pSetLayouts = layouts.vk_descriptor_set_layouts.data(),
+        .pushConstantRangeCount = static_cast<uint32_t>(reflection.vk_push_constant_ranges.size()),
+        .pPushConstantRanges = reflection.vk_push_constant_ranges.data(),
+    };
+
+    return layout::get_pipeline_layout(vk_device, cache, vk_pipeline_layout_create_info, layouts.vk_pipeline_layout);
+}
+
+void add_constant(Specialization& specialization, uint32_t spec_id, uint32_t value) {
+    specialization.vk_map_entries.push_back({
+        .constantID = spec_id,
+        .offset = static_cast<uint32_t>(specialization.data.size() * sizeof(uint32_t)),
+        .size = sizeof(uint32_t),
+    });
+
+    specialization.data.push_back(value);
+
+    /* both vectors may have moved */
+    specialization.vk_specialization_info = {
+        .mapEntryCount = static_cast<uint32_t>(specialization.vk_map_entries.size()),
+        .pMapEntries = specialization.vk_map_entries.data(),
+        .dataSize = specialization.data.size() * sizeof(uint32_t),
+        .pData = specialization.data.data(),
+    };
+}
+
+bool specialize_workgroup(Reflection const& reflection, uint32_t const (&workgroup_size)[3], Specialization& specialization) {
+    for (uint32_t i = 0; i < 3; ++i) {
+        if (reflection.workgroup_size_spec_ids[i] == NO_SPEC_ID && workgroup_size[i] != reflection.workgroup_size[i]) {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        if (reflection.workgroup_size_spec_ids[i] != NO_SPEC_ID) {
+            add_constant(specialization, reflection.workgroup_size_spec_ids[i], workgroup_size[i]);
+        }
+    }
+
+    return true;
+}
+
+}
+
+}
@@ -0,0 +1,242 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+namespace kvk {
+
+#ifdef KVK_USE_DXC
+
+namespace reload {
+
+static int64_t write_time(std::string const& path) {
+    std::error_code error;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+static void destroy_built(VkDevice vk_device, VkShaderModule vk_shader_module, std::vector<VkPipeline>& vk_pipelines) {
+    for (VkPipeline vk_pipeline : vk_pipelines) {
+        vkDestroyPipeline(vk_device, vk_pipeline, nullptr);
+    }
+
+    vk_pipelines.clear();
+    vkDestroyShaderModule(vk_device, vk_shader_module, nullptr);
+}
+
+/* runs on the watcher thread without the lock; the snapshot is a copy so watch() can keep adding meanwhile */
+static bool rebuild(Watcher& watcher, WatchedShader const& snapshot, VkShaderModule& vk_shader_module, std::vector<VkPipeline>& vk_pipelines) {
+    std::ifstream in(snapshot.path);
+    if (!in.good()) {
+        KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Failed to reopen \"{}\" for reloading", snapshot.path);
+        return false;
+    }
+
+    std::string source((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::vector<uint32_t> spirv;
+    if (shader::hlsl::compile_spirv({
+        .source = source,
+        .entry = snapshot.entry,
+        .vk_shader_stage_flags = snapshot.vk_shader_stage_flags,
+        .defines = snapshot.defines,
+        .cache = watcher.cache,
+    }, spirv) != VK_SUCCESS) {
+        KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "\"{}\" failed to compile, keeping the running version", snapshot.path);
+        return false;
+    }
+
+    if (shader::create_module(watcher.vk_device, spirv, vk_shader_module) != VK_SUCCESS) {
+        return false;
+    }
+
+    vk_pipelines.assign(snapshot.vk_compute_create_infos.size(), VK_NULL_HANDLE);
+    for (uint32_t i = 0; i < snapshot.vk_compute_create_infos.size(); ++i) {
+        VkComputePipelineCreateInfo vk_compute_pipeline_create_info = snapshot.vk_compute_create_infos[i];
+        vk_compute_pipeline_create_info.stage.module = vk_shader_module;
+        vk_compute_pipeline_create_info.stage.pName = snapshot.entry.c_str();
+
+        VkResult vk_result = vkCreateComputePipelines(watcher.vk_device, watcher.vk_pipeline_cache, 1, &vk_compute_pipeline_create_info, nullptr, &vk_pipelines[i]);
+        if (vk_result != VK_SUCCESS) {
+            KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Failed to rebuild pipeline {} for \"{}\", keeping the running version", i, snapshot.path);
+            vk_pipelines.resize(i);
+            destroy_built(watcher.vk_device, vk_shader_module, vk_pipelines);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void watcher_main(Watcher& watcher) {
+    std::vector<WatchedShader> snapshots;
+    std::vector<uint32_t> snapshot_ids;
+    while (watcher.running.load(std::memory_order_acquire)) {
+        {
+            std::unique_lock<std::mutex> lock(watcher.mutex);
+            watcher.wake.wait_for(lock, watcher.poll_interval, [&watcher]() {
+                return !watcher.running.load(std::memory_order_relaxed);
+            });
+
+            if (!watcher.running.load(std::memory_order_relaxed)) {
+                break;
+            }
+
+            /* stat under the lock, it's cheap; compiling is not, so that happens unlocked */
+            snapshots.clear();
+            snapshot_ids.clear();
+            for (uint32_t id = 0; id < watcher.watched.size(); ++id) {
+                WatchedShader& watched = watcher.watched[id];
+                int64_t last_write_time = write_time(watched.path);
+                if (last_write_time == 0 || last_write_time == watched.last_write_time) {
+                    continue;
+                }
+
+                /* recorded up front so a broken edit isn't retried every poll */
+                watched.last_write_time = last_write_time;
+                snapshots.push_back({
+                    .path = watched.path,
+                    .entry = watched.entry,
+                    .vk_shader_stage_flags = watched.vk_shader_stage_flags,
+                    .defines = watched.defines,
+                    .vk_compute_create_infos = watched.vk_compute_create_infos,
+                });
+
+                snapshot_ids.push_back(id);
+            }
+        }
+
+        for (uint32_t i = 0; i < snapshots.size(); ++i) {
+            WatchedShader const& snapshot = snapshots[i];
+            VkShaderModule vk_shader_module = VK_NULL_HANDLE;
+            std::vector<VkPipeline> vk_pipelines;
+            if (!rebuild(watcher, snapshot, vk_shader_module, vk_pipelines)) {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(watcher.mutex);
+            WatchedShader& watched = watcher.watched[snapshot_ids[i]];
+
+            /* a rebuild nobody applied yet was never used, so it can go right away */
+            if (watched.pending) {
+                destroy_built(watcher.vk_device, watched.vk_pending_shader_module, watched.vk_pending_pipelines);
+            }
+
+            watched.pending = true;
+            watched.vk_pending_shader_module = vk_shader_module;
+            watched.vk_pending_pipelines = std::move(vk_pipelines);
+            KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT, "Rebuilt {} pipeline(s) from \"{}\"", watched.vk_pending_pipelines.size(), watched.path);
+        }
+    }
+}
+
+VkResult create_watcher(VkDevice vk_device, WatcherCreateInfo const& create_info, Watcher& watcher) {
+    watcher.vk_device = vk_device;
+    watcher.cache = create_info.cache;
+    watcher.poll_interval = create_info.poll_interval.count() == 0 ? std::chrono::milliseconds(250) : create_info.poll_interval;
+    watcher.watched.clear();
+
+    VkPipelineCacheCreateInfo vk_pipeline_cache_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+    };
+
+    VkResult vk_result = vkCreatePipelineCache(vk_device, &vk_pipeline_cache_create_info, nullptr, &watcher.vk_pipeline_cache);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create pipeline cache for shader reloading");
+        return vk_result;
+    }
+
+    watcher.running.store(true, std::memory_order_release);
+    watcher.thread = std::thread(watcher_main, std::ref(watcher));
+    return VK_SUCCESS;
+}
+
+void destroy_watcher(Watcher& watcher) {
+    {
+        std::lock_guard<std::mutex> lock(watcher.mutex);
+        watcher.running.store(false, std::memory_order_release);
+    }
+
+    watcher.wake.notify_all();
+    if (watcher.thread.joinable()) {
+        watcher.thread.join();
+    }
+
+    for (WatchedShader& watched : watcher.watched) {
+        if (watched.pending) {
+            destroy_built(watcher.vk_device, watched.vk_pending_shader_module, watched.vk_pending_pipelines);
+        }
+
+        if (watched.owned) {
+            destroy_built(watcher.vk_device, watched.vk_shader_module, watched.vk_pipelines);
+        }
+    }
+
+    watcher.watched.clear();
+    vkDestroyPipelineCache(watcher.vk_device, watcher.vk_pipeline_cache, nullptr);
+    watcher.vk_pipeline_cache = VK_NULL_HANDLE;
+}
+
+uint32_t watch(Watcher& watcher, WatchCreateInfo const& create_info) {
+    std::lock_guard<std::mutex> lock(watcher.mutex);
+    watcher.watched.push_back({
+        .path = create_info.path,
+        .entry = create_info.entry,
+        .vk_shader_stage_flags = create_info.vk_shader_stage_flags,
+        .defines = create_info.defines,
+        .vk_compute_create_infos = create_info.vk_compute_create_infos,
+        .last_write_time = write_time(create_info.path),
+        .vk_shader_module = create_info.vk_shader_module,
+        .vk_pipelines = create_info.vk_pipelines,
+        .owned = false,
+        .generation = 0,
+        .pending = false,
+        .vk_pending_shader_module = VK_NULL_HANDLE,
+    });
+
+    return static_cast<uint32_t>(watcher.watched.size() - 1);
+}
+
+uint32_t apply(Watcher& watcher, deletion::DeletionQueue& deletion_queue, scheduler::WorkHandle after) {
+    std::lock_guard<std::mutex> lock(watcher.mutex);
+    uint32_t swapped = 0;
+    for (WatchedShader& watched : watcher.watched) {
+        if (!watched.pending) {
+            continue;
+        }
+
+        /* frames up to after may still be running the old pipelines; the caller's originals are left alone */
+        if (watched.owned) {
+            for (VkPipeline vk_pipeline : watched.vk_pipelines) {
+                deletion::defer_pipeline(deletion_queue, after, vk_pipeline);
+            }
+
+            deletion::defer_shader_module(deletion_queue, after, watched.vk_shader_module);
+        }
+
+        watched.vk_shader_module = watched.vk_pending_shader_module;
+        watched.vk_pipelines = std::move(watched.vk_pending_pipelines);
+        watched.vk_pending_shader_module = VK_NULL_HANDLE;
+        watched.vk_pending_pipelines.clear();
+        watched.pending = false;
+        watched.owned = true;
+        ++watched.generation;
+        ++swapped;
+    }
+
+    return swapped;
+}
+
+VkPipeline pipeline(Watcher const& watcher, uint32_t id, uint32_t index) {
+    return watcher.watched[id].vk_pipelines[index];
+}
+
+}
+
+#endif
+
+}
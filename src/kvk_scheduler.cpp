@@ -0,0 +1,313 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <limits>
+#include <algorithm>
+#include <bit>
+
+namespace kvk {
+
+namespace scheduler {
+
+VkResult create_scheduler(VkDevice vk_device, SchedulerCreateInfo const& create_info, Scheduler& scheduler) {
+    PFN_vkQueueSubmit2KHR vk_queue_submit2_khr = reinterpret_cast<PFN_vkQueueSubmit2KHR>(vkGetDeviceProcAddr(vk_device, "vkQueueSubmit2KHR"));
+    if (vk_queue_submit2_khr == nullptr) {
+        KVK_ERR(VK_ERROR_EXTENSION_NOT_PRESENT, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to load vkQueueSubmit2KHR; was the device created with DevicePresets::enable_synchronization2?");
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    uint32_t vk_queue_family_count;
+    vkGetPhysicalDeviceQueueFamilyProperties(create_info.vk_physical_device, &vk_queue_family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> vk_queue_family_properties(vk_queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(create_info.vk_physical_device, &vk_queue_family_count, vk_queue_family_properties.data());
+
+    VkSemaphoreTypeCreateInfo vk_semaphore_type_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+
+    VkSemaphoreCreateInfo vk_semaphore_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &vk_semaphore_type_create_info,
+    };
+
+    scheduler.vk_queue_submit2_khr = vk_queue_submit2_khr;
+    scheduler.queues.clear();
+    scheduler.pending.clear();
+
+    for (DeviceQueueReturn const& queue_return : create_info.queues) {
+        if (queue_return.family_index >= vk_queue_family_properties.size()) {
+            KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Scheduler queue family index {} is out of range", queue_return.family_index);
+            destroy_scheduler(vk_device, scheduler);
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        VkBool32 present_support = VK_FALSE;
+        if (create_info.vk_present_surface != VK_NULL_HANDLE) {
+            VkResult vk_result = vkGetPhysicalDeviceSurfaceSupportKHR(create_info.vk_physical_device, queue_return.family_index, create_info.vk_present_surface, &present_support);
+            if (vk_result != VK_SUCCESS) {
+                KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Failed to query present support of queue family {}; assuming none", queue_return.family_index);
+                present_support = VK_FALSE;
+            }
+        }
+
+        VkSemaphore vk_timeline;
+        VkResult vk_result = vkCreateSemaphore(vk_device, &vk_semaphore_create_info, nullptr, &vk_timeline);
+        if (vk_result != VK_SUCCESS) {
+            KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create timeline semaphore for queue {}.{}; was the device created with DevicePresets::enable_timeline_semaphore?", queue_return.family_index, queue_return.queue_index);
+            destroy_scheduler(vk_device, scheduler);
+            return vk_result;
+        }
+
+        scheduler.queues.push_back({
+            .vk_queue = queue_return.vk_queue,
+            .family_index = queue_return.family_index,
+            .vk_queue_flags = vk_queue_family_properties[queue_return.family_index].queueFlags,
+            .present_support = present_support == VK_TRUE,
+            .vk_timeline = vk_timeline,
+            .last_value = 0,
+            .last_submitted_value = 0,
+            .mutex = std::make_unique<std::mutex>(),
+        });
+    }
+
+    return VK_SUCCESS;
+}
+
+void destroy_scheduler(VkDevice vk_device, Scheduler& scheduler) {
+    for (SchedulerQueue& queue : scheduler.queues) {
+        /* waiting for a value that was never submitted would never return */
+        if (queue.last_submitted_value != 0) {
+            VkSemaphoreWaitInfo vk_semaphore_wait_info = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                .semaphoreCount = 1,
+                .pSemaphores = &queue.vk_timeline,
+                .pValues = &queue.last_submitted_value,
+            };
+
+            vkWaitSemaphores(vk_device, &vk_semaphore_wait_info, std::numeric_limits<uint64_t>::max());
+        }
+
+        vkDestroySemaphore(vk_device, queue.vk_timeline, nullptr);
+    }
+
+    scheduler.queues.clear();
+    scheduler.pending.clear();
+}
+
+/* fewest capabilities beyond the required ones, then least pending work */
+static uint32_t pick_queue(Scheduler const& scheduler, WorkItem const& item) {
+    uint32_t best = std::numeric_limits<uint32_t>::max();
+    int best_extra = std::numeric_limits<int>::max();
+    size_t best_load = std::numeric_limits<size_t>::max();
+
+    for (uint32_t i = 0; i < scheduler.queues.size(); ++i) {
+        SchedulerQueue const& queue = scheduler.queues[i];
+        if ((queue.vk_queue_flags & item.vk_required_flags) != item.vk_required_flags) {
+            continue;
+        }
+
+        if (item.requires_present && !queue.present_support) {
+            continue;
+        }
+
+        if (item.family_index.has_value() && item.family_index.value() != queue.family_index) {
+            continue;
+        }
+
+        int extra = std::popcount(static_cast<uint32_t>(queue.vk_queue_flags & ~item.vk_required_flags));
+        size_t load = std::count_if(scheduler.pending.begin(), scheduler.pending.end(), [i](PendingWork const& work) -> bool {
+            return work.handle.queue == i;
+        });
+
+        if (extra < best_extra || (extra == best_extra && load < best_load)) {
+            best = i;
+            best_extra = extra;
+            best_load = load;
+        }
+    }
+
+    return best;
+}
+
+VkResult enqueue(Scheduler& scheduler, WorkItem item, WorkHandle& handle) {
+    std::lock_guard<std::mutex> lock(scheduler.pending_mutex);
+
+    uint32_t queue = pick_queue(scheduler, item);
+    if (queue == std::numeric_limits<uint32_t>::max()) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "No scheduler queue has the required flags {:#x}{}{}", item.vk_required_flags, item.requires_present ? " and present support" : "", item.family_index.has_value() ? std::format(" in family {}", item.family_index.value()) : "");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    for (WorkHandle const& dependency : item.dependencies) {
+        if (dependency.queue >= scheduler.queues.size() || dependency.value > scheduler.queues[dependency.queue].last_value) {
+            KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Work dependency on queue {} value {} was never enqueued", dependency.queue, dependency.value);
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+    }
+
+    /* values are handed out under the lock, so each queue's timeline only ever moves forward in submission order */
+    handle = {
+        .queue = queue,
+        .value = ++scheduler.queues[queue].last_value,
+    };
+
+    scheduler.pending.push_back({
+        .handle = handle,
+        .item = std::move(item),
+    });
+
+    return VK_SUCCESS;
+}
+
+VkResult flush(Scheduler& scheduler) {
+    /* held throughout: two overlapping flushes could otherwise submit one queue's timeline values out of order */
+    std::lock_guard<std::mutex> pending_lock(scheduler.pending_mutex);
+    std::vector<PendingWork> pending;
+    pending.swap(scheduler.pending);
+
+    if (pending.empty()) {
+        return VK_SUCCESS;
+    }
+
+    /* laid out up front so the VkSubmitInfo2 pointers stay valid */
+    std::vector<std::vector<VkSemaphoreSubmitInfo>> waits(pending.size());
+    std::vector<std::vector<VkSemaphoreSubmitInfo>> signals(pending.size());
+    std::vector<std::vector<VkCommandBufferSubmitInfo>> command_buffers(pending.size());
+
+    for (size_t i = 0; i < pending.size(); ++i) {
+        PendingWork const& work = pending[i];
+
+        /* only the latest value per queue matters */
+        std::vector<uint64_t> wait_values(scheduler.queues.size(), 0);
+        for (WorkHandle const& dependency : work.item.dependencies) {
+            wait_values[dependency.queue] = std::max(wait_values[dependency.queue], dependency.value);
+        }
+
+        for (uint32_t q = 0; q < wait_values.size(); ++q) {
+            if (wait_values[q] == 0) {
+                continue;
+            }
+
+            waits[i].push_back({
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                .semaphore = scheduler.queues[q].vk_timeline,
+                .value = wait_values[q],
+                .stageMask = work.item.vk_dependency_stage != 0 ? work.item.vk_dependency_stage : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            });
+        }
+
+        waits[i].insert(waits[i].end(), work.item.vk_wait_semaphores.begin(), work.item.vk_wait_semaphores.end());
+
+        signals[i] = work.item.vk_signal_semaphores;
+        signals[i].push_back({
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = scheduler.queues[work.handle.queue].vk_timeline,
+            .value = work.handle.value,
+            .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        });
+
+        for (VkCommandBuffer vk_command_buffer : work.item.vk_command_buffers) {
+            command_buffers[i].push_back({
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                .commandBuffer = vk_command_buffer,
+            });
+        }
+    }
+
+    /* pending is in enqueue order, which is also timeline value order per queue */
+    VkResult vk_first_error = VK_SUCCESS;
+    std::vector<VkSubmitInfo2KHR> vk_submit_infos;
+    for (uint32_t q = 0; q < scheduler.queues.size(); ++q) {
+        vk_submit_infos.clear();
+        uint64_t last_value = 0;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            if (pending[i].handle.queue != q) {
+                continue;
+            }
+
+            last_value = pending[i].handle.value;
+            vk_submit_infos.push_back({
+                .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                .waitSemaphoreInfoCount = static_cast<uint32_t>(waits[i].size()),
+                .pWaitSemaphoreInfos = waits[i].data(),
+                .commandBufferInfoCount = static_cast<uint32_t>(command_buffers[i].size()),
+                .pCommandBufferInfos = command_buffers[i].data(),
+                .signalSemaphoreInfoCount = static_cast<uint32_t>(signals[i].size()),
+                .pSignalSemaphoreInfos = signals[i].data(),
+            });
+        }
+
+        if (vk_submit_infos.empty()) {
+            continue;
+        }
+
+        SchedulerQueue& queue = scheduler.queues[q];
+        std::lock_guard<std::mutex> lock(*queue.mutex);
+        VkResult vk_result = scheduler.vk_queue_submit2_khr(queue.vk_queue, static_cast<uint32_t>(vk_submit_infos.size()), vk_submit_infos.data(), VK_NULL_HANDLE);
+        if (vk_result != VK_SUCCESS) {
+            KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to submit {} work items to scheduler queue {}", vk_submit_infos.size(), q);
+            if (vk_first_error == VK_SUCCESS) {
+                vk_first_error = vk_result;
+            }
+
+            continue;
+        }
+
+        queue.last_submitted_value = last_value;
+    }
+
+    return vk_first_error;
+}
+
+VkResult queue_present(Scheduler& scheduler, uint32_t queue, VkPresentInfoKHR const& vk_present_info, present::LatencyTelemetry* telemetry) {
+    if (queue >= scheduler.queues.size()) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Scheduler queue {} is out of range", queue);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    std::lock_guard<std::mutex> lock(*scheduler.queues[queue].mutex);
+    if (telemetry != nullptr) {
+        return present::queue_present(*telemetry, scheduler.queues[queue].vk_queue, vk_present_info);
+    }
+
+    return vkQueuePresentKHR(scheduler.queues[queue].vk_queue, &vk_present_info);
+}
+
+VkResult wait(VkDevice vk_device, Scheduler const& scheduler, WorkHandle handle, uint64_t timeout_ns) {
+    if (handle.queue >= scheduler.queues.size()) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Scheduler queue {} is out of range", handle.queue);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkSemaphoreWaitInfo vk_semaphore_wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &scheduler.queues[handle.queue].vk_timeline,
+        .pValues = &handle.value,
+    };
+
+    return vkWaitSemaphores(vk_device, &vk_semaphore_wait_info, timeout_ns);
+}
+
+bool is_complete(VkDevice vk_device, Scheduler const& scheduler, WorkHandle handle) {
+    if (handle.queue >= scheduler.queues.size()) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Scheduler queue {} is out of range", handle.queue);
+        return false;
+    }
+
+    uint64_t value = 0;
+    if (vkGetSemaphoreCounterValue(vk_device, scheduler.queues[handle.queue].vk_timeline, &value) != VK_SUCCESS) {
+        return false;
+    }
+
+    return value >= handle.value;
+}
+
+}
+
+}
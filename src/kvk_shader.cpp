@@ -0,0 +1,356 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <cstring>
+
+namespace kvk {
+
+namespace shader {
+
+static constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+static std::filesystem::path entry_path(CompileCache const& cache, uint64_t key) {
+    return std::filesystem::path(cache.directory) / std::format("{:016x}.spv", key);
+}
+
+VkResult create_compile_cache(CompileCacheCreateInfo const& create_info, CompileCache& cache) {
+    cache.directory = create_info.directory;
+    cache.entries.clear();
+    cache.memory_hits = 0;
+    cache.disk_hits = 0;
+    cache.misses = 0;
+
+    if (!cache.directory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(cache.directory, error);
+        if (error) {
+            KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create shader cache directory \"{}\": {}", cache.directory, error.message());
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+    }
+
+    return VK_SUCCESS;
+}
+
+void destroy_compile_cache(CompileCache& cache) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.entries.clear();
+}
+
+bool cache_lookup(CompileCache& cache, uint64_t key, std::vector<uint32_t>& spirv) {
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.entries.find(key);
+        if (it != cache.entries.end()) {
+            spirv = it->second;
+            ++cache.memory_hits;
+            return true;
+        }
+    }
+
+    /* disk reads happen unlocked so parallel compiles don't serialize on them */
+    if (!cache.directory.empty()) {
+        std::ifstream in(entry_path(cache, key), std::ios::binary | std::ios::ate);
+        if (in) {
+            size_t size = static_cast<size_t>(in.tellg());
+            if (size >= sizeof(uint32_t) && size % sizeof(uint32_t) == 0) {
+                std::vector<uint32_t> loaded(size / sizeof(uint32_t));
+                in.seekg(0);
+                in.read(reinterpret_cast<char*>(loaded.data()), size);
+
+                /* a torn or foreign file is treated as a miss and overwritten by the next store */
+                if (in && loaded[0] == SPIRV_MAGIC) {
+                    std::lock_guard<std::mutex> lock(cache.mutex);
+                    spirv = cache.entries.try_emplace(key, std::move(loaded)).first->second;
+                    ++cache.disk_hits;
+                    return true;
+                }
+            }
+        }
+    }
+
+    ++cache.misses;
+    return false;
+}
+
+void cache_store(CompileCache& cache, uint64_t key, std::vector<uint32_t> const& spirv) {
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.entries.insert_or_assign(key, spirv);
+    }
+
+    if (cache.directory.empty()) {
+        return;
+    }
+
+    /* write beside the final name and rename over it, so concurrent readers and other processes never see a partial entry */
+    std::filesystem::path path = entry_path(cache, key);
+    std::filesystem::path temporary_path = path;
+    temporary_path += std::format(".{:x}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+    {
+        std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<char const*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+        if (!out) {
+            KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Failed to write shader cache entry \"{}\"", temporary_path.string());
+            out.close();
+            std::error_code error;
+            std::filesystem::remove(temporary_path, error);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Failed to publish shader cache entry \"{}\": {}", path.string(), error.message());
+        std::filesystem::remove(temporary_path, error);
+    }
+}
+
+VkResult create_module(VkDevice vk_device, std::vector<uint32_t> const& spirv, VkShaderModule& vk_shader_module) {
+    VkShaderModuleCreateInfo vk_shader_module_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = spirv.size() * sizeof(uint32_t),
+        .pCode = spirv.data(),
+    };
+
+    VkResult vk_result = vkCreateShaderModule(vk_device, &vk_shader_module_create_info, nullptr, &vk_shader_module);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create shader module from {} words of SPIR-V", spirv.size());
+        return vk_result;
+    }
+
+    return VK_SUCCESS;
+}
+
+#ifdef KVK_USE_DXC
+
+namespace hlsl {
+
+/* DXC objects are not safe to share between threads, so each thread lazily gets its own */
+struct DxcInstance {
+    IDxcUtils* utils = nullptr;
+    IDxcCompiler3* compiler = nullptr;
+
+    ~DxcInstance() {
+        if (compiler != nullptr) {
+            compiler->Release();
+        }
+
+        if (utils != nullptr) {
+            utils->Release();
+        }
+    }
+};
+
+static DxcInstance* get_instance() {
+    thread_local DxcInstance instance;
+    if (instance.compiler == nullptr) {
+        if (FAILED(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&instance.utils))) || FAILED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&instance.compiler)))) {
+            KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create DXC compiler instance");
+            return nullptr;
+        }
+    }
+
+    return &instance;
+}
+
+std::string compiler_version() {
+    static std::string const version = []() -> std::string {
+        DxcInstance* instance = get_instance();
+        if (instance == nullptr) {
+            return "unavailable";
+        }
+
+        std::string result = "dxc";
+        IDxcVersionInfo* version_info = nullptr;
+        if (SUCCEEDED(instance->compiler->QueryInterface(IID_PPV_ARGS(&version_info)))) {
+            UINT32 major = 0;
+            UINT32 minor = 0;
+            version_info->GetVersion(&major, &minor);
+            result += std::format(" {}.{}", major, minor);
+            version_info->Release();
+        }
+
+        /* the commit distinguishes builds that share a version number */
+        IDxcVersionInfo2* version_info2 = nullptr;
+        if (SUCCEEDED(instance->compiler->QueryInterface(IID_PPV_ARGS(&version_info2)))) {
+            UINT32 commit_count = 0;
+            char* commit_hash = nullptr;
+            if (SUCCEEDED(version_info2->GetCommitInfo(&commit_count, &commit_hash)) && commit_hash != nullptr) {
+                result += std::format(" {} ({})", commit_hash, commit_count);
+                CoTaskMemFree(commit_hash);
+            }
+
+            version_info2->Release();
+        }
+
+        return result;
+    }();
+
+    return version;
+}
+
+static char const* stage_profile(VkShaderStageFlags vk_shader_stage_flags) {
+    switch (vk_shader_stage_flags) {
+        case VK_SHADER_STAGE_VERTEX_BIT: return "vs_6_0";
+        case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT: return "hs_6_0";
+        case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT: return "ds_6_0";
+        case VK_SHADER_STAGE_GEOMETRY_BIT: return "gs_6_0";
+        case VK_SHADER_STAGE_FRAGMENT_BIT: return "ps_6_0";
+        case VK_SHADER_STAGE_COMPUTE_BIT: return "cs_6_0";
+        default: return nullptr;
+    }
+}
+
+static uint64_t hash_string(std::string const& string, uint64_t hash) {
+    uint64_t size = string.size();
+    hash = hash_bytes(&size, sizeof(size), hash);
+    return hash_bytes(string.data(), string.size(), hash);
+}
+
+static std::wstring widen(std::string const& string) {
+    return std::wstring(string.begin(), string.end());
+}
+
+/* same flags as meson.build's dxc_spirv_args; wave intrinsics need the vulkan 1.1 target */
+static std::vector<std::wstring> compile_arguments(CompileInfo const& compile_info, char const* profile) {
+    std::vector<std::wstring> arguments = {
+        L"-E", widen(compile_info.entry),
+        L"-T", widen(profile),
+        L"-spirv", L"-Zi",
+        L"-fspv-target-env=vulkan1.1",
+    };
+
+    for (std::string const& define : compile_info.defines) {
+        arguments.push_back(L"-D");
+        arguments.push_back(widen(define));
+    }
+
+    return arguments;
+}
+
+/* the full argument list goes in, so changing any flag (not just entry, stage or defines) misses the cache */
+static uint64_t cache_key(CompileInfo const& compile_info, std::vector<std::wstring> const& arguments) {
+    uint64_t hash = hash_string(compile_info.source, hash_bytes(nullptr, 0));
+
+    uint64_t argument_count = arguments.size();
+    hash = hash_bytes(&argument_count, sizeof(argument_count), hash);
+    for (std::wstring const& argument : arguments) {
+        uint64_t size = argument.size();
+        hash = hash_bytes(&size, sizeof(size), hash);
+        hash = hash_bytes(argument.data(), argument.size() * sizeof(wchar_t), hash);
+    }
+
+    return hash_string(compiler_version(), hash);
+}
+
+VkResult compile_spirv(CompileInfo const& compile_info, std::vector<uint32_t>& spirv) {
+    char const* profile = stage_profile(compile_info.vk_shader_stage_flags);
+    if (profile == nullptr) {
+        KVK_ERR(VK_ERROR_FEATURE_NOT_PRESENT, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "No HLSL profile for shader stage {:#x}", compile_info.vk_shader_stage_flags);
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+
+    DxcInstance* instance = get_instance();
+    if (instance == nullptr) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    std::vector<std::wstring> arguments = compile_arguments(compile_info, profile);
+
+    uint64_t key = 0;
+    if (compile_info.cache != nullptr) {
+        key = cache_key(compile_info, arguments);
+        if (cache_lookup(*compile_info.cache, key, spirv)) {
+            return VK_SUCCESS;
+        }
+    }
+
+    std::vector<LPCWSTR> argument_pointers;
+    argument_pointers.reserve(arguments.size());
+    for (std::wstring const& argument : arguments) {
+        argument_pointers.push_back(argument.c_str());
+    }
+
+    DxcBuffer source_buffer = {
+        .Ptr = compile_info.source.data(),
+        .Size = compile_info.source.size(),
+        .Encoding = DXC_CP_UTF8,
+    };
+
+    IDxcResult* result = nullptr;
+    if (FAILED(instance->compiler->Compile(&source_buffer, argument_pointers.data(), static_cast<UINT32>(argument_pointers.size()), nullptr, IID_PPV_ARGS(&result)))) {
+        KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "DXC failed to run for entry \"{}\"", compile_info.entry);
+        return VK_ERROR_UNKNOWN;
+    }
+
+    HRESULT status = E_FAIL;
+    result->GetStatus(&status);
+
+    IDxcBlobUtf8* errors = nullptr;
+    result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr);
+    if (errors != nullptr) {
+        if (errors->GetStringLength() > 0) {
+            KVK_ERR(FAILED(status) ? VK_ERROR_UNKNOWN : VK_SUCCESS, FAILED(status) ? VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT : VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "DXC output for entry \"{}\":\n{}", compile_info.entry, errors->GetStringPointer());
+        }
+
+        errors->Release();
+    }
+
+    IDxcBlob* object = nullptr;
+    if (SUCCEEDED(status)) {
+        result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&object), nullptr);
+    }
+
+    result->Release();
+    if (object == nullptr) {
+        return VK_ERROR_UNKNOWN;
+    }
+
+    spirv.resize(object->GetBufferSize() / sizeof(uint32_t));
+    std::memcpy(spirv.data(), object->GetBufferPointer(), spirv.size() * sizeof(uint32_t));
+    object->Release();
+
+    if (compile_info.cache != nullptr) {
+        cache_store(*compile_info.cache, key, spirv);
+    }
+
+    return VK_SUCCESS;
+}
+
+VkResult compile(VkDevice vk_device, CompileInfo const& compile_info, VkShaderModule& vk_shader_module) {
+    std::vector<uint32_t> spirv;
+    VkResult vk_result = compile_spirv(compile_info, spirv);
+    if (vk_result != VK_SUCCESS) {
+        return vk_result;
+    }
+
+    return create_module(vk_device, spirv, vk_shader_module);
+}
+
+/* adapted from https://github.com/krisvers/vulkan-sandbox/blob/e3a6738e790bcab9647da5218fe49cd728bf0ade/main.odin#L342 */
+VkResult compile(VkDevice vk_device, std::string const& source, std::string const& entry, VkShaderStageFlags vk_shader_stage_flags, VkShaderModule& vk_shader_module) {
+    return compile(vk_device, {
+        .source = source,
+        .entry = entry,
+        .vk_shader_stage_flags = vk_shader_stage_flags,
+        .defines = {},
+        .cache = nullptr,
+    }, vk_shader_module);
+}
+
+}
+
+#endif
+
+}
+
+}
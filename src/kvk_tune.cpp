@@ -0,0 +1,309 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <system_error>
+#include <algorithm>
+
+namespace kvk {
+
+namespace tune {
+
+VkResult create_tuner(TunerCreateInfo const& create_info, Tuner& tuner) {
+    VkPhysicalDeviceIDProperties vk_physical_device_id_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES,
+    };
+
+    VkPhysicalDeviceProperties2 vk_physical_device_properties2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &vk_physical_device_id_properties,
+    };
+
+    vkGetPhysicalDeviceProperties2(create_info.vk_physical_device, &vk_physical_device_properties2);
+
+    tuner.path = create_info.path;
+    tuner.device_key.clear();
+    for (uint32_t i = 0; i < VK_UUID_SIZE; ++i) {
+        tuner.device_key += std::format("{:02x}", vk_physical_device_id_properties.deviceUUID[i]);
+    }
+
+    tuner.lines.clear();
+    tuner.choices.clear();
+    if (tuner.path.empty()) {
+        return VK_SUCCESS;
+    }
+
+    /* "<device uuid> <kernel> <label>" per line */
+    std::ifstream in(tuner.path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string device_key;
+        std::string kernel;
+        std::string label;
+        if (!(fields >> device_key >> kernel >> label)) {
+            continue;
+        }
+
+        if (device_key == tuner.device_key) {
+            tuner.choices[kernel] = label;
+        } else {
+            tuner.lines.push_back(line);
+        }
+    }
+
+    return VK_SUCCESS;
+}
+
+bool lookup(Tuner& tuner, std::string const& kernel, std::string& label) {
+    std::lock_guard<std::mutex> lock(tuner.mutex);
+    auto it = tuner.choices.find(kernel);
+    if (it == tuner.choices.end()) {
+        return false;
+    }
+
+    label = it->second;
+    return true;
+}
+
+VkResult store(Tuner& tuner, std::string const& kernel, std::string const& label) {
+    std::lock_guard<std::mutex> lock(tuner.mutex);
+    tuner.choices[kernel] = label;
+    if (tuner.path.empty()) {
+        return VK_SUCCESS;
+    }
+
+    std::filesystem::path path = tuner.path;
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp";
+
+    {
+        std::ofstream out(temporary_path, std::ios::trunc);
+        for (std::string const& line : tuner.lines) {
+            out << line << '\n';
+        }
+
+        for (auto const& choice : tuner.choices) {
+            out << tuner.device_key << ' ' << choice.first << ' ' << choice.second << '\n';
+        }
+
+        if (!out) {
+            KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to write tuning results \"{}\"", temporary_path.string());
+            out.close();
+            std::error_code error;
+            std::filesystem::remove(temporary_path, error);
+            return VK_ERROR_UNKNOWN;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to replace tuning results \"{}\": {}", tuner.path, error.message());
+        std::filesystem::remove(temporary_path, error);
+        return VK_ERROR_UNKNOWN;
+    }
+
+    return VK_SUCCESS;
+}
+
+static void finish(TuneSession& session, uint32_t chosen) {
+    session.done = true;
+    session.chosen = chosen;
+    std::fill(session.frame_variants.begin(), session.frame_variants.end(), UINT32_MAX);
+}
+
+VkResult begin_session(VkDevice vk_device, Tuner& tuner, TuneSessionCreateInfo const& create_info, TuneSession& session) {
+    uint32_t frames_in_flight = create_info.frames_in_flight == 0 ? 1 : create_info.frames_in_flight;
+    session.kernel = create_info.kernel;
+    session.labels = create_info.labels;
+    session.vk_query_pool = VK_NULL_HANDLE;
+    session.samples = create_info.samples == 0 ? 16 : create_info.samples;
+    session.keep_measuring = create_info.keep_measuring;
+    session.items_per_sample = create_info.items_per_sample;
+    session.ticks.assign(session.labels.size(), {});
+    session.frame_variants.assign(frames_in_flight, UINT32_MAX);
+    session.latest_ticks.reset();
+    session.current = 0;
+    session.done = false;
+    session.chosen = 0;
+
+    if (session.labels.empty()) {
+        KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Tuning session for \"{}\" has no variants", session.kernel);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    std::string label;
+    if (lookup(tuner, session.kernel, label)) {
+        auto it = std::find(session.labels.begin(), session.labels.end(), label);
+        if (it != session.labels.end()) {
+            finish(session, static_cast<uint32_t>(it - session.labels.begin()));
+        }
+    }
+
+    if (!session.done && session.labels.size() == 1) {
+        finish(session, 0);
+    }
+
+    if (session.done && !session.keep_measuring) {
+        return VK_SUCCESS;
+    }
+
+    VkPhysicalDeviceProperties vk_physical_device_properties;
+    vkGetPhysicalDeviceProperties(create_info.vk_physical_device, &vk_physical_device_properties);
+
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(create_info.vk_physical_device, &queue_family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> vk_queue_family_properties(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(create_info.vk_physical_device, &queue_family_count, vk_queue_family_properties.data());
+
+    uint32_t valid_bits = create_info.queue_family_index < queue_family_count ? vk_queue_family_properties[create_info.queue_family_index].timestampValidBits : 0;
+    if (valid_bits == 0) {
+        KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "Queue family {} has no timestamps, \"{}\" stays on variant \"{}\"", create_info.queue_family_index, session.kernel, session.labels[variant(session)]);
+        session.keep_measuring = false;
+        if (!session.done) {
+            finish(session, 0);
+        }
+
+        return VK_SUCCESS;
+    }
+
+    session.timestamp_period = vk_physical_device_properties.limits.timestampPeriod;
+    session.timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+    /* a begin/end pair per frame in flight */
+    VkQueryPoolCreateInfo vk_query_pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = frames_in_flight * 2,
+    };
+
+    VkResult vk_result = vkCreateQueryPool(vk_device, &vk_query_pool_create_info, nullptr, &session.vk_query_pool);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create timestamp query pool for tuning \"{}\"", session.kernel);
+        return vk_result;
+    }
+
+    return VK_SUCCESS;
+}
+
+void end_session(VkDevice vk_device, TuneSession& session) {
+    vkDestroyQueryPool(vk_device, session.vk_query_pool, nullptr);
+    session.vk_query_pool = VK_NULL_HANDLE;
+}
+
+uint32_t variant(TuneSession const& session) {
+    return session.done ? session.chosen : session.current;
+}
+
+void cmd_begin(VkCommandBuffer vk_command_buffer, TuneSession& session, uint32_t frame_index) {
+    uint32_t slot = frame_index % static_cast<uint32_t>(session.frame_variants.size());
+    if (session.done && !session.keep_measuring) {
+        session.frame_variants[slot] = UINT32_MAX;
+        return;
+    }
+
+    session.frame_variants[slot] = variant(session);
+    vkCmdResetQueryPool(vk_command_buffer, session.vk_query_pool, slot * 2, 2);
+    vkCmdWriteTimestamp(vk_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, session.vk_query_pool, slot * 2);
+}
+
+void cmd_end(VkCommandBuffer vk_command_buffer, TuneSession& session, uint32_t frame_index) {
+    uint32_t slot = frame_index % static_cast<uint32_t>(session.frame_variants.size());
+    if (session.frame_variants[slot] == UINT32_MAX) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(vk_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, session.vk_query_pool, slot * 2 + 1);
+}
+
+static uint64_t median(std::vector<uint64_t> ticks) {
+    std::nth_element(ticks.begin(), ticks.begin() + ticks.size() / 2, ticks.end());
+    return ticks[ticks.size() / 2];
+}
+
+VkResult collect(VkDevice vk_device, Tuner& tuner, TuneSession& session, uint32_t frame_index) {
+    uint32_t slot = frame_index % static_cast<uint32_t>(session.frame_variants.size());
+    uint32_t measured = session.frame_variants[slot];
+    session.latest_ticks.reset();
+    if (measured == UINT32_MAX) {
+        return VK_SUCCESS;
+    }
+
+    session.frame_variants[slot] = UINT32_MAX;
+
+    uint64_t timestamps[2];
+    VkResult vk_result = vkGetQueryPoolResults(vk_device, session.vk_query_pool, slot * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (vk_result != VK_SUCCESS) {
+        /* VK_NOT_READY means the frame wasn't actually waited on; the sample is dropped rather than blocking */
+        return vk_result == VK_NOT_READY ? VK_SUCCESS : vk_result;
+    }
+
+    session.latest_ticks = (timestamps[1] - timestamps[0]) & session.timestamp_mask;
+    session.ticks[measured].push_back(session.latest_ticks.value());
+
+    /* past tuning only a window of recent samples is kept for throughput() */
+    if (session.done) {
+        if (session.ticks[measured].size() > session.samples) {
+            session.ticks[measured].erase(session.ticks[measured].begin());
+        }
+
+        return VK_SUCCESS;
+    }
+
+    /* the first sample after a switch pays for pipeline warm-up, so it is taken but outvoted by the median */
+    while (session.current < session.labels.size() && session.ticks[session.current].size() >= session.samples) {
+        ++session.current;
+    }
+
+    if (session.current < session.labels.size()) {
+        return VK_SUCCESS;
+    }
+
+    uint32_t chosen = 0;
+    uint64_t chosen_ticks = UINT64_MAX;
+    for (uint32_t i = 0; i < session.labels.size(); ++i) {
+        uint64_t ticks = median(session.ticks[i]);
+        double ns = ticks * session.timestamp_period;
+        if (session.items_per_sample > 0.0) {
+            KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT, "\"{}\" variant \"{}\": {:.3f} us, {:.3f} G/s", session.kernel, session.labels[i], ns / 1000.0, session.items_per_sample / ns);
+        } else {
+            KVK_ERR(VK_SUCCESS, VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT, "\"{}\" variant \"{}\": {:.3f} us", session.kernel, session.labels[i], ns / 1000.0);
+        }
+
+        if (ticks < chosen_ticks) {
+            chosen = i;
+            chosen_ticks = ticks;
+        }
+    }
+
+    finish(session, chosen);
+    return store(tuner, session.kernel, session.labels[chosen]);
+}
+
+double throughput(TuneSession const& session) {
+    std::vector<uint64_t> const& ticks = session.ticks[variant(session)];
+    if (ticks.empty() || session.items_per_sample <= 0.0) {
+        return 0.0;
+    }
+
+    return session.items_per_sample / (median(ticks) * session.timestamp_period * 1e-9);
+}
+
+bool latest_seconds(TuneSession const& session, double& seconds) {
+    if (!session.latest_ticks.has_value()) {
+        return false;
+    }
+
+    seconds = session.latest_ticks.value() * session.timestamp_period * 1e-9;
+    return true;
+}
+
+}
+
+}
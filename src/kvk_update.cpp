@@ -0,0 +1,93 @@
+#define KVK_IMPLEMENTATION
+#include "kvk.h"
+#include "kvk_util.inl"
+
+#include <vector>
+#include <format>
+
+namespace kvk {
+
+namespace update {
+
+bool push_descriptors_supported(VkDevice vk_device) {
+    return vkGetDeviceProcAddr(vk_device, "vkCmdPushDescriptorSetWithTemplateKHR") != nullptr;
+}
+
+VkResult create_update_template(VkDevice vk_device, UpdateTemplateCreateInfo const& create_info, size_t data_size, UpdateTemplate& update_template) {
+    update_template.push = create_info.push;
+    update_template.vk_pipeline_layout = create_info.vk_pipeline_layout;
+    update_template.set = create_info.set;
+    update_template.data_size = data_size;
+    update_template.vk_cmd_push_descriptor_set_with_template_khr = nullptr;
+    if (create_info.push) {
+        update_template.vk_cmd_push_descriptor_set_with_template_khr = reinterpret_cast<PFN_vkCmdPushDescriptorSetWithTemplateKHR>(vkGetDeviceProcAddr(vk_device, "vkCmdPushDescriptorSetWithTemplateKHR"));
+        if (update_template.vk_cmd_push_descriptor_set_with_template_khr == nullptr) {
+            KVK_ERR(VK_ERROR_EXTENSION_NOT_PRESENT, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to load vkCmdPushDescriptorSetWithTemplateKHR; was the device created with DevicePresets::enable_push_descriptor?");
+            return VK_ERROR_EXTENSION_NOT_PRESENT;
+        }
+    }
+
+    std::vector<VkDescriptorUpdateTemplateEntry> vk_entries;
+    vk_entries.reserve(create_info.entries.size());
+    for (UpdateTemplateEntry const& entry : create_info.entries) {
+        if (entry.offset + entry.stride * entry.count > data_size) {
+            KVK_ERR(VK_ERROR_INITIALIZATION_FAILED, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Update template entry for binding {} reads past the {} byte descriptor struct", entry.binding, data_size);
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        vk_entries.push_back({
+            .dstBinding = entry.binding,
+            .dstArrayElement = 0,
+            .descriptorCount = entry.count,
+            .descriptorType = entry.vk_descriptor_type,
+            .offset = entry.offset,
+            .stride = entry.stride,
+        });
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo vk_descriptor_update_template_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+        .descriptorUpdateEntryCount = static_cast<uint32_t>(vk_entries.size()),
+        .pDescriptorUpdateEntries = vk_entries.empty() ? nullptr : vk_entries.data(),
+        .templateType = create_info.push ? VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR : VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,
+        .descriptorSetLayout = create_info.vk_descriptor_set_layout,
+        .pipelineBindPoint = create_info.vk_pipeline_bind_point,
+        .pipelineLayout = create_info.vk_pipeline_layout,
+        .set = create_info.set,
+    };
+
+    VkResult vk_result = vkCreateDescriptorUpdateTemplate(vk_device, &vk_descriptor_update_template_create_info, nullptr, &update_template.vk_descriptor_update_template);
+    if (vk_result != VK_SUCCESS) {
+        KVK_ERR(vk_result, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Failed to create descriptor update template");
+        return vk_result;
+    }
+
+    return VK_SUCCESS;
+}
+
+void destroy_update_template(VkDevice vk_device, UpdateTemplate& update_template) {
+    vkDestroyDescriptorUpdateTemplate(vk_device, update_template.vk_descriptor_update_template, nullptr);
+    update_template.vk_descriptor_update_template = VK_NULL_HANDLE;
+}
+
+void update_set(VkDevice vk_device, UpdateTemplate const& update_template, VkDescriptorSet vk_descriptor_set, void const* data, size_t data_size) {
+    if (update_template.push || data_size != update_template.data_size) {
+        KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Update template used with a {} byte struct, made for {} byte{}", data_size, update_template.data_size, update_template.push ? " push descriptors" : "s");
+        return;
+    }
+
+    vkUpdateDescriptorSetWithTemplate(vk_device, vk_descriptor_set, update_template.vk_descriptor_update_template, data);
+}
+
+void cmd_push(VkCommandBuffer vk_command_buffer, UpdateTemplate const& update_template, void const* data, size_t data_size) {
+    if (!update_template.push || data_size != update_template.data_size) {
+        KVK_ERR(VK_ERROR_UNKNOWN, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "Update template pushed with a {} byte struct, made for {} byte{}", data_size, update_template.data_size, update_template.push ? "s" : " set updates");
+        return;
+    }
+
+    update_template.vk_cmd_push_descriptor_set_with_template_khr(vk_command_buffer, update_template.vk_descriptor_update_template, update_template.vk_pipeline_layout, update_template.set, data);
+}
+
+}
+
+}
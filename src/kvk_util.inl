@@ -1,6 +1,8 @@
 #include <vulkan/vulkan.h>
 
 #include <format>
+#include <cstdint>
+#include <type_traits>
 
 #ifndef KVK_WINDOWS
 #if defined(__WIN32__) || defined(_WIN32) || defined(WIN32)
@@ -22,6 +24,43 @@
 #endif
 #endif
 
+namespace kvk {
+
+/* defined in kvk.cpp, shared by every kvk translation unit */
+extern MessageCallback g_error_callback;
+
+/* FNV-1a; stable across runs and platforms, so usable for keys that get persisted */
+inline uint64_t hash_bytes(void const* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+    uint8_t const* bytes = reinterpret_cast<uint8_t const*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+/* non-dispatchable handles are pointers on 64-bit and uint64_t elsewhere */
+template<typename T>
+inline uint64_t handle_to_u64(T handle) {
+    if constexpr (std::is_pointer_v<T>) {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+    } else {
+        return handle;
+    }
+}
+
+template<typename T>
+inline T u64_to_handle(uint64_t handle) {
+    if constexpr (std::is_pointer_v<T>) {
+        return reinterpret_cast<T>(static_cast<uintptr_t>(handle));
+    } else {
+        return handle;
+    }
+}
+
+}
+
 #define KVK_ERR(res_, sev_, msg_, ...) if (g_error_callback != nullptr) { g_error_callback(res_, sev_, std::format(msg_, ##__VA_ARGS__).c_str(), KVK_FUNCTION); }
 
 template<>
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <format>
+
+#include "kvk.h"
+
+/*
+ * spirv_pack --embed <in.spv> <out.h> <symbol>
+ *     writes <symbol> as an aligned constexpr uint32_t array, so the shader is linked into the binary
+ * spirv_pack --archive <out.kvka> <name>=<in.spv>...
+ *     packs modules into one file that kvk::shader::open_archive() maps without copying
+ */
+
+static bool read_spirv(std::string const& path, std::vector<uint32_t>& spirv) {
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (error || size == 0 || size % sizeof(uint32_t) != 0) {
+        std::cerr << "\"" << path << "\" is not a SPIR-V binary" << std::endl;
+        return false;
+    }
+
+    spirv.resize(size / sizeof(uint32_t));
+    std::ifstream in(path, std::ios::binary);
+    in.read(reinterpret_cast<char*>(spirv.data()), size);
+    if (!in || spirv[0] != 0x07230203) {
+        std::cerr << "\"" << path << "\" is not a SPIR-V binary" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static int embed(std::string const& input, std::string const& output, std::string const& symbol) {
+    std::vector<uint32_t> spirv;
+    if (!read_spirv(input, spirv)) {
+        return 1;
+    }
+
+    std::string text = std::format("#pragma once\n\n#include <cstdint>\n\n/* generated by spirv_pack from {} */\nalignas(16) inline constexpr uint32_t {}[] = {{", std::filesystem::path(input).filename().string(), symbol);
+    for (size_t i = 0; i < spirv.size(); ++i) {
+        text += std::format("{}0x{:08x},", i % 8 == 0 ? "\n    " : " ", spirv[i]);
+    }
+
+    text += "\n};\n";
+
+    /* only touch the header when it changes, so dependents aren't rebuilt for nothing */
+    {
+        std::ifstream in(output, std::ios::binary);
+        if (in.good() && std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()) == text) {
+            return 0;
+        }
+    }
+
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    out << text;
+    if (!out) {
+        std::cerr << "Failed to write \"" << output << "\"" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+static int archive(std::string const& output, std::vector<std::string> const& arguments) {
+    std::vector<kvk::shader::ArchiveModule> modules;
+    for (std::string const& argument : arguments) {
+        size_t split = argument.find('=');
+        if (split == std::string::npos || split == 0) {
+            std::cerr << "Expected <name>=<in.spv>, got \"" << argument << "\"" << std::endl;
+            return 1;
+        }
+
+        kvk::shader::ArchiveModule module = { .name = argument.substr(0, split) };
+        if (!read_spirv(argument.substr(split + 1), module.spirv)) {
+            return 1;
+        }
+
+        modules.push_back(std::move(module));
+    }
+
+    if (kvk::shader::write_archive(output, modules) != VK_SUCCESS) {
+        std::cerr << "Failed to write \"" << output << "\"" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    if (arguments.size() == 4 && arguments[0] == "--embed") {
+        return embed(arguments[1], arguments[2], arguments[3]);
+    }
+
+    if (arguments.size() >= 2 && arguments[0] == "--archive") {
+        return archive(arguments[1], std::vector<std::string>(arguments.begin() + 2, arguments.end()));
+    }
+
+    std::cerr << "usage: spirv_pack --embed <in.spv> <out.h> <symbol>" << std::endl;
+    std::cerr << "       spirv_pack --archive <out.kvka> <name>=<in.spv>..." << std::endl;
+    return 1;
+}